@@ -58,6 +58,10 @@ static inline void dsb_sev(void)
 #endif
 }
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+#include <asm-generic/qspinlock.h>
+#else
+
 /*
  * ARMv6 ticket-based spin-locking.
  *
@@ -140,6 +144,8 @@ static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 }
 #define arch_spin_is_contended	arch_spin_is_contended
 
+#endif /* CONFIG_QUEUED_SPINLOCKS */
+
 /*
  * RWLOCKS
  *
@@ -5,6 +5,10 @@
 # error "please don't include this file directly"
 #endif
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+#include <asm-generic/qspinlock_types.h>
+#else
+
 #define TICKET_SHIFT	16
 
 typedef struct {
@@ -24,6 +28,8 @@ typedef struct {
 
 #define __ARCH_SPIN_LOCK_UNLOCKED	{ { 0 } }
 
+#endif /* CONFIG_QUEUED_SPINLOCKS */
+
 typedef struct {
 	volatile unsigned int lock;
 } arch_rwlock_t;
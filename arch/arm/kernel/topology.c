@@ -13,6 +13,7 @@
 
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
+#include <linux/device.h>
 #include <linux/export.h>
 #include <linux/init.h>
 #include <linux/percpu.h>
@@ -52,6 +53,67 @@ static void set_power_scale(unsigned int cpu, unsigned long power)
 	per_cpu(cpu_scale, cpu) = power;
 }
 
+/*
+ * Maximum capacity of each cpu relative to the biggest one, which is at
+ * SCHED_POWER_SCALE.  Unlike cpu_scale, which is relative to an average
+ * cpu and feeds cpu_power, this is what the scheduler compares task
+ * utilization against when placing tasks.  It is derived from the same
+ * device tree data and can be overridden through
+ * /sys/devices/system/cpu/cpuN/cpu_capacity.
+ */
+static DEFINE_PER_CPU(unsigned long, cpu_capacity_scale) = SCHED_POWER_SCALE;
+
+unsigned long arch_scale_cpu_capacity(int cpu)
+{
+	return per_cpu(cpu_capacity_scale, cpu);
+}
+
+static ssize_t cpu_capacity_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", per_cpu(cpu_capacity_scale, dev->id));
+}
+
+static ssize_t cpu_capacity_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned long capacity;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &capacity);
+	if (ret)
+		return ret;
+	if (!capacity || capacity > SCHED_POWER_SCALE)
+		return -EINVAL;
+
+	per_cpu(cpu_capacity_scale, dev->id) = capacity;
+	update_asym_cpu_capacity();
+
+	return count;
+}
+
+static DEVICE_ATTR(cpu_capacity, S_IRUGO | S_IWUSR, cpu_capacity_show,
+		   cpu_capacity_store);
+
+static int __init cpu_capacity_init(void)
+{
+	struct device *dev;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		dev = get_cpu_device(cpu);
+		if (!dev || device_create_file(dev, &dev_attr_cpu_capacity))
+			pr_err("CPU%d: failed to create cpu_capacity\n", cpu);
+	}
+
+	/* all boot cpus have set their capacity by now */
+	update_asym_cpu_capacity();
+
+	return 0;
+}
+late_initcall(cpu_capacity_init);
+
 #ifdef CONFIG_OF
 struct cpu_efficiency {
 	const char *compatible;
@@ -83,6 +145,8 @@ struct cpu_capacity *cpu_capacity;
 
 unsigned long middle_capacity = 1;
 
+static unsigned long biggest_capacity = 1;
+
 /*
  * Iterate all CPUs' descriptor in DT and compute the efficiency
  * (as per table_efficiency). Also calculate a middle efficiency
@@ -147,6 +211,9 @@ static void __init parse_dt_topology(void)
 	if (cpu < num_possible_cpus())
 		cpu_capacity[cpu].hwid = (unsigned long)(-1);
 
+	if (max_capacity)
+		biggest_capacity = max_capacity;
+
 	/* If min and max capacities are equals, we bypass the update of the
 	 * cpu_scale because all CPUs have the same capacity. Otherwise, we
 	 * compute a middle_capacity factor that will ensure that the capacity
@@ -187,6 +254,9 @@ void update_cpu_power(unsigned int cpu, unsigned long hwid)
 		return;
 
 	set_power_scale(cpu, cpu_capacity[idx].capacity / middle_capacity);
+	per_cpu(cpu_capacity_scale, cpu) = max_t(unsigned long, 1,
+		div_u64((u64)cpu_capacity[idx].capacity << SCHED_POWER_SHIFT,
+			biggest_capacity));
 
 	printk(KERN_INFO "CPU%u: update cpu_power %lu\n",
 		cpu, arch_scale_freq_power(NULL, cpu));
@@ -22,6 +22,7 @@
 #include <linux/export.h>
 #include <linux/kernel_stat.h>
 #include <linux/mutex.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/tick.h>
 #include <linux/types.h>
@@ -94,7 +95,7 @@ void dbs_check_cpu(struct dbs_data *dbs_data, int cpu)
 		struct cpu_dbs_common_info *j_cdbs;
 		u64 cur_wall_time, cur_idle_time;
 		unsigned int idle_time, wall_time;
-		unsigned int load;
+		unsigned int load, uclamp_min, uclamp_max;
 		int io_busy = 0;
 
 		j_cdbs = dbs_data->cdata->get_cpu_cdbs(j);
@@ -140,6 +141,13 @@ void dbs_check_cpu(struct dbs_data *dbs_data, int cpu)
 
 		load = 100 * (wall_time - idle_time) / wall_time;
 
+		/*
+		 * Bound the load by the utilization clamps of the tasks
+		 * runnable on the cpu at the end of the sample.
+		 */
+		sched_uclamp_cpu(j, &uclamp_min, &uclamp_max);
+		load = clamp(load, uclamp_min, uclamp_max);
+
 		if (load > max_load)
 			max_load = load;
 	}
@@ -19,6 +19,7 @@
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/irq_work.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/rwsem.h>
@@ -64,6 +65,10 @@ static cpumask_t speedchange_cpumask;
 static spinlock_t speedchange_cpumask_lock;
 static struct mutex gov_lock;
 
+/* cpus whose utilization clamp was raised, see cpufreq_interactive_uclamp */
+static cpumask_t uclamp_cpumask;
+static struct irq_work uclamp_work;
+
 /* Target load.  Lower values result in higher CPU speeds. */
 #define DEFAULT_TARGET_LOAD 90
 static unsigned int default_target_loads[] = {DEFAULT_TARGET_LOAD};
@@ -344,6 +349,33 @@ static unsigned int choose_freq(struct cpufreq_interactive_cpuinfo *pcpu,
 	return freq;
 }
 
+/*
+ * The table frequencies corresponding to the utilization clamps of the
+ * tasks runnable on @cpu, in percent of the maximum frequency.
+ */
+static void uclamp_freq_range(struct cpufreq_interactive_cpuinfo *pcpu,
+			      int cpu, unsigned int *floor, unsigned int *cap)
+{
+	struct cpufreq_policy *policy = pcpu->policy;
+	unsigned int min, max;
+	int index;
+
+	sched_uclamp_cpu(cpu, &min, &max);
+
+	*floor = 0;
+	*cap = UINT_MAX;
+
+	if (min && !cpufreq_frequency_table_target(policy, pcpu->freq_table,
+			policy->cpuinfo.max_freq / 100 * min,
+			CPUFREQ_RELATION_L, &index))
+		*floor = pcpu->freq_table[index].frequency;
+
+	if (max < 100 && !cpufreq_frequency_table_target(policy,
+			pcpu->freq_table, policy->cpuinfo.max_freq / 100 * max,
+			CPUFREQ_RELATION_H, &index))
+		*cap = pcpu->freq_table[index].frequency;
+}
+
 static u64 update_load(int cpu)
 {
 	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
@@ -383,6 +415,7 @@ static void cpufreq_interactive_timer(unsigned long data)
 		pcpu->policy->governor_data;
 	unsigned int new_freq;
 	unsigned int loadadjfreq;
+	unsigned int uclamp_floor, uclamp_cap;
 	unsigned int index;
 	unsigned long flags;
 
@@ -422,8 +455,16 @@ static void cpufreq_interactive_timer(unsigned long data)
 			new_freq = tunables->hispeed_freq;
 	}
 
+	/*
+	 * The utilization clamps of the runnable tasks win over the load:
+	 * a boost is reached without waiting above hispeed_freq, and
+	 * the cap applies even to a boosted or fully loaded cpu.
+	 */
+	uclamp_freq_range(pcpu, data, &uclamp_floor, &uclamp_cap);
+	new_freq = clamp(new_freq, uclamp_floor, uclamp_cap);
+
 	if (pcpu->target_freq >= tunables->hispeed_freq &&
-	    new_freq > pcpu->target_freq &&
+	    new_freq > pcpu->target_freq && new_freq > uclamp_floor &&
 	    now - pcpu->hispeed_validate_time <
 	    freq_to_above_hispeed_delay(tunables, pcpu->target_freq)) {
 		trace_cpufreq_interactive_notyet(
@@ -446,9 +487,10 @@ static void cpufreq_interactive_timer(unsigned long data)
 
 	/*
 	 * Do not scale below floor_freq unless we have been at or above the
-	 * floor frequency for the minimum sample time since last validated.
+	 * floor frequency for the minimum sample time since last validated,
+	 * or the tasks are capped.
 	 */
-	if (new_freq < pcpu->floor_freq) {
+	if (new_freq < pcpu->floor_freq && new_freq < uclamp_cap) {
 		if (now - pcpu->floor_validate_time <
 				tunables->min_sample_time) {
 			trace_cpufreq_interactive_notyet(
@@ -563,6 +605,48 @@ static void cpufreq_interactive_idle_end(void)
 	up_read(&pcpu->enable_sem);
 }
 
+/*
+ * Raise the target of the cpus whose utilization clamp was raised to the
+ * boosted frequency right away, rather than at their next sample.  Called
+ * from the speedchange task; the cpus to change speed of are added to
+ * @mask.
+ */
+static void cpufreq_interactive_uclamp_boost(cpumask_t *mask)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned int cpu, floor, cap;
+	unsigned long flags;
+
+	for_each_cpu(cpu, &uclamp_cpumask) {
+		if (!cpumask_test_and_clear_cpu(cpu, &uclamp_cpumask))
+			continue;
+
+		pcpu = &per_cpu(cpuinfo, cpu);
+		if (!down_read_trylock(&pcpu->enable_sem))
+			continue;
+		if (!pcpu->governor_enabled) {
+			up_read(&pcpu->enable_sem);
+			continue;
+		}
+
+		uclamp_freq_range(pcpu, cpu, &floor, &cap);
+
+		spin_lock_irqsave(&pcpu->target_freq_lock, flags);
+		if (pcpu->target_freq < floor) {
+			trace_cpufreq_interactive_target(cpu, 0,
+				pcpu->target_freq, pcpu->policy->cur, floor);
+			pcpu->target_freq = floor;
+			pcpu->floor_freq = floor;
+			pcpu->floor_validate_time = ktime_to_us(ktime_get());
+			pcpu->hispeed_validate_time = pcpu->floor_validate_time;
+			cpumask_set_cpu(cpu, mask);
+		}
+		spin_unlock_irqrestore(&pcpu->target_freq_lock, flags);
+
+		up_read(&pcpu->enable_sem);
+	}
+}
+
 static int cpufreq_interactive_speedchange_task(void *data)
 {
 	unsigned int cpu;
@@ -574,7 +658,8 @@ static int cpufreq_interactive_speedchange_task(void *data)
 		set_current_state(TASK_INTERRUPTIBLE);
 		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
 
-		if (cpumask_empty(&speedchange_cpumask)) {
+		if (cpumask_empty(&speedchange_cpumask) &&
+		    cpumask_empty(&uclamp_cpumask)) {
 			spin_unlock_irqrestore(&speedchange_cpumask_lock,
 					       flags);
 			schedule();
@@ -590,6 +675,8 @@ static int cpufreq_interactive_speedchange_task(void *data)
 		cpumask_clear(&speedchange_cpumask);
 		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
 
+		cpufreq_interactive_uclamp_boost(&tmp_mask);
+
 		for_each_cpu(cpu, &tmp_mask) {
 			unsigned int j;
 			unsigned int max_freq = 0;
@@ -1166,6 +1253,28 @@ static struct notifier_block cpufreq_interactive_idle_nb = {
 	.notifier_call = cpufreq_interactive_idle_notifier,
 };
 
+static void cpufreq_interactive_uclamp_work(struct irq_work *work)
+{
+	wake_up_process(speedchange_task);
+}
+
+/*
+ * Called with the runqueue lock of @cpu held, where the speedchange task
+ * cannot be woken; the wakeup is deferred to an irq_work.
+ */
+static int cpufreq_interactive_uclamp(struct notifier_block *nb,
+				      unsigned long cpu, void *data)
+{
+	cpumask_set_cpu(cpu, &uclamp_cpumask);
+	irq_work_queue(&uclamp_work);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_interactive_uclamp_nb = {
+	.notifier_call = cpufreq_interactive_uclamp,
+};
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event)
 {
@@ -1232,6 +1341,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			idle_notifier_register(&cpufreq_interactive_idle_nb);
 			cpufreq_register_notifier(&cpufreq_notifier_block,
 					CPUFREQ_TRANSITION_NOTIFIER);
+			register_uclamp_notifier(&cpufreq_interactive_uclamp_nb);
 		}
 
 		break;
@@ -1239,6 +1349,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 	case CPUFREQ_GOV_POLICY_EXIT:
 		if (!--tunables->usage_count) {
 			if (policy->governor->initialized == 1) {
+				unregister_uclamp_notifier(&cpufreq_interactive_uclamp_nb);
 				cpufreq_unregister_notifier(&cpufreq_notifier_block,
 						CPUFREQ_TRANSITION_NOTIFIER);
 				idle_notifier_unregister(&cpufreq_interactive_idle_nb);
@@ -1378,6 +1489,7 @@ static int __init cpufreq_interactive_init(void)
 
 	spin_lock_init(&speedchange_cpumask_lock);
 	mutex_init(&gov_lock);
+	init_irq_work(&uclamp_work, cpufreq_interactive_uclamp_work);
 	speedchange_task =
 		kthread_create(cpufreq_interactive_speedchange_task, NULL,
 			       "cfinteractive");
@@ -1402,6 +1514,7 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	irq_work_sync(&uclamp_work);
 	kthread_stop(speedchange_task);
 	put_task_struct(speedchange_task);
 }
@@ -345,6 +345,18 @@ static int proc_pid_schedstat(struct task_struct *task, char *buffer)
 }
 #endif
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+/*
+ * Provides /proc/PID/sched_latency
+ */
+static int proc_pid_sched_latency(struct seq_file *m, struct pid_namespace *ns,
+				  struct pid *pid, struct task_struct *task)
+{
+	sched_lat_hist_show(m, &task->sched_info.lat_hist);
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_LATENCYTOP
 static int lstats_show_proc(struct seq_file *m, void *v)
 {
@@ -2740,6 +2752,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_SCHEDSTATS
 	INF("schedstat",  S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	ONE("sched_latency", S_IRUGO, proc_pid_sched_latency),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
@@ -3137,6 +3152,9 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_SCHEDSTATS
 	INF("schedstat", S_IRUGO, proc_pid_schedstat),
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	ONE("sched_latency", S_IRUGO, proc_pid_sched_latency),
+#endif
 #ifdef CONFIG_LATENCYTOP
 	REG("latency",  S_IRUGO, proc_lstats_operations),
 #endif
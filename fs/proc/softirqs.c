@@ -36,9 +36,65 @@ static const struct file_operations proc_softirqs_operations = {
 	.release	= single_release,
 };
 
+/*
+ * /proc/softirqs_stat ... per vector handler time and raise to run
+ * latency in us, and the number of deferrals to ksoftirqd
+ */
+static int show_softirqs_stat(struct seq_file *p, void *v)
+{
+	int i, j;
+
+	seq_puts(p, "                    ");
+	for_each_possible_cpu(i)
+		seq_printf(p, "CPU%-8d", i);
+	seq_putc(p, '\n');
+
+	seq_puts(p, "time:\n");
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j)
+			seq_printf(p, " %10llu",
+				   div_u64(kstat_softirq_time_cpu(i, j),
+					   NSEC_PER_USEC));
+		seq_putc(p, '\n');
+	}
+
+	seq_puts(p, "latency_max:\n");
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j)
+			seq_printf(p, " %10llu",
+				   div_u64(kstat_softirq_latency_max_cpu(i, j),
+					   NSEC_PER_USEC));
+		seq_putc(p, '\n');
+	}
+
+	seq_puts(p, "deferred:\n");
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j)
+			seq_printf(p, " %10u", kstat_softirqs_deferred_cpu(i, j));
+		seq_putc(p, '\n');
+	}
+	return 0;
+}
+
+static int softirqs_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_softirqs_stat, NULL);
+}
+
+static const struct file_operations proc_softirqs_stat_operations = {
+	.open		= softirqs_stat_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init proc_softirqs_init(void)
 {
 	proc_create("softirqs", 0, NULL, &proc_softirqs_operations);
+	proc_create("softirqs_stat", 0, NULL, &proc_softirqs_stat_operations);
 	return 0;
 }
 module_init(proc_softirqs_init);
@@ -55,6 +55,9 @@ union futex_key {
 #ifdef CONFIG_FUTEX
 extern void exit_robust_list(struct task_struct *curr);
 extern void exit_pi_state_list(struct task_struct *curr);
+extern void futex_mm_share(struct mm_struct *mm);
+extern void futex_mm_free(struct mm_struct *mm);
+extern int sysctl_futex_private_hash;
 #ifdef CONFIG_HAVE_FUTEX_CMPXCHG
 #define futex_cmpxchg_enabled 1
 #else
@@ -67,5 +70,11 @@ static inline void exit_robust_list(struct task_struct *curr)
 static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
+static inline void futex_mm_share(struct mm_struct *mm)
+{
+}
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
 #endif
 #endif
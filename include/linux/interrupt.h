@@ -99,6 +99,11 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
  * @thread:	thread pointer for threaded interrupts
  * @thread_flags:	flags related to @thread
  * @thread_mask:	bitmask for keeping track of @thread activity
+ * @thread_cpu:	cpu which last woke @thread
+ * @thread_woken:	stats field, time @thread was last woken
+ * @thread_count:	stats field, number of @thread_fn invocations
+ * @thread_time:	stats field, ns spent in @thread_fn
+ * @thread_latency_max:	stats field, longest wakeup to @thread_fn latency in ns
  * @dir:	pointer to the proc/irq/NN/name entry
  */
 struct irqaction {
@@ -112,6 +117,15 @@ struct irqaction {
 	unsigned int		flags;
 	unsigned long		thread_flags;
 	unsigned long		thread_mask;
+#ifdef CONFIG_SMP
+	unsigned int		thread_cpu;
+#endif
+#ifdef CONFIG_IRQ_HANDLER_STATS
+	u64			thread_woken;
+	unsigned long		thread_count;
+	u64			thread_time;
+	u64			thread_latency_max;
+#endif
 	const char		*name;
 	struct proc_dir_entry	*dir;
 } ____cacheline_internodealigned_in_smp;
@@ -467,6 +481,7 @@ enum
  * kernel/softirq.c when adding a new softirq.
  */
 extern char *softirq_to_name[NR_SOFTIRQS];
+extern int softirq_budget_us[NR_SOFTIRQS];
 
 /* softirq mask and active fields moved to irq_cpustat_t in
  * asm/hardirq.h to get better cache usage.  KAO
@@ -9,6 +9,7 @@
  */
 
 struct irq_affinity_notify;
+struct irq_followers;
 struct proc_dir_entry;
 struct module;
 struct irq_desc;
@@ -36,6 +37,10 @@ struct irq_desc;
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
+ * @followers:		tasks moved along with the irq threads
+ * @hardirq_count:	stats field, number of primary handler invocations
+ * @hardirq_time:	stats field, ns spent in the primary handlers
+ * @hardirq_max:	stats field, longest primary handler invocation in ns
  * @dir:		/proc/irq/ procfs entry
  * @name:		flow handler name for /proc/interrupts output
  */
@@ -61,6 +66,7 @@ struct irq_desc {
 #ifdef CONFIG_SMP
 	const struct cpumask	*affinity_hint;
 	struct irq_affinity_notify *affinity_notify;
+	struct irq_followers	*followers;
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_var_t		pending_mask;
 #endif
@@ -68,6 +74,11 @@ struct irq_desc {
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
 	wait_queue_head_t       wait_for_threads;
+#ifdef CONFIG_IRQ_HANDLER_STATS
+	unsigned long		hardirq_count;
+	u64			hardirq_time;
+	u64			hardirq_max;
+#endif
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
 #endif
@@ -41,6 +41,9 @@ struct kernel_stat {
 #endif
 	unsigned long irqs_sum;
 	unsigned int softirqs[NR_SOFTIRQS];
+	unsigned int softirqs_deferred[NR_SOFTIRQS];
+	u64 softirq_time[NR_SOFTIRQS];
+	u64 softirq_latency_max[NR_SOFTIRQS];
 };
 
 DECLARE_PER_CPU(struct kernel_stat, kstat);
@@ -91,6 +94,24 @@ static inline unsigned int kstat_softirqs_cpu(unsigned int irq, int cpu)
        return kstat_cpu(cpu).softirqs[irq];
 }
 
+/* Times the vector was left to ksoftirqd after overrunning its budget */
+static inline unsigned int kstat_softirqs_deferred_cpu(unsigned int irq, int cpu)
+{
+	return kstat_cpu(cpu).softirqs_deferred[irq];
+}
+
+/* ns spent in the vector's handler */
+static inline u64 kstat_softirq_time_cpu(unsigned int irq, int cpu)
+{
+	return kstat_cpu(cpu).softirq_time[irq];
+}
+
+/* Longest time in ns from raising the vector to running its handler */
+static inline u64 kstat_softirq_latency_max_cpu(unsigned int irq, int cpu)
+{
+	return kstat_cpu(cpu).softirq_latency_max[irq];
+}
+
 /*
  * Number of interrupts per specific IRQ source, since bootup
  */
@@ -9,6 +9,8 @@
 #ifndef __LINUX_LOCKDEP_H
 #define __LINUX_LOCKDEP_H
 
+#include <linux/types.h>
+
 struct task_struct;
 struct lockdep_map;
 
@@ -418,6 +420,29 @@ struct lock_class_key { };
 
 #endif /* !LOCKDEP */
 
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+/*
+ * Lightweight contention profiling, see kernel/lock_contention.c.  Only
+ * the contended slowpath is timed, and nothing but a flag test is added
+ * to the lock path while profiling is off.
+ */
+extern int lock_contention_enabled;
+extern u64 lock_contention_begin(void *lock, unsigned long ip);
+extern void lock_contention_end(void *lock, unsigned long ip, u64 start);
+#else
+#define lock_contention_enabled		0
+
+static inline u64 lock_contention_begin(void *lock, unsigned long ip)
+{
+	return 0;
+}
+
+static inline void lock_contention_end(void *lock, unsigned long ip,
+				       u64 start)
+{
+}
+#endif
+
 #ifdef CONFIG_LOCK_STAT
 
 extern void lock_contended(struct lockdep_map *lock, unsigned long ip);
@@ -437,9 +462,26 @@ do {								\
 #define lock_contended(lockdep_map, ip) do {} while (0)
 #define lock_acquired(lockdep_map, ip) do {} while (0)
 
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+
+#define LOCK_CONTENDED(_lock, try, lock)				\
+do {									\
+	if (likely(!lock_contention_enabled))				\
+		lock(_lock);						\
+	else if (!try(_lock)) {						\
+		u64 __start = lock_contention_begin(_lock, _RET_IP_);	\
+		lock(_lock);						\
+		lock_contention_end(_lock, _RET_IP_, __start);		\
+	}								\
+} while (0)
+
+#else /* CONFIG_LOCK_CONTENTION_STATS */
+
 #define LOCK_CONTENDED(_lock, try, lock) \
 	lock(_lock)
 
+#endif /* CONFIG_LOCK_CONTENTION_STATS */
+
 #endif /* CONFIG_LOCK_STAT */
 
 #ifdef CONFIG_LOCKDEP
@@ -452,6 +494,19 @@ do {								\
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
 	LOCK_CONTENDED((_lock), (try), (lock))
 
+#elif defined(CONFIG_LOCK_CONTENTION_STATS)
+
+#define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags)		\
+do {									\
+	if (likely(!lock_contention_enabled))				\
+		lockfl((_lock), (flags));				\
+	else if (!try(_lock)) {						\
+		u64 __start = lock_contention_begin(_lock, _RET_IP_);	\
+		lockfl((_lock), (flags));				\
+		lock_contention_end(_lock, _RET_IP_, __start);		\
+	}								\
+} while (0)
+
 #else /* CONFIG_LOCKDEP */
 
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
@@ -449,6 +449,11 @@ struct mm_struct {
 	 * PROT_NONE or PROT_NUMA mapped page.
 	 */
 	bool tlb_flush_pending;
+#endif
+#ifdef CONFIG_FUTEX
+	/* private futex hash, see futex_mm_share() */
+	struct futex_hash_bucket *futex_hash;
+	unsigned int futex_hash_mask;
 #endif
 	struct uprobes_state uprobes_state;
 };
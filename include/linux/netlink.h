@@ -99,6 +99,9 @@ int netlink_sendskb(struct sock *sk, struct sk_buff *skb);
 
 #define NLMSG_DEFAULT_SIZE (NLMSG_GOODSIZE - NLMSG_HDRLEN)
 
+/* Largest skb a dump is built into when the reader's buffer allows it */
+#define NLMSG_DUMP_MAXSIZE	SKB_WITH_OVERHEAD(32768)
+
 
 struct netlink_callback {
 	struct sk_buff		*skb;
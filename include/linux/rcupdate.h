@@ -1015,5 +1015,11 @@ extern bool rcu_is_nocb_cpu(int cpu);
 static inline bool rcu_is_nocb_cpu(int cpu) { return false; }
 #endif /* #else #ifdef CONFIG_RCU_NOCB_CPU */
 
+#if defined(CONFIG_RCU_NOCB_CPU) && defined(CONFIG_NO_HZ_FULL)
+extern void rcu_init_nohz(void);
+#else
+static inline void rcu_init_nohz(void) { }
+#endif
+
 
 #endif /* __LINUX_RCUPDATE_H */
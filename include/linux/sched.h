@@ -699,6 +699,28 @@ struct backing_dev_info;
 struct reclaim_state;
 
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
+#ifdef CONFIG_SCHED_LATENCY_HIST
+/*
+ * log2 histograms of the time from being queued to running on a cpu.
+ * Bucket 0 counts waits below 1024ns, bucket n > 0 waits of 2^(n+9) to
+ * 2^(n+10)-1 ns, and the last bucket everything longer.
+ */
+#define SCHED_LAT_HIST_BUCKETS	24
+
+enum sched_lat_type {
+	SCHED_LAT_WAKEUP,	/* queued by a wakeup */
+	SCHED_LAT_PREEMPT,	/* queued by losing the cpu while runnable */
+	SCHED_LAT_NR_TYPES,
+};
+
+struct sched_lat_hist {
+	unsigned long count[SCHED_LAT_NR_TYPES][SCHED_LAT_HIST_BUCKETS];
+};
+
+extern void sched_lat_hist_show(struct seq_file *m,
+				const struct sched_lat_hist *hist);
+#endif
+
 struct sched_info {
 	/* cumulative counters */
 	unsigned long pcount;	      /* # of times run on this cpu */
@@ -707,6 +729,12 @@ struct sched_info {
 	/* timestamps */
 	unsigned long long last_arrival,/* when we last ran on a cpu */
 			   last_queued;	/* when we were last queued to run */
+
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	unsigned long long lat_wait;	/* wait so far, across migrations */
+	int lat_preempted;		/* waiting since being preempted */
+	struct sched_lat_hist lat_hist;
+#endif
 };
 #endif /* defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT) */
 
@@ -892,6 +920,14 @@ void free_sched_domains(cpumask_var_t doms[], unsigned int ndoms);
 
 bool cpus_share_cache(int this_cpu, int that_cpu);
 
+/*
+ * Architectures whose cpus differ in capacity override
+ * arch_scale_cpu_capacity() and call update_asym_cpu_capacity() when
+ * its values change.
+ */
+extern unsigned long arch_scale_cpu_capacity(int cpu);
+extern void update_asym_cpu_capacity(void);
+
 #else /* CONFIG_SMP */
 
 struct sched_domain_attr;
@@ -907,6 +943,10 @@ static inline bool cpus_share_cache(int this_cpu, int that_cpu)
 	return true;
 }
 
+static inline void update_asym_cpu_capacity(void)
+{
+}
+
 #endif	/* !CONFIG_SMP */
 
 
@@ -1012,6 +1052,83 @@ struct sched_entity {
 #endif
 };
 
+/*
+ * Extended scheduling parameters data structure.
+ *
+ * This is needed because the original struct sched_param can not be
+ * altered without introducing ABI issues with legacy applications
+ * (e.g., in sched_getparam()).
+ *
+ * @size		size of the structure, for fwd/bwd compat.
+ *
+ * @sched_policy	task's scheduling policy
+ * @sched_flags		for customizing the scheduler behaviour
+ * @sched_nice		task's nice value      (SCHED_NORMAL/BATCH)
+ * @sched_priority	task's static priority (SCHED_FIFO/RR)
+ * @sched_runtime	representative of the task's runtime (SCHED_DEADLINE)
+ * @sched_deadline	representative of the task's deadline (SCHED_DEADLINE)
+ * @sched_period	representative of the task's period (SCHED_DEADLINE)
+ *
+ * All times are in nanoseconds.  A SCHED_DEADLINE task is guaranteed
+ * @sched_runtime of cpu time within @sched_deadline of every activation,
+ * and activations are at least @sched_period apart (@sched_period == 0
+ * means "same as @sched_deadline").  The bandwidth runtime/period of all
+ * deadline tasks in a root domain must fit in the global rt limit set by
+ * sched_rt_runtime_us/sched_rt_period_us, or sched_setattr() fails with
+ * -EBUSY.
+ */
+#define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
+
+struct sched_attr {
+	u32 size;
+
+	u32 sched_policy;
+	u64 sched_flags;
+
+	/* SCHED_NORMAL, SCHED_BATCH */
+	s32 sched_nice;
+
+	/* SCHED_FIFO, SCHED_RR */
+	u32 sched_priority;
+
+	/* SCHED_DEADLINE */
+	u64 sched_runtime;
+	u64 sched_deadline;
+	u64 sched_period;
+};
+
+struct sched_dl_entity {
+	struct rb_node	rb_node;
+
+	/*
+	 * Original scheduling parameters, as set by sched_setattr().
+	 * dl_bw is to_ratio(dl_period, dl_runtime), cached for admission
+	 * control.
+	 */
+	u64 dl_runtime;		/* maximum runtime for each instance	*/
+	u64 dl_deadline;	/* relative deadline of each instance	*/
+	u64 dl_period;		/* separation of two instances (period) */
+	u64 dl_bw;		/* dl_runtime / dl_period		*/
+
+	/*
+	 * Actual scheduling parameters: the remaining runtime of the
+	 * current instance and its absolute deadline.
+	 */
+	s64 runtime;
+	u64 deadline;
+
+	/*
+	 * @dl_throttled tells the runtime of the current instance is
+	 * exhausted and the entity waits in dl_timer for replenishment;
+	 * @dl_new tells the parameters must be (re)initialised at the next
+	 * enqueue.
+	 */
+	int dl_throttled, dl_new;
+
+	/* replenishment timer, armed at the current deadline when throttled */
+	struct hrtimer dl_timer;
+};
+
 struct sched_rt_entity {
 	struct list_head run_list;
 	unsigned long timeout;
@@ -1028,6 +1145,22 @@ struct sched_rt_entity {
 #endif
 };
 
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+enum uclamp_id {
+	UCLAMP_MIN = 0,		/* minimum utilization (boost) */
+	UCLAMP_MAX,		/* maximum utilization (cap) */
+	UCLAMP_CNT
+};
+
+/*
+ * The clamp value, in percent, a task is accounted with in the clamp
+ * buckets of its runqueue while it is enqueued.
+ */
+struct uclamp_se {
+	unsigned int value;
+	unsigned int active;
+};
+#endif
 
 struct rcu_node;
 
@@ -1056,9 +1189,13 @@ struct task_struct {
 	const struct sched_class *sched_class;
 	struct sched_entity se;
 	struct sched_rt_entity rt;
+	struct sched_dl_entity dl;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group *sched_task_group;
 #endif
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	struct uclamp_se uclamp[UCLAMP_CNT];
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
@@ -1101,6 +1238,7 @@ struct task_struct {
 	struct list_head tasks;
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
+	struct rb_node pushable_dl_tasks;
 #endif
 
 	struct mm_struct *mm, *active_mm;
@@ -1285,6 +1423,10 @@ struct task_struct {
 	struct held_lock held_locks[MAX_LOCK_DEPTH];
 	gfp_t lockdep_reclaim_gfp;
 #endif
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+	/* caller of the mutex being taken, for the slowpath to account to */
+	unsigned long mutex_contention_ip;
+#endif
 
 /* journalling filesystem info */
 	void *journal_info;
@@ -1931,6 +2073,8 @@ extern int sched_setscheduler(struct task_struct *, int,
 			      const struct sched_param *);
 extern int sched_setscheduler_nocheck(struct task_struct *, int,
 				      const struct sched_param *);
+extern int sched_setattr(struct task_struct *,
+			 const struct sched_attr *);
 extern struct task_struct *idle_task(int cpu);
 /**
  * is_idle_task - is the specified task an idle task?
@@ -2668,6 +2812,26 @@ extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
 extern struct task_group root_task_group;
 #endif /* CONFIG_CGROUP_SCHED */
 
+/*
+ * Utilization clamps of the tasks runnable on a cpu, in percent of its
+ * capacity.  The notifier chain is called, with the cpu's runqueue lock
+ * held, when the minimum clamp of a cpu is raised.
+ */
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+extern void sched_uclamp_cpu(int cpu, unsigned int *min, unsigned int *max);
+extern void register_uclamp_notifier(struct notifier_block *n);
+extern void unregister_uclamp_notifier(struct notifier_block *n);
+#else
+static inline void sched_uclamp_cpu(int cpu, unsigned int *min,
+				    unsigned int *max)
+{
+	*min = 0;
+	*max = 100;
+}
+static inline void register_uclamp_notifier(struct notifier_block *n) { }
+static inline void unregister_uclamp_notifier(struct notifier_block *n) { }
+#endif
+
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
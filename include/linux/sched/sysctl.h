@@ -93,6 +93,15 @@ extern unsigned int sysctl_sched_autogroup_enabled;
 
 extern int sched_rr_timeslice;
 
+#ifdef CONFIG_SMP
+extern unsigned int sysctl_sched_upmigrate;
+extern unsigned int sysctl_sched_downmigrate;
+
+extern int sched_migrate_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp,
+		loff_t *ppos);
+#endif
+
 extern int sched_rr_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
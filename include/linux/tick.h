@@ -158,6 +158,9 @@ static inline u64 get_cpu_iowait_time_us(int cpu, u64 *unused) { return -1; }
 # endif /* !CONFIG_NO_HZ_COMMON */
 
 #ifdef CONFIG_NO_HZ_FULL
+extern cpumask_var_t tick_nohz_full_mask;
+extern bool have_nohz_full_mask;
+
 extern void tick_nohz_init(void);
 extern int tick_nohz_full_cpu(int cpu);
 extern void tick_nohz_full_check(void);
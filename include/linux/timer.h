@@ -22,6 +22,7 @@ struct timer_list {
 	unsigned long data;
 
 	int slack;
+	unsigned int bucket;
 
 #ifdef CONFIG_TIMER_STATS
 	int start_pid;
@@ -179,6 +180,20 @@ extern int mod_timer_pinned(struct timer_list *timer, unsigned long expires);
 
 extern void set_timer_slack(struct timer_list *time, int slack_hz);
 
+/*
+ * Timer wheel state of a CPU, as shown in /proc/timer_list.
+ */
+struct timer_base_stats {
+	unsigned long	timer_jiffies;
+	unsigned long	next_timer;
+	unsigned long	active_timers;
+	unsigned long	pending_buckets;
+	unsigned long	nr_requeue_skipped;
+	unsigned long	nr_migrated;
+};
+
+extern void timer_get_base_stats(int cpu, struct timer_base_stats *stats);
+
 #define TIMER_NOT_PINNED	0
 #define TIMER_PINNED		1
 /*
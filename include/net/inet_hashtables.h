@@ -256,6 +256,8 @@ void inet_hashinfo_init(struct inet_hashinfo *h);
 extern int __inet_hash_nolisten(struct sock *sk, struct inet_timewait_sock *tw);
 extern void inet_hash(struct sock *sk);
 extern void inet_unhash(struct sock *sk);
+extern void inet_reuseport_add_sock(struct sock *sk,
+				    struct inet_listen_hashbucket *ilb);
 
 extern struct sock *__inet_lookup_listener(struct net *net,
 					   struct inet_hashinfo *hashinfo,
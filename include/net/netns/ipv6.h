@@ -9,6 +9,7 @@
 #include <net/dst_ops.h>
 
 struct ctl_table_header;
+struct fib6_gc_state;
 
 struct netns_sysctl_ipv6 {
 #ifdef CONFIG_SYSCTL
@@ -49,6 +50,7 @@ struct netns_ipv6 {
 	struct rt6_info         *ip6_null_entry;
 	struct rt6_statistics   *rt6_stats;
 	struct timer_list       ip6_fib_timer;
+	struct fib6_gc_state	*fib6_gc;
 	struct hlist_head       *fib_table_hash;
 	struct fib6_table       *fib6_main_tbl;
 	struct dst_ops		ip6_dst_ops;
@@ -264,6 +264,7 @@ struct cg_proto;
   *	@sk_sndtimeo: %SO_SNDTIMEO setting
   *	@sk_rxhash: flow hash received from netif layer
   *	@sk_filter: socket filtering instructions
+  *	@sk_reuseport_cb: SO_REUSEPORT listener group
   *	@sk_protinfo: private area, net family specific, when not using slab
   *	@sk_timer: sock cleanup timer
   *	@sk_stamp: time stamp of last packet received
@@ -331,6 +332,7 @@ struct sock {
 	int			sk_rcvbuf;
 
 	struct sk_filter __rcu	*sk_filter;
+	struct sock_reuseport __rcu *sk_reuseport_cb;
 	struct socket_wq __rcu	*sk_wq;
 
 #ifdef CONFIG_NET_DMA
@@ -0,0 +1,31 @@
+#ifndef _SOCK_REUSEPORT_H
+#define _SOCK_REUSEPORT_H
+
+#include <linux/types.h>
+#include <linux/rcupdate.h>
+
+struct sock;
+
+/*
+ * A group of listeners sharing one port with SO_REUSEPORT.  Every member
+ * points at the group through sk_reuseport_cb, so a lookup that lands on
+ * any of them can pick the target directly instead of scoring the rest
+ * of the hash chain.
+ */
+struct sock_reuseport {
+	struct rcu_head		rcu;
+	u16			max_socks;	/* length of socks */
+	u16			num_socks;	/* elements in socks */
+	u8			partial;	/* port shared with non-members */
+	struct sock		*socks[0];	/* array of sock pointers */
+};
+
+extern int sysctl_reuseport_cpu_affinity;
+
+extern int reuseport_alloc(struct sock *sk);
+extern int reuseport_add_sock(struct sock *sk, struct sock *sk2);
+extern void reuseport_detach_sock(struct sock *sk);
+extern void reuseport_set_partial(struct sock *sk);
+extern struct sock *reuseport_select_sock(struct sock *sk, u32 hash);
+
+#endif  /* _SOCK_REUSEPORT_H */
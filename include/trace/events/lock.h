@@ -80,6 +80,63 @@ DEFINE_EVENT(lock, lock_acquired,
 #endif
 #endif
 
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+
+extern void lock_contention_trace_reg(void);
+extern void lock_contention_trace_unreg(void);
+
+/*
+ * Contended acquisitions, as seen by the lightweight contention
+ * profiler: begin when the lock is found taken, end once it is held.
+ * Enabling either event turns contention profiling on.
+ */
+TRACE_EVENT_FN(contention_begin,
+
+	TP_PROTO(void *lock, unsigned long ip),
+
+	TP_ARGS(lock, ip),
+
+	TP_STRUCT__entry(
+		__field(	void *,		lock_addr	)
+		__field(	unsigned long,	ip		)
+	),
+
+	TP_fast_assign(
+		__entry->lock_addr = lock;
+		__entry->ip = ip;
+	),
+
+	TP_printk("%p %pS", __entry->lock_addr, (void *)__entry->ip),
+
+	lock_contention_trace_reg, lock_contention_trace_unreg
+);
+
+TRACE_EVENT_FN(contention_end,
+
+	TP_PROTO(void *lock, unsigned long ip, u64 wait_ns),
+
+	TP_ARGS(lock, ip, wait_ns),
+
+	TP_STRUCT__entry(
+		__field(	void *,		lock_addr	)
+		__field(	unsigned long,	ip		)
+		__field(	u64,		wait_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->lock_addr = lock;
+		__entry->ip = ip;
+		__entry->wait_ns = wait_ns;
+	),
+
+	TP_printk("%p %pS wait=%llu ns", __entry->lock_addr,
+		  (void *)__entry->ip, (unsigned long long)__entry->wait_ns),
+
+	lock_contention_trace_reg, lock_contention_trace_unreg
+);
+
+#endif
+
 #endif /* _TRACE_LOCK_H */
 
 /* This part must be outside protection */
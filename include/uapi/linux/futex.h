@@ -20,6 +20,8 @@
 #define FUTEX_WAKE_BITSET	10
 #define FUTEX_WAIT_REQUEUE_PI	11
 #define FUTEX_CMP_REQUEUE_PI	12
+#define FUTEX_WAIT_MULTIPLE	13
+#define FUTEX_WAKE_MULTIPLE	14
 
 #define FUTEX_PRIVATE_FLAG	128
 #define FUTEX_CLOCK_REALTIME	256
@@ -39,6 +41,32 @@
 					 FUTEX_PRIVATE_FLAG)
 #define FUTEX_CMP_REQUEUE_PI_PRIVATE	(FUTEX_CMP_REQUEUE_PI | \
 					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAIT_MULTIPLE_PRIVATE	(FUTEX_WAIT_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAKE_MULTIPLE_PRIVATE	(FUTEX_WAKE_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+
+/*
+ * Array element for FUTEX_WAIT_MULTIPLE and FUTEX_WAKE_MULTIPLE.  uaddr
+ * of the syscall points to an array of these and val is its length.
+ *
+ * FUTEX_WAIT_MULTIPLE blocks until one of the futexes is woken, if each
+ * futex word still holds its @val, and returns the lowest index that was
+ * woken.  The timeout is relative, as for FUTEX_WAIT.
+ *
+ * FUTEX_WAKE_MULTIPLE wakes up to @val waiters on each futex and returns
+ * the total number woken.
+ *
+ * @uaddr is 64 bits wide so that the layout is the same for 32-bit and
+ * 64-bit tasks.
+ */
+struct futex_vector {
+	__u64 uaddr;
+	__u32 val;
+	__u32 bitset;
+};
+
+#define FUTEX_VECTOR_MAX	128
 
 /*
  * Support for robust futexes: the kernel cleans up held futexes at
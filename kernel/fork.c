@@ -553,6 +553,13 @@ static void mm_init_aio(struct mm_struct *mm)
 #endif
 }
 
+static void mm_init_futex(struct mm_struct *mm)
+{
+#ifdef CONFIG_FUTEX
+	mm->futex_hash = NULL;
+#endif
+}
+
 static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 {
 	atomic_set(&mm->mm_users, 1);
@@ -568,6 +575,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	mm->free_area_cache = TASK_UNMAPPED_BASE;
 	mm->cached_hole_size = ~0UL;
 	mm_init_aio(mm);
+	mm_init_futex(mm);
 	mm_init_owner(mm, p);
 	clear_tlb_flush_pending(mm);
 
@@ -626,6 +634,7 @@ void __mmdrop(struct mm_struct *mm)
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
 	check_mm(mm);
+	futex_mm_free(mm);
 	free_mm(mm);
 }
 EXPORT_SYMBOL_GPL(__mmdrop);
@@ -916,6 +925,8 @@ static int copy_mm(unsigned long clone_flags, struct task_struct *tsk)
 		return 0;
 
 	if (clone_flags & CLONE_VM) {
+		if (!(clone_flags & CLONE_VFORK))
+			futex_mm_share(oldmm);
 		atomic_inc(&oldmm->mm_users);
 		mm = oldmm;
 		goto good_mm;
@@ -63,6 +63,8 @@
 #include <linux/sched/rt.h>
 #include <linux/hugetlb.h>
 #include <linux/freezer.h>
+#include <linux/bootmem.h>
+#include <linux/log2.h>
 
 #include <asm/futex.h>
 
@@ -72,7 +74,14 @@
 int __read_mostly futex_cmpxchg_enabled;
 #endif
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
+/*
+ * The global hash is sized at boot from the number of possible CPUs.
+ * With kernel.futex_private_hash set, a process that starts sharing its
+ * mm also gets a small table of its own for FUTEX_PRIVATE_FLAG futexes,
+ * so that its waiters do not share bucket locks with other processes.
+ */
+static unsigned long __read_mostly futex_hashsize;
+int sysctl_futex_private_hash __read_mostly;
 
 /*
  * Futex flags used to encode options to functions and preserve them across
@@ -151,19 +160,69 @@ static const struct futex_q futex_q_init = {
 struct futex_hash_bucket {
 	spinlock_t lock;
 	struct plist_head chain;
-};
+} ____cacheline_aligned_in_smp;
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static struct futex_hash_bucket *futex_queues;
 
 /*
  * We hash on the keys returned from get_futex_key (see below).
+ * Private keys go to the table of their mm, if it has one.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct mm_struct *mm = key->private.mm;
+
+		if (mm->futex_hash)
+			return &mm->futex_hash[hash & mm->futex_hash_mask];
+	}
+	return &futex_queues[hash & (futex_hashsize - 1)];
+}
+
+static void futex_hash_init(struct futex_hash_bucket *hb, unsigned long size)
+{
+	unsigned long i;
+
+	for (i = 0; i < size; i++) {
+		plist_head_init(&hb[i].chain);
+		spin_lock_init(&hb[i].lock);
+	}
+}
+
+/*
+ * Called from fork when @mm is about to get a second user.  Private
+ * futexes of @mm can only be queued by its users, so while the caller
+ * is the only one there are no waiters that could be stranded in the
+ * global table by switching.  Once set up, the table stays for the
+ * life of the mm; if that is not possible the global table is used.
+ */
+void futex_mm_share(struct mm_struct *mm)
+{
+	struct futex_hash_bucket *hb;
+	unsigned long size;
+
+	if (!sysctl_futex_private_hash || mm->futex_hash ||
+	    atomic_read(&mm->mm_users) != 1)
+		return;
+
+	size = roundup_pow_of_two(4 * num_online_cpus());
+	size = clamp(size, 16UL, 256UL);
+	hb = kmalloc(size * sizeof(*hb), GFP_KERNEL | __GFP_NOWARN);
+	if (!hb)
+		return;
+
+	futex_hash_init(hb, size);
+	mm->futex_hash_mask = size - 1;
+	mm->futex_hash = hb;
+}
+
+void futex_mm_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
 }
 
 /*
@@ -1078,6 +1137,33 @@ double_unlock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 		spin_unlock(&hb2->lock);
 }
 
+/*
+ * Wake up to nr_wake waiters matching bitset queued on key.  The caller
+ * holds hb->lock.
+ */
+static int __futex_wake(struct futex_hash_bucket *hb, union futex_key *key,
+			int nr_wake, u32 bitset)
+{
+	struct futex_q *this, *next;
+	int ret = 0;
+
+	plist_for_each_entry_safe(this, next, &hb->chain, list) {
+		if (match_futex (&this->key, key)) {
+			if (this->pi_state || this->rt_waiter)
+				return -EINVAL;
+
+			/* Check if one of the bits is set in both bitsets */
+			if (!(this->bitset & bitset))
+				continue;
+
+			wake_futex(this);
+			if (++ret >= nr_wake)
+				break;
+		}
+	}
+	return ret;
+}
+
 /*
  * Wake up waiters matching bitset queued on this futex (uaddr).
  */
@@ -1085,8 +1171,6 @@ static int
 futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 {
 	struct futex_hash_bucket *hb;
-	struct futex_q *this, *next;
-	struct plist_head *head;
 	union futex_key key = FUTEX_KEY_INIT;
 	int ret;
 
@@ -1099,28 +1183,100 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 
 	hb = hash_futex(&key);
 	spin_lock(&hb->lock);
-	head = &hb->chain;
+	ret = __futex_wake(hb, &key, nr_wake, bitset);
+	spin_unlock(&hb->lock);
+	put_futex_key(&key);
+out:
+	return ret;
+}
 
-	plist_for_each_entry_safe(this, next, head, list) {
-		if (match_futex (&this->key, &key)) {
-			if (this->pi_state || this->rt_waiter) {
-				ret = -EINVAL;
-				break;
-			}
+/*
+ * Copy in and check the array of a FUTEX_*_MULTIPLE operation.
+ */
+static struct futex_vector *futex_vector_copy(void __user *uvec, u32 count)
+{
+	struct futex_vector *vs;
+	u32 i;
 
-			/* Check if one of the bits is set in both bitsets */
-			if (!(this->bitset & bitset))
-				continue;
+	if (!count || count > FUTEX_VECTOR_MAX)
+		return ERR_PTR(-EINVAL);
 
-			wake_futex(this);
-			if (++ret >= nr_wake)
-				break;
+	vs = memdup_user(uvec, count * sizeof(*vs));
+	if (IS_ERR(vs))
+		return vs;
+
+	for (i = 0; i < count; i++) {
+		if (!vs[i].bitset ||
+		    vs[i].uaddr != (unsigned long)vs[i].uaddr) {
+			kfree(vs);
+			return ERR_PTR(-EINVAL);
 		}
 	}
+	return vs;
+}
 
-	spin_unlock(&hb->lock);
-	put_futex_key(&key);
-out:
+static inline u32 __user *futex_vector_uaddr(struct futex_vector *v)
+{
+	return (u32 __user *)(unsigned long)v->uaddr;
+}
+
+/*
+ * Wake waiters on several futexes in one call.  All keys are looked up
+ * first, so a bad address fails the whole call before anything is woken.
+ * The hash bucket lock is kept across consecutive futexes that share a
+ * bucket, e.g. when the same futex appears more than once.
+ */
+static int futex_wake_multiple(void __user *uvec, unsigned int flags,
+			       u32 count)
+{
+	struct futex_hash_bucket *hb, *locked = NULL;
+	struct futex_vector *vs;
+	union futex_key *keys;
+	u32 i, nr_keys = 0;
+	int ret, woken = 0;
+
+	vs = futex_vector_copy(uvec, count);
+	if (IS_ERR(vs))
+		return PTR_ERR(vs);
+
+	ret = -ENOMEM;
+	keys = kmalloc(count * sizeof(*keys), GFP_KERNEL);
+	if (!keys)
+		goto out_free;
+
+	for (; nr_keys < count; nr_keys++) {
+		keys[nr_keys] = FUTEX_KEY_INIT;
+		ret = get_futex_key(futex_vector_uaddr(&vs[nr_keys]),
+				    flags & FLAGS_SHARED, &keys[nr_keys],
+				    VERIFY_READ);
+		if (unlikely(ret != 0))
+			goto out_put;
+	}
+
+	for (i = 0; i < count; i++) {
+		hb = hash_futex(&keys[i]);
+		if (hb != locked) {
+			if (locked)
+				spin_unlock(&locked->lock);
+			spin_lock(&hb->lock);
+			locked = hb;
+		}
+		ret = __futex_wake(hb, &keys[i], vs[i].val, vs[i].bitset);
+		if (ret < 0)
+			break;
+		woken += ret;
+	}
+	if (locked)
+		spin_unlock(&locked->lock);
+	if (ret >= 0)
+		ret = woken;
+
+out_put:
+	while (nr_keys--)
+		put_futex_key(&keys[nr_keys]);
+	kfree(keys);
+out_free:
+	kfree(vs);
 	return ret;
 }
 
@@ -2107,6 +2263,170 @@ static long futex_wait_restart(struct restart_block *restart)
 				restart->futex.val, tp, restart->futex.bitset);
 }
 
+/**
+ * futex_wait_multiple_setup() - Queue on every futex of a vector
+ * @vs:		the futex vector
+ * @count:	number of entries in @vs and @qs
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @qs:		one futex_q per entry, with the bitsets set up
+ * @woken:	the lowest index woken while backing out, or -1
+ *
+ * Each futex is set up and queued in turn, exactly as futex_wait() does for
+ * one.  If a futex word does not hold its expected value, or faults, the
+ * ones queued so far are unqueued again.  One of them may have been woken
+ * meanwhile; that wakeup was consumed and is reported through @woken.
+ *
+ * Return:
+ *  0 - all futexes are queued
+ * <0 - none is queued
+ */
+static int futex_wait_multiple_setup(struct futex_vector *vs, u32 count,
+				     unsigned int flags, struct futex_q *qs,
+				     int *woken)
+{
+	struct futex_hash_bucket *hb;
+	u32 i;
+	int ret = 0;
+
+	*woken = -1;
+	for (i = 0; i < count; i++) {
+		ret = futex_wait_setup(futex_vector_uaddr(&vs[i]), vs[i].val,
+				       flags, &qs[i], &hb);
+		if (ret)
+			break;
+		queue_me(&qs[i], hb);
+	}
+	if (!ret)
+		return 0;
+
+	while (i--) {
+		if (!unqueue_me(&qs[i]))
+			*woken = i;
+	}
+	return ret;
+}
+
+static long futex_wait_multiple_restart(struct restart_block *restart);
+
+static int futex_wait_multiple(void __user *uvec, unsigned int flags,
+			       u32 count, ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to = NULL;
+	struct restart_block *restart;
+	struct futex_vector *vs;
+	struct futex_q *qs;
+	int ret, woken;
+	u32 i;
+
+	vs = futex_vector_copy(uvec, count);
+	if (IS_ERR(vs))
+		return PTR_ERR(vs);
+
+	qs = kmalloc(count * sizeof(*qs), GFP_KERNEL);
+	if (!qs) {
+		kfree(vs);
+		return -ENOMEM;
+	}
+	for (i = 0; i < count; i++) {
+		qs[i] = futex_q_init;
+		qs[i].bitset = vs[i].bitset;
+	}
+
+	if (abs_time) {
+		to = &timeout;
+
+		hrtimer_init_on_stack(&to->timer, CLOCK_MONOTONIC,
+				      HRTIMER_MODE_ABS);
+		hrtimer_init_sleeper(to, current);
+		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
+					     current->timer_slack_ns);
+	}
+
+retry:
+	ret = futex_wait_multiple_setup(vs, count, flags, qs, &woken);
+	if (ret) {
+		if (woken >= 0)
+			ret = woken;
+		goto out;
+	}
+
+	/* Arm the timer */
+	if (to) {
+		hrtimer_start_expires(&to->timer, HRTIMER_MODE_ABS);
+		if (!hrtimer_active(&to->timer))
+			to->task = NULL;
+	}
+
+	/*
+	 * The task state is set after queueing because futex_wait_setup() may
+	 * fault and sleep.  A wakeup that came in before this point has
+	 * already removed its futex_q from the hash list, one that comes in
+	 * after it sets us running again; see futex_wait_queue_me().
+	 */
+	set_current_state(TASK_INTERRUPTIBLE);
+	for (i = 0; i < count; i++) {
+		if (plist_node_empty(&qs[i].list))
+			break;
+	}
+	if (i == count && (!to || to->task))
+		freezable_schedule();
+	__set_current_state(TASK_RUNNING);
+
+	/* unqueue_me() drops the key refs; report the lowest index woken */
+	woken = -1;
+	for (i = count; i--; ) {
+		if (!unqueue_me(&qs[i]))
+			woken = i;
+	}
+	ret = woken;
+	if (woken >= 0)
+		goto out;
+	ret = -ETIMEDOUT;
+	if (to && !to->task)
+		goto out;
+
+	/* Spurious wakeup, or a signal */
+	if (!signal_pending(current))
+		goto retry;
+
+	ret = -ERESTARTSYS;
+	if (!abs_time)
+		goto out;
+
+	restart = &current_thread_info()->restart_block;
+	restart->fn = futex_wait_multiple_restart;
+	restart->futex.uaddr = uvec;
+	restart->futex.val = count;
+	restart->futex.time = abs_time->tv64;
+	restart->futex.flags = flags | FLAGS_HAS_TIMEOUT;
+
+	ret = -ERESTART_RESTARTBLOCK;
+
+out:
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+	kfree(qs);
+	kfree(vs);
+	return ret;
+}
+
+static long futex_wait_multiple_restart(struct restart_block *restart)
+{
+	void __user *uvec = restart->futex.uaddr;
+	ktime_t t, *tp = NULL;
+
+	if (restart->futex.flags & FLAGS_HAS_TIMEOUT) {
+		t.tv64 = restart->futex.time;
+		tp = &t;
+	}
+	restart->fn = do_no_restart_syscall;
+
+	return (long)futex_wait_multiple(uvec, restart->futex.flags,
+					 restart->futex.val, tp);
+}
+
 
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
@@ -2832,6 +3152,10 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 					     uaddr2);
 	case FUTEX_CMP_REQUEUE_PI:
 		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple(uaddr, flags, val, timeout);
+	case FUTEX_WAKE_MULTIPLE:
+		return futex_wake_multiple(uaddr, flags, val);
 	}
 	return -ENOSYS;
 }
@@ -2848,14 +3172,15 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
 			return -EFAULT;
 		if (!timespec_valid(&ts))
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -2892,14 +3217,24 @@ static void __init futex_detect_cmpxchg(void)
 
 static int __init futex_init(void)
 {
-	int i;
+	unsigned int futex_shift;
+
+#if CONFIG_BASE_SMALL
+	futex_hashsize = 16;
+#else
+	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+#endif
+
+	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
+					       futex_hashsize, 0,
+					       futex_hashsize < 256 ? HASH_SMALL : 0,
+					       &futex_shift, NULL,
+					       futex_hashsize, futex_hashsize);
+	futex_hashsize = 1UL << futex_shift;
 
 	futex_detect_cmpxchg();
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	futex_hash_init(futex_queues, futex_hashsize);
 
 	return 0;
 }
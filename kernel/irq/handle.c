@@ -68,6 +68,21 @@ static void irq_wake_thread(struct irq_desc *desc, struct irqaction *action)
 	if (test_and_set_bit(IRQTF_RUNTHREAD, &action->thread_flags))
 		return;
 
+#ifdef CONFIG_SMP
+	/*
+	 * Let the thread follow the cpu which handled the primary
+	 * interrupt, so the threaded handler finds the device data in
+	 * that cpu's cache. The thread moves itself in
+	 * irq_thread_check_affinity().
+	 */
+	if (!(desc->istate & IRQS_NO_THREAD_FOLLOW) &&
+	    action->thread_cpu != smp_processor_id()) {
+		action->thread_cpu = smp_processor_id();
+		set_bit(IRQTF_AFFINITY, &action->thread_flags);
+	}
+#endif
+	irq_stats_wake(action);
+
 	/*
 	 * It's safe to OR the mask lockless here. We have only two
 	 * places which write to threads_oneshot: This code and the
@@ -183,14 +198,17 @@ irqreturn_t handle_irq_event(struct irq_desc *desc)
 {
 	struct irqaction *action = desc->action;
 	irqreturn_t ret;
+	u64 start;
 
 	desc->istate &= ~IRQS_PENDING;
 	irqd_set(&desc->irq_data, IRQD_IRQ_INPROGRESS);
 	raw_spin_unlock(&desc->lock);
 
+	start = irq_stats_start();
 	ret = handle_irq_event_percpu(desc, action);
 
 	raw_spin_lock(&desc->lock);
+	irq_stats_hardirq(desc, start);
 	irqd_clear(&desc->irq_data, IRQD_IRQ_INPROGRESS);
 	return ret;
 }
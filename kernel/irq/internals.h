@@ -6,6 +6,9 @@
  * of this file for your non core code.
  */
 #include <linux/irqdesc.h>
+#include <linux/sched.h>
+
+struct seq_file;
 
 #ifdef CONFIG_SPARSE_IRQ
 # define IRQ_BITMAP_BITS	(NR_IRQS + 8196)
@@ -43,6 +46,8 @@ enum {
  * IRQS_WAITING			- irq is waiting
  * IRQS_PENDING			- irq is pending and replayed later
  * IRQS_SUSPENDED		- irq is suspended
+ * IRQS_NO_THREAD_FOLLOW	- irq threads do not follow the cpu the
+ *				  interrupt is delivered to
  */
 enum {
 	IRQS_AUTODETECT		= 0x00000001,
@@ -53,6 +58,7 @@ enum {
 	IRQS_WAITING		= 0x00000080,
 	IRQS_PENDING		= 0x00000200,
 	IRQS_SUSPENDED		= 0x00000800,
+	IRQS_NO_THREAD_FOLLOW	= 0x00001000,
 };
 
 #include "debug.h"
@@ -101,6 +107,15 @@ extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
 
+#ifdef CONFIG_SMP
+extern int irq_set_followers(struct irq_desc *desc, const pid_t *pids,
+			     unsigned int nr);
+extern void irq_show_followers(struct seq_file *m, struct irq_desc *desc);
+#else
+static inline int irq_set_followers(struct irq_desc *desc, const pid_t *pids,
+				    unsigned int nr) { return 0; }
+#endif
+
 extern int irq_do_set_affinity(struct irq_data *data,
 			       const struct cpumask *dest, bool force);
 
@@ -179,3 +194,53 @@ static inline bool irqd_has_set(struct irq_data *d, unsigned int mask)
 {
 	return d->state_use_accessors & mask;
 }
+
+#ifdef CONFIG_IRQ_HANDLER_STATS
+/*
+ * Handler time accounting. The primary handlers of one flow are
+ * accounted as a single interval, so the cost is two clock reads per
+ * interrupt no matter how many actions share the line.
+ */
+static inline u64 irq_stats_start(void)
+{
+	return local_clock();
+}
+
+/* Called with desc->lock held */
+static inline void irq_stats_hardirq(struct irq_desc *desc, u64 start)
+{
+	u64 delta = local_clock() - start;
+
+	desc->hardirq_count++;
+	desc->hardirq_time += delta;
+	if (delta > desc->hardirq_max)
+		desc->hardirq_max = delta;
+}
+
+static inline void irq_stats_wake(struct irqaction *action)
+{
+	action->thread_woken = local_clock();
+}
+
+static inline u64 irq_stats_thread_start(struct irqaction *action)
+{
+	u64 now = local_clock();
+	s64 latency = now - action->thread_woken;
+
+	if (latency > 0 && (u64)latency > action->thread_latency_max)
+		action->thread_latency_max = latency;
+	return now;
+}
+
+static inline void irq_stats_thread_end(struct irqaction *action, u64 start)
+{
+	action->thread_count++;
+	action->thread_time += local_clock() - start;
+}
+#else
+static inline u64 irq_stats_start(void) { return 0; }
+static inline void irq_stats_hardirq(struct irq_desc *desc, u64 start) { }
+static inline void irq_stats_wake(struct irqaction *action) { }
+static inline u64 irq_stats_thread_start(struct irqaction *action) { return 0; }
+static inline void irq_stats_thread_end(struct irqaction *action, u64 start) { }
+#endif
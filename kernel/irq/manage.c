@@ -10,6 +10,7 @@
 #define pr_fmt(fmt) "genirq: " fmt
 
 #include <linux/irq.h>
+#include <linux/cpuset.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/random.h>
@@ -17,6 +18,7 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/sched/rt.h>
+#include <linux/seq_file.h>
 #include <linux/task_work.h>
 
 #include "internals.h"
@@ -721,6 +723,189 @@ out_unlock:
 }
 
 #ifdef CONFIG_SMP
+/*
+ * Tasks which are moved along with the irq threads, typically the
+ * consumers of the data the interrupt delivers. They are set from
+ * /proc/irq/<irq>/thread_followers. The affinity a follower had before
+ * it was first moved is given back when it stops following.
+ */
+struct irq_follower {
+	struct pid		*pid;
+	cpumask_var_t		saved_mask;
+	bool			moved;
+};
+
+struct irq_followers {
+	unsigned int		nr;
+	struct irq_follower	ent[];
+};
+
+static DEFINE_MUTEX(irq_followers_mutex);
+
+static void irq_free_followers(struct irq_followers *f)
+{
+	unsigned int i;
+
+	if (!f)
+		return;
+	for (i = 0; i < f->nr; i++) {
+		free_cpumask_var(f->ent[i].saved_mask);
+		put_pid(f->ent[i].pid);
+	}
+	kfree(f);
+}
+
+/*
+ * Put the followers back where they were before they were first moved,
+ * within what their cpuset allows today.
+ */
+static void irq_restore_followers(struct irq_followers *f)
+{
+	struct irq_follower *ent;
+	struct task_struct *p;
+	cpumask_var_t mask;
+	unsigned int i;
+
+	if (!f || !alloc_cpumask_var(&mask, GFP_KERNEL))
+		return;
+	for (i = 0; i < f->nr; i++) {
+		ent = &f->ent[i];
+		if (!ent->moved)
+			continue;
+		p = get_pid_task(ent->pid, PIDTYPE_PID);
+		if (!p)
+			continue;
+		cpuset_cpus_allowed(p, mask);
+		if (cpumask_intersects(mask, ent->saved_mask))
+			cpumask_and(mask, mask, ent->saved_mask);
+		set_cpus_allowed_ptr(p, mask);
+		put_task_struct(p);
+	}
+	free_cpumask_var(mask);
+}
+
+static int irq_follower_init(struct irq_follower *ent, pid_t nr)
+{
+	struct task_struct *p;
+	int ret = 0;
+
+	ent->pid = find_get_pid(nr);
+	if (!ent->pid)
+		return -ESRCH;
+	if (!alloc_cpumask_var(&ent->saved_mask, GFP_KERNEL))
+		return -ENOMEM;
+
+	p = get_pid_task(ent->pid, PIDTYPE_PID);
+	if (!p)
+		return -ESRCH;
+	/* Same rule as sched_setaffinity() */
+	if (p->flags & PF_NO_SETAFFINITY)
+		ret = -EINVAL;
+	put_task_struct(p);
+	return ret;
+}
+
+/**
+ *	irq_set_followers - replace the tasks following the irq threads
+ *	@desc:		irq descriptor
+ *	@pids:		pids of the tasks, in the caller's namespace
+ *	@nr:		number of entries in @pids, 0 to clear
+ *
+ *	The followers are moved to the cpus of the irq threads the next
+ *	time a thread of this interrupt runs. Tasks which are no longer
+ *	followers get their previous affinity back.
+ */
+int irq_set_followers(struct irq_desc *desc, const pid_t *pids,
+		      unsigned int nr)
+{
+	struct irq_followers *new = NULL, *old;
+	unsigned long flags;
+	int ret;
+
+	if (nr) {
+		new = kzalloc(sizeof(*new) + nr * sizeof(new->ent[0]),
+			      GFP_KERNEL);
+		if (!new)
+			return -ENOMEM;
+		for (new->nr = 0; new->nr < nr; new->nr++) {
+			ret = irq_follower_init(&new->ent[new->nr],
+						pids[new->nr]);
+			if (ret) {
+				new->nr++;
+				irq_free_followers(new);
+				return ret;
+			}
+		}
+	}
+
+	mutex_lock(&irq_followers_mutex);
+	old = desc->followers;
+	desc->followers = new;
+	irq_restore_followers(old);
+	mutex_unlock(&irq_followers_mutex);
+	irq_free_followers(old);
+
+	if (new) {
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		irq_set_thread_affinity(desc);
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+	return 0;
+}
+
+void irq_show_followers(struct seq_file *m, struct irq_desc *desc)
+{
+	struct irq_followers *f;
+	unsigned int i;
+
+	mutex_lock(&irq_followers_mutex);
+	f = desc->followers;
+	for (i = 0; f && i < f->nr; i++)
+		seq_printf(m, "%s%d", i ? " " : "", pid_vnr(f->ent[i].pid));
+	mutex_unlock(&irq_followers_mutex);
+	seq_putc(m, '\n');
+}
+
+/*
+ * Followers stay inside their cpuset: if it does not overlap @mask the
+ * follower is left alone.
+ */
+static void irq_move_followers(struct irq_desc *desc,
+			       const struct cpumask *mask)
+{
+	struct irq_follower *ent;
+	struct irq_followers *f;
+	struct task_struct *p;
+	cpumask_var_t allowed;
+	unsigned int i;
+
+	if (!alloc_cpumask_var(&allowed, GFP_KERNEL))
+		return;
+
+	mutex_lock(&irq_followers_mutex);
+	f = desc->followers;
+	for (i = 0; f && i < f->nr; i++) {
+		ent = &f->ent[i];
+		p = get_pid_task(ent->pid, PIDTYPE_PID);
+		if (!p)
+			continue;
+		if (p->flags & PF_NO_SETAFFINITY)
+			goto next;
+		cpuset_cpus_allowed(p, allowed);
+		if (!cpumask_and(allowed, allowed, mask))
+			goto next;
+		if (!ent->moved) {
+			cpumask_copy(ent->saved_mask, tsk_cpus_allowed(p));
+			ent->moved = true;
+		}
+		set_cpus_allowed_ptr(p, allowed);
+next:
+		put_task_struct(p);
+	}
+	mutex_unlock(&irq_followers_mutex);
+	free_cpumask_var(allowed);
+}
+
 /*
  * Check whether we need to chasnge the affinity of the interrupt thread.
  */
@@ -728,6 +913,7 @@ static void
 irq_thread_check_affinity(struct irq_desc *desc, struct irqaction *action)
 {
 	cpumask_var_t mask;
+	unsigned int cpu;
 	bool valid = true;
 
 	if (!test_and_clear_bit(IRQTF_AFFINITY, &action->thread_flags))
@@ -747,14 +933,27 @@ irq_thread_check_affinity(struct irq_desc *desc, struct irqaction *action)
 	 * This code is triggered unconditionally. Check the affinity
 	 * mask pointer. For CPU_MASK_OFFSTACK=n this is optimized out.
 	 */
-	if (desc->irq_data.affinity)
+	if (desc->irq_data.affinity) {
 		cpumask_copy(mask, desc->irq_data.affinity);
-	else
+		/*
+		 * Narrow the mask down to the cpu which took the
+		 * interrupt last, as long as that is still a valid
+		 * target. See irq_wake_thread().
+		 */
+		cpu = action->thread_cpu;
+		if (!(desc->istate & IRQS_NO_THREAD_FOLLOW) &&
+		    cpu < nr_cpu_ids && cpumask_test_cpu(cpu, mask) &&
+		    cpu_online(cpu))
+			cpumask_copy(mask, cpumask_of(cpu));
+	} else
 		valid = false;
 	raw_spin_unlock_irq(&desc->lock);
 
-	if (valid)
+	if (valid) {
 		set_cpus_allowed_ptr(current, mask);
+		if (ACCESS_ONCE(desc->followers))
+			irq_move_followers(desc, mask);
+	}
 	free_cpumask_var(mask);
 }
 #else
@@ -857,10 +1056,13 @@ static int irq_thread(void *data)
 
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
+		u64 start;
 
 		irq_thread_check_affinity(desc, action);
 
+		start = irq_stats_thread_start(action);
 		action_ret = handler_fn(desc, action);
+		irq_stats_thread_end(action, start);
 		if (action_ret == IRQ_HANDLED)
 			atomic_inc(&desc->threads_handled);
 
@@ -968,6 +1170,10 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		 * on which the requesting code placed the interrupt.
 		 */
 		set_bit(IRQTF_AFFINITY, &new->thread_flags);
+#ifdef CONFIG_SMP
+		/* Not woken yet, so there is no cpu to follow */
+		new->thread_cpu = nr_cpu_ids;
+#endif
 	}
 
 	if (!alloc_cpumask_var(&mask, GFP_KERNEL)) {
@@ -1294,6 +1500,10 @@ static struct irqaction *__free_irq(unsigned int irq, void *dev_id)
 		put_task_struct(action->thread);
 	}
 
+	/* Nothing left to follow */
+	if (!desc->action)
+		irq_set_followers(desc, NULL, 0);
+
 	module_put(desc->owner);
 	return action;
 }
@@ -13,6 +13,8 @@
 #include <linux/interrupt.h>
 #include <linux/kernel_stat.h>
 #include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
 
 #include "internals.h"
 
@@ -243,6 +245,189 @@ static const struct file_operations irq_node_proc_fops = {
 	.llseek		= seq_lseek,
 	.release	= single_release,
 };
+
+static int irq_thread_follow_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "%d\n", !(desc->istate & IRQS_NO_THREAD_FOLLOW));
+	return 0;
+}
+
+static ssize_t irq_thread_follow_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE_DATA(file_inode(file));
+	struct irq_desc *desc = irq_to_desc(irq);
+	unsigned long flags;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &val);
+	if (err)
+		return err;
+	if (val > 1)
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	if (val)
+		desc->istate &= ~IRQS_NO_THREAD_FOLLOW;
+	else
+		desc->istate |= IRQS_NO_THREAD_FOLLOW;
+	irq_set_thread_affinity(desc);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return count;
+}
+
+static int irq_thread_follow_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_thread_follow_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_thread_follow_proc_fops = {
+	.open		= irq_thread_follow_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_thread_follow_proc_write,
+};
+
+#define IRQ_MAX_FOLLOWERS	16
+
+static int irq_followers_proc_show(struct seq_file *m, void *v)
+{
+	irq_show_followers(m, irq_to_desc((long) m->private));
+	return 0;
+}
+
+/*
+ * Takes a whitespace separated list of pids, which replaces the
+ * current followers. An empty list removes them all.
+ */
+static ssize_t irq_followers_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE_DATA(file_inode(file));
+	pid_t pids[IRQ_MAX_FOLLOWERS];
+	unsigned int nr = 0;
+	char *buf, *p, *tok;
+	int err;
+
+	if (count >= PAGE_SIZE)
+		return -EINVAL;
+
+	buf = kmalloc(count + 1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	if (copy_from_user(buf, buffer, count)) {
+		err = -EFAULT;
+		goto out;
+	}
+	buf[count] = '\0';
+
+	p = buf;
+	while ((tok = strsep(&p, " \t\n"))) {
+		if (!*tok)
+			continue;
+		if (nr == IRQ_MAX_FOLLOWERS) {
+			err = -E2BIG;
+			goto out;
+		}
+		err = kstrtoint(tok, 10, &pids[nr]);
+		if (err)
+			goto out;
+		if (pids[nr] <= 0) {
+			err = -EINVAL;
+			goto out;
+		}
+		nr++;
+	}
+
+	err = irq_set_followers(irq_to_desc(irq), pids, nr);
+	if (!err)
+		err = count;
+out:
+	kfree(buf);
+	return err;
+}
+
+static int irq_followers_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_followers_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_followers_proc_fops = {
+	.open		= irq_followers_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_followers_proc_write,
+};
+#endif
+
+#ifdef CONFIG_IRQ_HANDLER_STATS
+static int irq_handler_time_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irqaction *action;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	seq_printf(m, "hardirq count %lu time %llu ns max %llu ns\n",
+		   desc->hardirq_count, desc->hardirq_time, desc->hardirq_max);
+	for (action = desc->action; action; action = action->next) {
+		if (!action->thread)
+			continue;
+		seq_printf(m, "thread %s count %lu time %llu ns "
+			   "latency_max %llu ns\n", action->name,
+			   action->thread_count, action->thread_time,
+			   action->thread_latency_max);
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+	return 0;
+}
+
+/* Any write resets the statistics */
+static ssize_t irq_handler_time_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE_DATA(file_inode(file));
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irqaction *action;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	desc->hardirq_count = 0;
+	desc->hardirq_time = 0;
+	desc->hardirq_max = 0;
+	/*
+	 * The thread fields are updated by the threads without the
+	 * lock, so a concurrently running handler can leave a partial
+	 * interval behind.
+	 */
+	for (action = desc->action; action; action = action->next) {
+		action->thread_count = 0;
+		action->thread_time = 0;
+		action->thread_latency_max = 0;
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return count;
+}
+
+static int irq_handler_time_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_handler_time_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_handler_time_proc_fops = {
+	.open		= irq_handler_time_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_handler_time_proc_write,
+};
 #endif
 
 static int irq_spurious_proc_show(struct seq_file *m, void *v)
@@ -349,6 +534,20 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 
 	proc_create_data("node", 0444, desc->dir,
 			 &irq_node_proc_fops, (void *)(long)irq);
+
+	/* create /proc/irq/<irq>/thread_follow */
+	proc_create_data("thread_follow", 0600, desc->dir,
+			 &irq_thread_follow_proc_fops, (void *)(long)irq);
+
+	/* create /proc/irq/<irq>/thread_followers */
+	proc_create_data("thread_followers", 0600, desc->dir,
+			 &irq_followers_proc_fops, (void *)(long)irq);
+#endif
+
+#ifdef CONFIG_IRQ_HANDLER_STATS
+	/* create /proc/irq/<irq>/handler_time */
+	proc_create_data("handler_time", 0600, desc->dir,
+			 &irq_handler_time_proc_fops, (void *)(long)irq);
 #endif
 
 	proc_create_data("spurious", 0444, desc->dir,
@@ -369,6 +568,11 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("affinity_hint", desc->dir);
 	remove_proc_entry("smp_affinity_list", desc->dir);
 	remove_proc_entry("node", desc->dir);
+	remove_proc_entry("thread_follow", desc->dir);
+	remove_proc_entry("thread_followers", desc->dir);
+#endif
+#ifdef CONFIG_IRQ_HANDLER_STATS
+	remove_proc_entry("handler_time", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
 
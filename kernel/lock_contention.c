@@ -0,0 +1,335 @@
+/*
+ * kernel/lock_contention.c
+ *
+ * Lightweight lock contention profiling
+ *
+ * CONFIG_LOCK_STAT needs lockdep and is far too heavy for a shipped
+ * kernel.  This only looks at the contended slowpath of spinlocks,
+ * rwlocks, mutexes and rwsems: an uncontended acquisition pays one flag
+ * test, a contended one is timed with local_clock() and accounted to its
+ * call site in a fixed-size table that is updated without locks.
+ *
+ * /proc/lock_contention lists the call sites by total wait time.  Writing
+ * 1 or 0 to it starts or stops profiling, writing "clear" to it while
+ * profiling is stopped resets the table.  "lock_contention" on the
+ * command line starts profiling at boot.  The lock:contention_begin and
+ * lock:contention_end trace events report individual contentions, and
+ * keep the slowpath hooks active while they are enabled.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/export.h>
+#include <linux/hash.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/atomic.h>
+#include <asm/uaccess.h>
+
+/* With lockdep, kernel/lockdep.c instantiates the lock trace events. */
+#ifndef CONFIG_LOCKDEP
+#define CREATE_TRACE_POINTS
+#endif
+#include <trace/events/lock.h>
+
+#define LC_HASH_BITS	10
+#define LC_SITES	(1 << LC_HASH_BITS)
+#define LC_PROBES	16
+
+struct lc_site {
+	unsigned long	ip;		/* call site, 0 if the slot is free */
+	void		*lock;		/* last lock contended at this site */
+	atomic_long_t	count;
+	atomic64_t	wait_total;	/* ns */
+	atomic64_t	wait_max;	/* ns */
+};
+
+static struct lc_site lc_sites[LC_SITES];
+static atomic_long_t lc_dropped;	/* contentions that found no slot */
+
+int lock_contention_enabled __read_mostly;
+EXPORT_SYMBOL(lock_contention_enabled);
+
+static bool lc_recording;
+static int lc_tracers;
+static DEFINE_MUTEX(lc_mutex);
+
+static void lc_update(void)
+{
+	ACCESS_ONCE(lock_contention_enabled) = lc_recording || lc_tracers;
+}
+
+void lock_contention_trace_reg(void)
+{
+	mutex_lock(&lc_mutex);
+	lc_tracers++;
+	lc_update();
+	mutex_unlock(&lc_mutex);
+}
+
+void lock_contention_trace_unreg(void)
+{
+	mutex_lock(&lc_mutex);
+	lc_tracers--;
+	lc_update();
+	mutex_unlock(&lc_mutex);
+}
+
+static struct lc_site *lc_find(unsigned long ip)
+{
+	unsigned long hash = hash_long(ip, LC_HASH_BITS);
+	int i;
+
+	for (i = 0; i < LC_PROBES; i++) {
+		struct lc_site *site = &lc_sites[(hash + i) & (LC_SITES - 1)];
+		unsigned long cur = ACCESS_ONCE(site->ip);
+
+		if (!cur)
+			cur = cmpxchg(&site->ip, 0UL, ip) ?: ip;
+		if (cur == ip)
+			return site;
+	}
+	return NULL;
+}
+
+static void lc_account(void *lock, unsigned long ip, u64 wait)
+{
+	struct lc_site *site;
+	u64 max, old;
+
+	/* lets lock_contention_clear() wait for us with synchronize_sched() */
+	preempt_disable();
+
+	site = lc_find(ip);
+	if (!site) {
+		atomic_long_inc(&lc_dropped);
+		goto out;
+	}
+
+	site->lock = lock;
+	atomic_long_inc(&site->count);
+	atomic64_add(wait, &site->wait_total);
+
+	max = atomic64_read(&site->wait_max);
+	while (wait > max) {
+		old = atomic64_cmpxchg(&site->wait_max, max, wait);
+		if (old == max)
+			break;
+		max = old;
+	}
+out:
+	preempt_enable();
+}
+
+/*
+ * Called when a lock is found taken.  Returns the start of the wait, to
+ * be passed to lock_contention_end() once the lock is held; never 0, so
+ * callers can use it as a "contended" flag.
+ */
+u64 lock_contention_begin(void *lock, unsigned long ip)
+{
+	trace_contention_begin(lock, ip);
+	return local_clock() ?: 1;
+}
+EXPORT_SYMBOL(lock_contention_begin);
+
+void lock_contention_end(void *lock, unsigned long ip, u64 start)
+{
+	u64 now = local_clock();
+	/* a sleeping lock may have migrated us to a cpu whose clock lags */
+	u64 wait = now > start ? now - start : 0;
+
+	trace_contention_end(lock, ip, wait);
+	if (ACCESS_ONCE(lc_recording))
+		lc_account(lock, ip, wait);
+}
+EXPORT_SYMBOL(lock_contention_end);
+
+static int __init lock_contention_setup(char *str)
+{
+	lc_recording = true;
+	lc_update();
+	return 1;
+}
+__setup("lock_contention", lock_contention_setup);
+
+#ifdef CONFIG_PROC_FS
+
+struct lc_stat {
+	unsigned long	ip;
+	void		*lock;
+	unsigned long	count;
+	u64		wait_total;
+	u64		wait_max;
+};
+
+struct lc_seq {
+	struct lc_stat	*end;
+	struct lc_stat	stats[LC_SITES];
+};
+
+static int lc_stat_cmp(const void *l, const void *r)
+{
+	const struct lc_stat *sl = l, *sr = r;
+
+	if (sl->wait_total == sr->wait_total)
+		return 0;
+	return sl->wait_total < sr->wait_total ? 1 : -1;
+}
+
+static void *lc_start(struct seq_file *m, loff_t *pos)
+{
+	struct lc_seq *data = m->private;
+	struct lc_stat *iter;
+
+	if (*pos == 0)
+		return SEQ_START_TOKEN;
+
+	iter = data->stats + (*pos - 1);
+	if (iter >= data->end)
+		iter = NULL;
+
+	return iter;
+}
+
+static void *lc_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	(*pos)++;
+	return lc_start(m, pos);
+}
+
+static void lc_stop(struct seq_file *m, void *v)
+{
+}
+
+static int lc_show(struct seq_file *m, void *v)
+{
+	struct lc_stat *stat = v;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_printf(m, "profiling: %s, dropped: %ld\n",
+			   lc_recording ? "on" : "off",
+			   atomic_long_read(&lc_dropped));
+		seq_printf(m, "%12s %16s %14s %14s  %s\n", "contentions",
+			   "wait-total(ns)", "wait-max(ns)", "wait-avg(ns)",
+			   "site [last lock]");
+		return 0;
+	}
+
+	seq_printf(m, "%12lu %16llu %14llu %14llu  %pS [%p]\n",
+		   stat->count, stat->wait_total, stat->wait_max,
+		   div64_u64(stat->wait_total, stat->count),
+		   (void *)stat->ip, stat->lock);
+	return 0;
+}
+
+static const struct seq_operations lc_ops = {
+	.start	= lc_start,
+	.next	= lc_next,
+	.stop	= lc_stop,
+	.show	= lc_show,
+};
+
+static int lock_contention_open(struct inode *inode, struct file *file)
+{
+	struct lc_seq *data = vmalloc(sizeof(struct lc_seq));
+	struct lc_stat *iter;
+	int i, res;
+
+	if (!data)
+		return -ENOMEM;
+
+	res = seq_open(file, &lc_ops);
+	if (res) {
+		vfree(data);
+		return res;
+	}
+
+	iter = data->stats;
+	for (i = 0; i < LC_SITES; i++) {
+		struct lc_site *site = &lc_sites[i];
+
+		iter->count = atomic_long_read(&site->count);
+		if (!iter->count)
+			continue;
+		iter->ip = ACCESS_ONCE(site->ip);
+		iter->lock = ACCESS_ONCE(site->lock);
+		iter->wait_total = atomic64_read(&site->wait_total);
+		iter->wait_max = atomic64_read(&site->wait_max);
+		iter++;
+	}
+	data->end = iter;
+
+	sort(data->stats, data->end - data->stats, sizeof(struct lc_stat),
+	     lc_stat_cmp, NULL);
+
+	((struct seq_file *)file->private_data)->private = data;
+	return 0;
+}
+
+static ssize_t lock_contention_write(struct file *file,
+				     const char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	char buf[8];
+	size_t len = min(count, sizeof(buf) - 1);
+	ssize_t ret = count;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+	strim(buf);
+
+	mutex_lock(&lc_mutex);
+	if (!strcmp(buf, "1")) {
+		lc_recording = true;
+	} else if (!strcmp(buf, "0")) {
+		lc_recording = false;
+	} else if (!strcmp(buf, "clear")) {
+		if (lc_recording) {
+			ret = -EBUSY;
+		} else {
+			/* wait for lc_account() calls still in flight */
+			synchronize_sched();
+			memset(lc_sites, 0, sizeof(lc_sites));
+			atomic_long_set(&lc_dropped, 0);
+		}
+	} else {
+		ret = -EINVAL;
+	}
+	lc_update();
+	mutex_unlock(&lc_mutex);
+
+	return ret;
+}
+
+static int lock_contention_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+
+	vfree(seq->private);
+	return seq_release(inode, file);
+}
+
+static const struct file_operations proc_lock_contention_operations = {
+	.open		= lock_contention_open,
+	.write		= lock_contention_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= lock_contention_release,
+};
+
+static int __init lock_contention_proc_init(void)
+{
+	proc_create("lock_contention", S_IRUSR | S_IWUSR, NULL,
+		    &proc_lock_contention_operations);
+	return 0;
+}
+__initcall(lock_contention_proc_init);
+
+#endif /* CONFIG_PROC_FS */
@@ -0,0 +1,445 @@
+/*
+ * Module-based torture test facility for locking
+ *
+ * Hammers one lock from a set of writer kthreads and, for lock types
+ * with a shared mode, a set of reader kthreads.  Mutual exclusion is
+ * checked on every acquisition, and the number of acquisitions of each
+ * thread is reported every stat_interval seconds and at module unload,
+ * so that throughput (the totals) and fairness (the spread between the
+ * least and the most successful thread) can be compared between lock
+ * types and kernels.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/err.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/delay.h>
+#include <linux/slab.h>
+#include <linux/atomic.h>
+#include <linux/jiffies.h>
+
+MODULE_LICENSE("GPL");
+
+static int nwriters_stress = -1; /* # writer threads, defaults to 2*ncpus */
+static int nreaders_stress = -1; /* # reader threads, defaults to 2*ncpus */
+static int stat_interval = 60;	/* Interval between stats, in seconds. */
+static int hold_us = 5;		/* Time spent holding the lock (us). */
+static int think_us = 5;	/* Time spent between acquisitions (us). */
+static char *torture_type = "rwsem_lock"; /* What lock to torture. */
+
+module_param(nwriters_stress, int, 0444);
+MODULE_PARM_DESC(nwriters_stress, "Number of write-locking stress-test threads");
+module_param(nreaders_stress, int, 0444);
+MODULE_PARM_DESC(nreaders_stress, "Number of read-locking stress-test threads");
+module_param(stat_interval, int, 0644);
+MODULE_PARM_DESC(stat_interval, "Number of seconds between stats printk()s");
+module_param(hold_us, int, 0444);
+MODULE_PARM_DESC(hold_us, "Critical section length (us)");
+module_param(think_us, int, 0444);
+MODULE_PARM_DESC(think_us, "Delay between acquisitions (us)");
+module_param(torture_type, charp, 0444);
+MODULE_PARM_DESC(torture_type,
+		 "Type of lock to torture (spin_lock, ticket_lock, mutex_lock, rwsem_lock)");
+
+#define TORTURE_FLAG "-torture:"
+#define PRINTK_STRING(s) \
+	do { pr_alert("%s" TORTURE_FLAG s "\n", torture_type); } while (0)
+
+struct lock_stress_stats {
+	long n_acquired;
+	long n_errors;
+};
+
+struct lock_torture_ops {
+	void (*writelock)(void);
+	void (*writeunlock)(void);
+	void (*readlock)(void);		/* NULL if there is no shared mode */
+	void (*readunlock)(void);
+	const char *name;
+};
+
+static struct lock_torture_ops *cur_ops;
+
+static struct task_struct **writer_tasks;
+static struct task_struct **reader_tasks;
+static struct task_struct *stats_task;
+static struct lock_stress_stats *writer_stats;
+static struct lock_stress_stats *reader_stats;
+static unsigned long start_jiffies;
+
+static bool lock_is_write_held;
+static atomic_t lock_readers = ATOMIC_INIT(0);
+
+/*
+ * Definitions for spinlock torture testing.
+ */
+static DEFINE_SPINLOCK(torture_spinlock);
+
+static void torture_spin_lock_write_lock(void)
+{
+	spin_lock(&torture_spinlock);
+}
+
+static void torture_spin_lock_write_unlock(void)
+{
+	spin_unlock(&torture_spinlock);
+}
+
+static struct lock_torture_ops spin_lock_ops = {
+	.writelock	= torture_spin_lock_write_lock,
+	.writeunlock	= torture_spin_lock_write_unlock,
+	.name		= "spin_lock"
+};
+
+/*
+ * Definitions for ticket lock torture testing.  A plain ticket lock on
+ * an atomic_t, with the next ticket in the upper and the owner in the
+ * lower halfword, so that a kernel built with CONFIG_QUEUED_SPINLOCKS
+ * can compare its spin_lock against the kind of lock it replaced.
+ */
+#define TORTURE_TICKET_SHIFT	16
+#define TORTURE_TICKET_MASK	((1U << TORTURE_TICKET_SHIFT) - 1)
+
+static atomic_t torture_ticket_lock = ATOMIC_INIT(0);
+
+static void torture_ticket_lock_write_lock(void)
+{
+	u32 ticket;
+
+	preempt_disable();
+	ticket = atomic_add_return(1 << TORTURE_TICKET_SHIFT,
+				   &torture_ticket_lock);
+	ticket = ((ticket >> TORTURE_TICKET_SHIFT) - 1) & TORTURE_TICKET_MASK;
+	while ((atomic_read(&torture_ticket_lock) & TORTURE_TICKET_MASK) !=
+	       ticket)
+		cpu_relax();
+	smp_mb();
+}
+
+static void torture_ticket_lock_write_unlock(void)
+{
+	u32 old, new;
+
+	smp_mb();
+	do {
+		old = atomic_read(&torture_ticket_lock);
+		new = (old & ~TORTURE_TICKET_MASK) |
+		      ((old + 1) & TORTURE_TICKET_MASK);
+	} while (atomic_cmpxchg(&torture_ticket_lock, old, new) != old);
+	preempt_enable();
+}
+
+static struct lock_torture_ops ticket_lock_ops = {
+	.writelock	= torture_ticket_lock_write_lock,
+	.writeunlock	= torture_ticket_lock_write_unlock,
+	.name		= "ticket_lock"
+};
+
+/*
+ * Definitions for mutex torture testing.
+ */
+static DEFINE_MUTEX(torture_mutex);
+
+static void torture_mutex_lock(void)
+{
+	mutex_lock(&torture_mutex);
+}
+
+static void torture_mutex_unlock(void)
+{
+	mutex_unlock(&torture_mutex);
+}
+
+static struct lock_torture_ops mutex_lock_ops = {
+	.writelock	= torture_mutex_lock,
+	.writeunlock	= torture_mutex_unlock,
+	.name		= "mutex_lock"
+};
+
+/*
+ * Definitions for rwsem torture testing.
+ */
+static DECLARE_RWSEM(torture_rwsem);
+
+static void torture_rwsem_down_write(void)
+{
+	down_write(&torture_rwsem);
+}
+
+static void torture_rwsem_up_write(void)
+{
+	up_write(&torture_rwsem);
+}
+
+static void torture_rwsem_down_read(void)
+{
+	down_read(&torture_rwsem);
+}
+
+static void torture_rwsem_up_read(void)
+{
+	up_read(&torture_rwsem);
+}
+
+static struct lock_torture_ops rwsem_lock_ops = {
+	.writelock	= torture_rwsem_down_write,
+	.writeunlock	= torture_rwsem_up_write,
+	.readlock	= torture_rwsem_down_read,
+	.readunlock	= torture_rwsem_up_read,
+	.name		= "rwsem_lock"
+};
+
+/*
+ * Lock torture writer kthread.  Repeatedly takes the lock exclusively
+ * and checks that nobody else holds it.
+ */
+static int lock_torture_writer(void *arg)
+{
+	struct lock_stress_stats *lwsp = arg;
+
+	set_user_nice(current, 19);
+
+	do {
+		cur_ops->writelock();
+		if (ACCESS_ONCE(lock_is_write_held) ||
+		    atomic_read(&lock_readers))
+			lwsp->n_errors++;
+		lock_is_write_held = true;
+		udelay(hold_us);
+		lock_is_write_held = false;
+		cur_ops->writeunlock();
+		lwsp->n_acquired++;
+
+		udelay(think_us);
+		cond_resched();
+	} while (!kthread_should_stop());
+
+	return 0;
+}
+
+/*
+ * Lock torture reader kthread.  Repeatedly takes the lock shared and
+ * checks that no writer holds it.
+ */
+static int lock_torture_reader(void *arg)
+{
+	struct lock_stress_stats *lrsp = arg;
+
+	set_user_nice(current, 19);
+
+	do {
+		cur_ops->readlock();
+		atomic_inc(&lock_readers);
+		if (ACCESS_ONCE(lock_is_write_held))
+			lrsp->n_errors++;
+		udelay(hold_us);
+		atomic_dec(&lock_readers);
+		cur_ops->readunlock();
+		lrsp->n_acquired++;
+
+		udelay(think_us);
+		cond_resched();
+	} while (!kthread_should_stop());
+
+	return 0;
+}
+
+static void __lock_torture_print_stats(const char *kind,
+				       struct lock_stress_stats *statp, int n)
+{
+	long sum = 0, lo = LONG_MAX, hi = 0, errors = 0;
+	unsigned long secs;
+	int i;
+
+	if (!n)
+		return;
+
+	for (i = 0; i < n; i++) {
+		sum += statp[i].n_acquired;
+		errors += statp[i].n_errors;
+		lo = min(lo, statp[i].n_acquired);
+		hi = max(hi, statp[i].n_acquired);
+	}
+
+	secs = max(1UL, (jiffies - start_jiffies) / HZ);
+	pr_alert("%s%s %s: Total: %ld (%ld/s) Min/Max: %ld/%ld %s Errors: %ld %s\n",
+		 torture_type, TORTURE_FLAG, kind, sum, sum / (long)secs,
+		 lo, hi, hi > lo * 2 ? "???" : "", errors,
+		 errors ? "!!!" : "");
+}
+
+/*
+ * Print torture statistics.  A Min/Max spread of more than a factor of
+ * two is flagged with "???", an exclusion failure with "!!!".
+ */
+static void lock_torture_stats_print(void)
+{
+	__lock_torture_print_stats("Writes", writer_stats, nwriters_stress);
+	if (cur_ops->readlock)
+		__lock_torture_print_stats("Reads", reader_stats,
+					   nreaders_stress);
+}
+
+static int lock_torture_stats(void *unused)
+{
+	do {
+		schedule_timeout_interruptible(stat_interval * HZ);
+		lock_torture_stats_print();
+	} while (!kthread_should_stop());
+
+	return 0;
+}
+
+static bool lock_torture_failed(void)
+{
+	int i;
+
+	for (i = 0; i < nwriters_stress; i++)
+		if (writer_stats[i].n_errors)
+			return true;
+	for (i = 0; reader_stats && i < nreaders_stress; i++)
+		if (reader_stats[i].n_errors)
+			return true;
+	return false;
+}
+
+static void lock_torture_stop_tasks(struct task_struct **tasks, int n)
+{
+	int i;
+
+	if (!tasks)
+		return;
+	for (i = 0; i < n; i++)
+		if (tasks[i])
+			kthread_stop(tasks[i]);
+	kfree(tasks);
+}
+
+static void lock_torture_cleanup(void)
+{
+	if (stats_task)
+		kthread_stop(stats_task);
+	stats_task = NULL;
+
+	lock_torture_stop_tasks(writer_tasks, nwriters_stress);
+	writer_tasks = NULL;
+	lock_torture_stop_tasks(reader_tasks, nreaders_stress);
+	reader_tasks = NULL;
+
+	if (writer_stats) {
+		lock_torture_stats_print();
+		if (lock_torture_failed())
+			PRINTK_STRING("End of test: FAILURE");
+		else
+			PRINTK_STRING("End of test: SUCCESS");
+	}
+
+	kfree(writer_stats);
+	writer_stats = NULL;
+	kfree(reader_stats);
+	reader_stats = NULL;
+}
+
+static int __init lock_torture_init(void)
+{
+	static struct lock_torture_ops *torture_ops[] = {
+		&spin_lock_ops, &ticket_lock_ops, &mutex_lock_ops,
+		&rwsem_lock_ops,
+	};
+	struct task_struct *t;
+	int i, firsterr = 0;
+
+	for (i = 0; i < ARRAY_SIZE(torture_ops); i++) {
+		cur_ops = torture_ops[i];
+		if (strcmp(torture_type, cur_ops->name) == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(torture_ops)) {
+		pr_alert("lock-torture: invalid torture type: \"%s\"\n",
+			 torture_type);
+		return -EINVAL;
+	}
+
+	if (nwriters_stress < 0)
+		nwriters_stress = 2 * num_online_cpus();
+	if (!cur_ops->readlock)
+		nreaders_stress = 0;
+	else if (nreaders_stress < 0)
+		nreaders_stress = 2 * num_online_cpus();
+
+	pr_alert("%s" TORTURE_FLAG
+		 "--- Start of test: nwriters_stress=%d nreaders_stress=%d "
+		 "stat_interval=%d hold_us=%d think_us=%d\n",
+		 torture_type, nwriters_stress, nreaders_stress,
+		 stat_interval, hold_us, think_us);
+
+	writer_stats = kcalloc(nwriters_stress, sizeof(writer_stats[0]),
+			       GFP_KERNEL);
+	writer_tasks = kcalloc(nwriters_stress, sizeof(writer_tasks[0]),
+			       GFP_KERNEL);
+	if (!writer_stats || !writer_tasks) {
+		firsterr = -ENOMEM;
+		goto unwind;
+	}
+	if (nreaders_stress) {
+		reader_stats = kcalloc(nreaders_stress,
+				       sizeof(reader_stats[0]), GFP_KERNEL);
+		reader_tasks = kcalloc(nreaders_stress,
+				       sizeof(reader_tasks[0]), GFP_KERNEL);
+		if (!reader_stats || !reader_tasks) {
+			firsterr = -ENOMEM;
+			goto unwind;
+		}
+	}
+
+	start_jiffies = jiffies;
+
+	for (i = 0; i < nwriters_stress; i++) {
+		t = kthread_run(lock_torture_writer, &writer_stats[i],
+				"lock_torture_writer");
+		if (IS_ERR(t)) {
+			firsterr = PTR_ERR(t);
+			goto unwind;
+		}
+		writer_tasks[i] = t;
+	}
+
+	for (i = 0; i < nreaders_stress; i++) {
+		t = kthread_run(lock_torture_reader, &reader_stats[i],
+				"lock_torture_reader");
+		if (IS_ERR(t)) {
+			firsterr = PTR_ERR(t);
+			goto unwind;
+		}
+		reader_tasks[i] = t;
+	}
+
+	if (stat_interval > 0) {
+		t = kthread_run(lock_torture_stats, NULL, "lock_torture_stats");
+		if (IS_ERR(t)) {
+			firsterr = PTR_ERR(t);
+			goto unwind;
+		}
+		stats_task = t;
+	}
+
+	return 0;
+
+unwind:
+	lock_torture_cleanup();
+	return firsterr;
+}
+
+module_init(lock_torture_init);
+module_exit(lock_torture_cleanup);
@@ -129,6 +129,12 @@ void panic(const char *fmt, ...)
 	 */
 	smp_send_stop();
 
+	/*
+	 * A stopped CPU may have held the console; take it over so that
+	 * the dumpers and notifiers below get their output through.
+	 */
+	console_flush_on_panic();
+
 	kmsg_dump(KMSG_DUMP_PANIC);
 
 	atomic_notifier_call_chain(&panic_notifier_list, 0, buf);
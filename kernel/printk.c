@@ -44,6 +44,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 
 #include <asm/uaccess.h>
@@ -1497,13 +1498,38 @@ static size_t cont_print_text(char *text, size_t size)
 	return textlen;
 }
 
+/*
+ * Once the printk kthread runs, printk() only stores the record and the
+ * kthread prints it to the consoles, so callers are not held up by slow
+ * (serial) consoles. Booting, shutdown and oopses print synchronously,
+ * as does everything with printk.synchronous=1.
+ */
+static bool printk_sync;
+module_param_named(synchronous, printk_sync, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread;
+
+static void wake_up_printk_kthread(void);
+
+static inline bool printk_offload(void)
+{
+	return printk_kthread && !printk_sync && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING;
+}
+
+/*
+ * Messages are formatted into a per cpu buffer before logbuf_lock is
+ * taken, so the lock only covers storing the record.
+ */
+static DEFINE_PER_CPU(char [LOG_LINE_MAX], printk_textbuf);
+static DEFINE_PER_CPU(int, printk_formatting);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
 {
 	static int recursion_bug;
-	static char textbuf[LOG_LINE_MAX];
-	char *text = textbuf;
+	char *text;
 	size_t text_len;
 	enum log_flags lflags = 0;
 	unsigned long flags;
@@ -1535,6 +1561,24 @@ asmlinkage int vprintk_emit(int facility, int level,
 		zap_locks();
 	}
 
+	/*
+	 * A printk from within the formatting below, e.g. a WARN in a
+	 * %p handler, would clobber this cpu's buffer.
+	 */
+	if (unlikely(__this_cpu_read(printk_formatting)) && !oops_in_progress) {
+		recursion_bug = 1;
+		goto out_restore_irqs;
+	}
+
+	/*
+	 * The printf needs to come first; we need the syslog
+	 * prefix which might be passed-in as a parameter.
+	 */
+	__this_cpu_write(printk_formatting, 1);
+	text = __get_cpu_var(printk_textbuf);
+	text_len = vscnprintf(text, LOG_LINE_MAX, fmt, args);
+	__this_cpu_write(printk_formatting, 0);
+
 	lockdep_off();
 	raw_spin_lock(&logbuf_lock);
 	logbuf_cpu = this_cpu;
@@ -1550,12 +1594,6 @@ asmlinkage int vprintk_emit(int facility, int level,
 			  NULL, 0, recursion_msg, printed_len);
 	}
 
-	/*
-	 * The printf needs to come first; we need the syslog
-	 * prefix which might be passed-in as a parameter.
-	 */
-	text_len = vscnprintf(text, sizeof(textbuf), fmt, args);
-
 	/* mark and strip a trailing newline */
 	if (text_len && text[text_len-1] == '\n') {
 		text_len--;
@@ -1626,14 +1664,18 @@ asmlinkage int vprintk_emit(int facility, int level,
 	printed_len += text_len;
 
 	/*
-	 * Try to acquire and then immediately release the console semaphore.
-	 * The release will print out buffers and wake up /dev/kmsg and syslog()
-	 * users.
+	 * Leave the output to the printk kthread, or try to acquire and
+	 * then immediately release the console semaphore. The release will
+	 * print out buffers and wake up /dev/kmsg and syslog() users.
 	 *
 	 * The console_trylock_for_printk() function will release 'logbuf_lock'
 	 * regardless of whether it actually gets the console semaphore or not.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_offload()) {
+		logbuf_cpu = UINT_MAX;
+		raw_spin_unlock(&logbuf_lock);
+		wake_up_printk_kthread();
+	} else if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1721,6 +1763,7 @@ static u64 log_first_seq;
 static u32 log_first_idx;
 static u64 log_next_seq;
 static enum log_flags console_prev;
+static bool printk_sync;
 static struct cont {
 	size_t len;
 	size_t cons;
@@ -2194,11 +2237,21 @@ void console_unblank(void)
 void console_flush_on_panic(void)
 {
 	/*
-	 * If someone else is holding the console lock, trylock will fail
-	 * and may_schedule may be set.  Ignore and proceed to unlock so
-	 * that messages are flushed out.  As this can be called from any
-	 * context and we don't want to get preempted while flushing,
-	 * ensure may_schedule is cleared.
+	 * The other CPUs have been stopped, possibly with the printk
+	 * kthread in console_unlock() holding console_sem or logbuf_lock.
+	 * Nobody is going to release them, so start over, and print
+	 * whatever follows directly as the kthread will not run again.
+	 */
+	printk_sync = true;
+	if (raw_spin_is_locked(&logbuf_lock)) {
+		debug_locks_off();
+		raw_spin_lock_init(&logbuf_lock);
+	}
+	sema_init(&console_sem, 1);
+
+	/*
+	 * As this can be called from any context and we don't want to get
+	 * preempted while flushing, ensure may_schedule is cleared.
 	 */
 	console_trylock();
 	console_may_schedule = 0;
@@ -2496,6 +2549,7 @@ late_initcall(printk_late_init);
 
 #define PRINTK_PENDING_WAKEUP	0x01
 #define PRINTK_PENDING_SCHED	0x02
+#define PRINTK_PENDING_OUTPUT	0x04
 
 static DEFINE_PER_CPU(int, printk_pending);
 static DEFINE_PER_CPU(char [PRINTK_BUF_SIZE], printk_sched_buf);
@@ -2511,6 +2565,9 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_WAKEUP)
 		wake_up_interruptible(&log_wait);
+
+	if (pending & PRINTK_PENDING_OUTPUT)
+		wake_up_process(printk_kthread);
 }
 
 static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
@@ -2518,6 +2575,64 @@ static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) = {
 	.flags = IRQ_WORK_LAZY,
 };
 
+/*
+ * Not lazy, console output should not wait for the next tick. printk()
+ * may be called with any lock held, including the runqueue locks, so
+ * the printk kthread is woken from irq_work.
+ */
+static DEFINE_PER_CPU(struct irq_work, printk_output_work) = {
+	.func = wake_up_klogd_work_func,
+};
+
+static void wake_up_printk_kthread(void)
+{
+	this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	irq_work_queue(&__get_cpu_var(printk_output_work));
+}
+
+static bool console_output_pending(void)
+{
+	unsigned long flags;
+	bool pending;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	pending = console_seq != log_next_seq ||
+		  (cont.len && cont.cons != cont.len);
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return pending;
+}
+
+static int printk_kthread_func(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!console_output_pending() || console_suspended)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* console_lock() lets console_unlock() reschedule between lines */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *t;
+
+	t = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(t)) {
+		pr_err("printk: cannot start printk kthread, printing synchronously\n");
+		return PTR_ERR(t);
+	}
+	printk_kthread = t;
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 void wake_up_klogd(void)
 {
 	preempt_disable();
@@ -1699,12 +1699,25 @@ void rcu_torture_barrier_cbf(struct rcu_head *rcu)
 	atomic_inc(&barrier_cbs_invoked);
 }
 
+/*
+ * Move to the next online CPU, so that over successive barrier phases
+ * the test callbacks get queued on every CPU, no-CBs CPUs included.
+ */
+static void rcu_torture_barrier_cbs_next_cpu(int *cpu)
+{
+	*cpu = cpumask_next(*cpu, cpu_online_mask);
+	if (*cpu >= nr_cpu_ids)
+		*cpu = cpumask_first(cpu_online_mask);
+	set_cpus_allowed_ptr(current, cpumask_of(*cpu));
+}
+
 /* kthread function to register callbacks used to test RCU barriers. */
 static int rcu_torture_barrier_cbs(void *arg)
 {
 	long myid = (long)arg;
 	bool lastphase = 0;
 	struct rcu_head rcu;
+	int cpu = myid % nr_cpu_ids - 1;
 
 	init_rcu_head_on_stack(&rcu);
 	VERBOSE_PRINTK_STRING("rcu_torture_barrier_cbs task started");
@@ -1718,6 +1731,7 @@ static int rcu_torture_barrier_cbs(void *arg)
 		smp_mb(); /* ensure barrier_phase load before ->call(). */
 		if (kthread_should_stop() || fullstop != FULLSTOP_DONTSTOP)
 			break;
+		rcu_torture_barrier_cbs_next_cpu(&cpu);
 		cur_ops->call(&rcu, rcu_torture_barrier_cbf);
 		if (atomic_dec_and_test(&barrier_cbs_count))
 			wake_up(&barrier_wq);
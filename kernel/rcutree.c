@@ -51,7 +51,6 @@
 #include <linux/kthread.h>
 #include <linux/prefetch.h>
 #include <linux/delay.h>
-#include <linux/stop_machine.h>
 #include <linux/random.h>
 
 #include "rcutree.h"
@@ -75,6 +74,7 @@ static struct lock_class_key rcu_fqs_class[RCU_NUM_LVLS];
 	.orphan_donetail = &sname##_state.orphan_donelist, \
 	.barrier_mutex = __MUTEX_INITIALIZER(sname##_state.barrier_mutex), \
 	.onoff_mutex = __MUTEX_INITIALIZER(sname##_state.onoff_mutex), \
+	.expedited_mutex = __MUTEX_INITIALIZER(sname##_state.expedited_mutex), \
 	.name = #sname, \
 	.abbr = sabbr, \
 }
@@ -167,6 +167,38 @@ static int rcu_gp_in_progress(struct rcu_state *rsp)
 	return ACCESS_ONCE(rsp->completed) != ACCESS_ONCE(rsp->gpnum);
 }
 
+/*
+ * Report a quiescent state for the current expedited RCU-sched grace
+ * period on behalf of one CPU, waking up synchronize_sched_expedited()
+ * if this was the last CPU it was waiting on.  The atomic_dec_and_test()
+ * orders the CPU's prior RCU-sched read-side critical sections before
+ * the waiter's return.
+ */
+static void rcu_report_exp_sched_qs(struct rcu_state *rsp)
+{
+	if (atomic_dec_and_test(&rsp->expedited_need_qs))
+		wake_up(&rsp->expedited_wq);
+}
+
+/*
+ * This CPU was asked to pass through a quiescent state for an expedited
+ * grace period, and just did.  Interrupts are disabled so that the
+ * IPI handler and the scheduling-clock interrupt cannot race with a
+ * context switch on this CPU over ->exp_need_qs.
+ */
+static void rcu_sched_exp_qs(struct rcu_data *rdp)
+{
+	unsigned long flags;
+	bool report;
+
+	local_irq_save(flags);
+	report = rdp->exp_need_qs;
+	rdp->exp_need_qs = false;
+	local_irq_restore(flags);
+	if (report)
+		rcu_report_exp_sched_qs(rdp->rsp);
+}
+
 /*
  * Note a quiescent state.  Because we do not need to know
  * how many quiescent states passed, just if there was at least
@@ -180,6 +212,8 @@ void rcu_sched_qs(int cpu)
 	if (rdp->passed_quiesce == 0)
 		trace_rcu_grace_period("rcu_sched", rdp->gpnum, "cpuqs");
 	rdp->passed_quiesce = 1;
+	if (unlikely(ACCESS_ONCE(rdp->exp_need_qs)))
+		rcu_sched_exp_qs(rdp);
 }
 
 void rcu_bh_qs(int cpu)
@@ -195,12 +229,16 @@ void rcu_bh_qs(int cpu)
  * Note a context switch.  This is a quiescent state for RCU-sched,
  * and requires special handling for preemptible RCU.
  * The caller must have disabled preemption.
+ *
+ * A preempted RCU reader is queued before the RCU-sched quiescent state
+ * is noted: synchronize_rcu_expedited() relies on every reader running
+ * at the time being queued once synchronize_sched_expedited() returns.
  */
 void rcu_note_context_switch(int cpu)
 {
 	trace_rcu_utilization("Start context switch");
-	rcu_sched_qs(cpu);
 	rcu_preempt_note_context_switch(cpu);
+	rcu_sched_qs(cpu);
 	trace_rcu_utilization("End context switch");
 }
 EXPORT_SYMBOL_GPL(rcu_note_context_switch);
@@ -2560,30 +2598,33 @@ void synchronize_rcu_bh(void)
 }
 EXPORT_SYMBOL_GPL(synchronize_rcu_bh);
 
-static int synchronize_sched_expedited_cpu_stop(void *data)
+/*
+ * Interrupt handler for synchronize_sched_expedited().  An interrupt
+ * taken from the idle loop is itself a quiescent state, so report it
+ * straight away.  Otherwise the interrupted code might be within an
+ * RCU-sched read-side critical section, so ask for a reschedule and let
+ * the next pass through rcu_sched_qs() on this CPU report it.
+ */
+static void sync_sched_exp_handler(void *data)
 {
-	/*
-	 * There must be a full memory barrier on each affected CPU
-	 * between the time that try_stop_cpus() is called and the
-	 * time that it returns.
-	 *
-	 * In the current initial implementation of cpu_stop, the
-	 * above condition is already met when the control reaches
-	 * this point and the following smp_mb() is not strictly
-	 * necessary.  Do smp_mb() anyway for documentation and
-	 * robustness against future implementation changes.
-	 */
-	smp_mb(); /* See above comment block. */
-	return 0;
+	struct rcu_state *rsp = data;
+	struct rcu_data *rdp = this_cpu_ptr(rsp->rda);
+
+	if (rcu_is_cpu_rrupt_from_idle()) {
+		rcu_report_exp_sched_qs(rsp);
+		return;
+	}
+	rdp->exp_need_qs = true;
+	set_need_resched();
 }
 
 /**
  * synchronize_sched_expedited - Brute-force RCU-sched grace period
  *
  * Wait for an RCU-sched grace period to elapse, but use a "big hammer"
- * approach to force the grace period to end quickly.  This consumes
- * significant time on all CPUs and is unfriendly to real-time workloads,
- * so is thus not recommended for any sort of common-case code.  In fact,
+ * approach to force the grace period to end quickly.  This interrupts
+ * every non-idle CPU and is unfriendly to real-time workloads, so is
+ * thus not recommended for any sort of common-case code.  In fact,
  * if you are using synchronize_sched_expedited() in a loop, please
  * restructure your code to batch your updates, and then use a single
  * synchronize_sched() instead.
@@ -2593,31 +2634,30 @@ static int synchronize_sched_expedited_cpu_stop(void *data)
  * to call this function from a CPU-hotplug notifier.  Failing to observe
  * these restriction will result in deadlock.
  *
- * This implementation can be thought of as an application of ticket
- * locking to RCU, with sync_sched_expedited_started and
- * sync_sched_expedited_done taking on the roles of the halves
- * of the ticket-lock word.  Each task atomically increments
- * sync_sched_expedited_started upon entry, snapshotting the old value,
- * then attempts to stop all the CPUs.  If this succeeds, then each
- * CPU will have executed a context switch, resulting in an RCU-sched
- * grace period.  We are then done, so we use atomic_cmpxchg() to
- * update sync_sched_expedited_done to match our snapshot -- but
- * only if someone else has not already advanced past our snapshot.
+ * Each task atomically increments ->expedited_start upon entry, taking
+ * a ticket, and then acquires ->expedited_mutex.  If ->expedited_done
+ * has advanced past our ticket by then, someone else's grace period
+ * covered ours and we simply return.  Otherwise we refetch
+ * ->expedited_start, so that everyone who queued up on the mutex behind
+ * us can piggyback on this grace period, and force one:
+ *
+ * o	A CPU whose ->dynticks counter is even is idle, or in some other
+ *	extended quiescent state such as adaptive-ticks usermode, and
+ *	cannot be within an RCU-sched read-side critical section.  It is
+ *	left alone.
  *
- * On the other hand, if try_stop_cpus() fails, we check the value
- * of sync_sched_expedited_done.  If it has advanced past our
- * initial snapshot, then someone else must have forced a grace period
- * some time after we took our snapshot.  In this case, our work is
- * done for us, and we can simply return.  Otherwise, we try again,
- * but keep our initial snapshot for purposes of checking for someone
- * doing our work for us.
+ * o	Every other CPU gets an IPI.  If the IPI lands in the idle loop,
+ *	the CPU reports a quiescent state immediately, otherwise it
+ *	reports one at its next context switch, which the IPI forces.
  *
- * If we fail too many times in a row, we fall back to synchronize_sched().
+ * Once all CPUs have reported, ->expedited_done is advanced to the
+ * refetched ticket.  Idle and nohz CPUs are never woken, and no CPU
+ * busy-waits for the others as it would under stop_cpus().
  */
 void synchronize_sched_expedited(void)
 {
-	long firstsnap, s, snap;
-	int trycount = 0;
+	int cpu;
+	long snap;
 	struct rcu_state *rsp = &rcu_sched_state;
 
 	/*
@@ -2641,78 +2681,65 @@ void synchronize_sched_expedited(void)
 	 * full memory barrier.
 	 */
 	snap = atomic_long_inc_return(&rsp->expedited_start);
-	firstsnap = snap;
 	get_online_cpus();
 	WARN_ON_ONCE(cpu_is_offline(raw_smp_processor_id()));
+	mutex_lock(&rsp->expedited_mutex);
 
-	/*
-	 * Each pass through the following loop attempts to force a
-	 * context switch on each CPU.
-	 */
-	while (try_stop_cpus(cpu_online_mask,
-			     synchronize_sched_expedited_cpu_stop,
-			     NULL) == -EAGAIN) {
+	/* Check to see if someone else did our work for us. */
+	if (ULONG_CMP_GE((ulong)atomic_long_read(&rsp->expedited_done),
+			 (ulong)snap)) {
+		mutex_unlock(&rsp->expedited_mutex);
 		put_online_cpus();
-		atomic_long_inc(&rsp->expedited_tryfail);
-
-		/* Check to see if someone else did our work for us. */
-		s = atomic_long_read(&rsp->expedited_done);
-		if (ULONG_CMP_GE((ulong)s, (ulong)firstsnap)) {
-			/* ensure test happens before caller kfree */
-			smp_mb__before_atomic_inc(); /* ^^^ */
-			atomic_long_inc(&rsp->expedited_workdone1);
-			return;
-		}
+		/* ensure test happens before caller kfree */
+		smp_mb__before_atomic_inc(); /* ^^^ */
+		atomic_long_inc(&rsp->expedited_workdone);
+		return;
+	}
 
-		/* No joy, try again later.  Or just synchronize_sched(). */
-		if (trycount++ < 10) {
-			udelay(trycount * num_online_cpus());
-		} else {
-			wait_rcu_gp(call_rcu_sched);
-			atomic_long_inc(&rsp->expedited_normal);
-			return;
-		}
+	/*
+	 * Refetching ->expedited_start allows the callers waiting on
+	 * the mutex to piggyback on our grace period: they started before
+	 * the grace period does.
+	 */
+	snap = atomic_long_read(&rsp->expedited_start);
+	smp_mb(); /* ensure read is before the ->dynticks checks. */
 
-		/* Recheck to see if someone else did our work for us. */
-		s = atomic_long_read(&rsp->expedited_done);
-		if (ULONG_CMP_GE((ulong)s, (ulong)firstsnap)) {
-			/* ensure test happens before caller kfree */
-			smp_mb__before_atomic_inc(); /* ^^^ */
-			atomic_long_inc(&rsp->expedited_workdone2);
-			return;
-		}
+	/*
+	 * Hold one reference ourselves so that CPUs reporting while we are
+	 * still sending IPIs cannot drop the count to zero early.
+	 */
+	atomic_set(&rsp->expedited_need_qs, 1);
+	for_each_online_cpu(cpu) {
+		struct rcu_dynticks *rdtp = &per_cpu(rcu_dynticks, cpu);
 
 		/*
-		 * Refetching sync_sched_expedited_started allows later
-		 * callers to piggyback on our grace period.  We retry
-		 * after they started, so our grace period works for them,
-		 * and they started after our first try, so their grace
-		 * period works for us.
+		 * No need to interrupt the CPU we are running on: it has
+		 * passed through a quiescent state since we took our ticket
+		 * just by running us, even if we have since migrated.
 		 */
-		get_online_cpus();
-		snap = atomic_long_read(&rsp->expedited_start);
-		smp_mb(); /* ensure read is before try_stop_cpus(). */
+		if (cpu == raw_smp_processor_id())
+			continue;
+
+		/* Full barrier, pairs with rcu_eqs_{enter,exit}_common(). */
+		if (!(atomic_add_return(0, &rdtp->dynticks) & 0x1)) {
+			atomic_long_inc(&rsp->expedited_idle);
+			continue;
+		}
+		atomic_inc(&rsp->expedited_need_qs);
+		atomic_long_inc(&rsp->expedited_ipis);
+		smp_call_function_single(cpu, sync_sched_exp_handler, rsp, 0);
 	}
-	atomic_long_inc(&rsp->expedited_stoppedcpus);
+	rcu_report_exp_sched_qs(rsp);
+	wait_event(rsp->expedited_wq, !atomic_read(&rsp->expedited_need_qs));
+	smp_mb(); /* ensure the QS reports are before the caller's kfree. */
 
 	/*
 	 * Everyone up to our most recent fetch is covered by our grace
-	 * period.  Update the counter, but only if our work is still
-	 * relevant -- which it won't be if someone who started later
-	 * than we did already did their update.
+	 * period.  The mutex serializes updates and ->expedited_start
+	 * never goes backwards, so ->expedited_done only moves forward.
 	 */
-	do {
-		atomic_long_inc(&rsp->expedited_done_tries);
-		s = atomic_long_read(&rsp->expedited_done);
-		if (ULONG_CMP_GE((ulong)s, (ulong)snap)) {
-			/* ensure test happens before caller kfree */
-			smp_mb__before_atomic_inc(); /* ^^^ */
-			atomic_long_inc(&rsp->expedited_done_lost);
-			break;
-		}
-	} while (atomic_long_cmpxchg(&rsp->expedited_done, s, snap) != s);
-	atomic_long_inc(&rsp->expedited_done_exit);
-
+	atomic_long_set(&rsp->expedited_done, snap);
+	mutex_unlock(&rsp->expedited_mutex);
 	put_online_cpus();
 }
 EXPORT_SYMBOL_GPL(synchronize_sched_expedited);
@@ -3247,6 +3274,7 @@ static void __init rcu_init_one(struct rcu_state *rsp,
 
 	rsp->rda = rda;
 	init_waitqueue_head(&rsp->gp_wq);
+	init_waitqueue_head(&rsp->expedited_wq);
 	init_irq_work(&rsp->wakeup_work, rsp_wakeup);
 	rnp = rsp->level[rcu_num_lvls - 1];
 	for_each_possible_cpu(i) {
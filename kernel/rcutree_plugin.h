@@ -2011,6 +2011,35 @@ static int __init parse_rcu_nocb_poll(char *arg)
 }
 early_param("rcu_nocb_poll", parse_rcu_nocb_poll);
 
+#ifdef CONFIG_NO_HZ_FULL
+/*
+ * A full dynticks CPU cannot invoke its own callbacks without its tick,
+ * so offload them.  Called from start_kernel() once the nohz_full range
+ * is final, which is before any secondary CPU is brought up and before
+ * the rcuo kthreads are spawned.
+ */
+void __init rcu_init_nohz(void)
+{
+	if (!have_nohz_full_mask || cpumask_empty(tick_nohz_full_mask))
+		return;
+
+	if (!have_rcu_nocb_mask) {
+		if (!zalloc_cpumask_var(&rcu_nocb_mask, GFP_KERNEL)) {
+			pr_err("RCU: Can't allocate no-CBs cpumask for nohz_full\n");
+			return;
+		}
+		have_rcu_nocb_mask = true;
+	}
+
+	if (!cpumask_subset(tick_nohz_full_mask, rcu_nocb_mask)) {
+		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, tick_nohz_full_mask);
+		cpulist_scnprintf(nocb_buf, sizeof(nocb_buf), rcu_nocb_mask);
+		pr_info("RCU: no-CBs CPUs, with nohz_full: %s.\n",
+			nocb_buf);
+	}
+}
+#endif /* #ifdef CONFIG_NO_HZ_FULL */
+
 /*
  * Do any no-CBs CPUs need another grace period?
  *
@@ -2278,6 +2307,43 @@ static void __init rcu_spawn_nocb_kthreads(struct rcu_state *rsp)
 	}
 }
 
+/*
+ * Keep the rcuo kthreads off the no-CBs CPUs, so that the callback
+ * invocation they were offloaded for really lands on the housekeeping
+ * CPUs.  This runs once SMP is up: at spawn time only the boot CPU is
+ * online, and it may itself be a no-CBs CPU.  If every CPU is a no-CBs
+ * CPU there is nowhere better to go, and the kthreads are left alone.
+ * Userspace may still change the affinity later.
+ */
+static int __init rcu_nocb_affine_kthreads(void)
+{
+	int cpu;
+	cpumask_var_t housekeeping;
+	struct rcu_data *rdp;
+	struct rcu_state *rsp;
+
+	if (rcu_nocb_mask == NULL)
+		return 0;
+	if (!alloc_cpumask_var(&housekeeping, GFP_KERNEL))
+		return -ENOMEM;
+	cpumask_andnot(housekeeping, cpu_possible_mask, rcu_nocb_mask);
+	if (!cpumask_empty(housekeeping)) {
+		for_each_rcu_flavor(rsp) {
+			for_each_cpu(cpu, rcu_nocb_mask) {
+				rdp = per_cpu_ptr(rsp->rda, cpu);
+				if (rdp->nocb_kthread)
+					set_cpus_allowed_ptr(rdp->nocb_kthread,
+							     housekeeping);
+			}
+		}
+		cpulist_scnprintf(nocb_buf, sizeof(nocb_buf), housekeeping);
+		pr_info("RCU: no-CBs kthreads bound to CPUs %s.\n", nocb_buf);
+	}
+	free_cpumask_var(housekeeping);
+	return 0;
+}
+core_initcall(rcu_nocb_affine_kthreads);
+
 /* Prevent __call_rcu() from enqueuing callbacks on no-CBs CPUs */
 static bool init_nocb_callback_list(struct rcu_data *rdp)
 {
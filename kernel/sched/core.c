@@ -547,11 +547,15 @@ void resched_cpu(int cpu)
 #ifdef CONFIG_NO_HZ_COMMON
 /*
  * In the semi idle case, use the nearest busy cpu for migrating timers
- * from an idle cpu.  This is good for power-savings.
+ * from an idle cpu.  This is good for power-savings.  Full dynticks
+ * cpus are treated as idle: they should not take timers for others,
+ * and move their own unpinned timers away even while busy.
  *
  * We don't do similar optimization for completely idle system, as
  * selecting an idle cpu will add more delays to the timers than intended
- * (as that cpu's timer base may not be uptodate wrt jiffies etc).
+ * (as that cpu's timer base may not be uptodate wrt jiffies etc).  The
+ * exception is a full dynticks cpu, whose timers go to the first online
+ * housekeeping cpu, idle or not.
  */
 int get_nohz_timer_target(void)
 {
@@ -559,15 +563,27 @@ int get_nohz_timer_target(void)
 	int i;
 	struct sched_domain *sd;
 
+	if (!idle_cpu(cpu) && !tick_nohz_full_cpu(cpu))
+		return cpu;
+
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
-			if (!idle_cpu(i)) {
+			if (!idle_cpu(i) && !tick_nohz_full_cpu(i)) {
 				cpu = i;
 				goto unlock;
 			}
 		}
 	}
+
+	if (tick_nohz_full_cpu(cpu)) {
+		for_each_online_cpu(i) {
+			if (!tick_nohz_full_cpu(i)) {
+				cpu = i;
+				break;
+			}
+		}
+	}
 unlock:
 	rcu_read_unlock();
 	return cpu;
@@ -762,10 +778,216 @@ static void set_load_weight(struct task_struct *p)
 	load->inv_weight = prio_to_wmult[prio];
 }
 
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+/*
+ * Utilization clamping.
+ *
+ * The clamps of a task are those of its task group.  A task is accounted
+ * in the clamp buckets of its runqueue from enqueue to dequeue, so that
+ * the clamps of a cpu are those of the tasks runnable on it; cpufreq
+ * governors read them through sched_uclamp_cpu().
+ *
+ * Kernel threads are not accounted: they are housekeeping on behalf of
+ * everybody, and the governors' own sampling work would otherwise lift
+ * the cap of every cpu it runs on.
+ */
+static DEFINE_MUTEX(uclamp_mutex);
+static ATOMIC_NOTIFIER_HEAD(uclamp_notifier);
+
+void register_uclamp_notifier(struct notifier_block *n)
+{
+	atomic_notifier_chain_register(&uclamp_notifier, n);
+}
+EXPORT_SYMBOL_GPL(register_uclamp_notifier);
+
+void unregister_uclamp_notifier(struct notifier_block *n)
+{
+	atomic_notifier_chain_unregister(&uclamp_notifier, n);
+}
+EXPORT_SYMBOL_GPL(unregister_uclamp_notifier);
+
+void sched_uclamp_cpu(int cpu, unsigned int *min, unsigned int *max)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	*min = ACCESS_ONCE(rq->uclamp[UCLAMP_MIN].value);
+	*max = ACCESS_ONCE(rq->uclamp[UCLAMP_MAX].value);
+}
+EXPORT_SYMBOL_GPL(sched_uclamp_cpu);
+
+static inline unsigned int uclamp_none(int clamp_id)
+{
+	return clamp_id == UCLAMP_MIN ? 0 : 100;
+}
+
+static unsigned int uclamp_rq_value(struct rq *rq, int clamp_id)
+{
+	struct uclamp_bucket *bucket = rq->uclamp[clamp_id].bucket;
+	int id;
+
+	for (id = UCLAMP_BUCKETS - 1; id >= 0; id--) {
+		if (bucket[id].tasks)
+			return bucket[id].value;
+	}
+
+	return uclamp_none(clamp_id);
+}
+
+static void uclamp_rq_inc_id(struct rq *rq, struct task_struct *p,
+			     int clamp_id)
+{
+	struct uclamp_rq *uc_rq = &rq->uclamp[clamp_id];
+	struct uclamp_se *uc_se = &p->uclamp[clamp_id];
+	struct uclamp_bucket *bucket;
+	unsigned int old;
+
+	uc_se->value = task_group(p)->uclamp[clamp_id];
+	uc_se->active = 1;
+
+	bucket = &uc_rq->bucket[uc_se->value / UCLAMP_BUCKET_DELTA];
+	if (bucket->tasks++ && uc_se->value <= bucket->value)
+		return;
+
+	bucket->value = uc_se->value;
+	old = uc_rq->value;
+	uc_rq->value = uclamp_rq_value(rq, clamp_id);
+
+	if (clamp_id == UCLAMP_MIN && uc_rq->value > old)
+		atomic_notifier_call_chain(&uclamp_notifier, cpu_of(rq), NULL);
+}
+
+static void uclamp_rq_dec_id(struct rq *rq, struct task_struct *p,
+			     int clamp_id)
+{
+	struct uclamp_rq *uc_rq = &rq->uclamp[clamp_id];
+	struct uclamp_se *uc_se = &p->uclamp[clamp_id];
+	struct uclamp_bucket *bucket;
+
+	bucket = &uc_rq->bucket[uc_se->value / UCLAMP_BUCKET_DELTA];
+	uc_se->active = 0;
+
+	if (!--bucket->tasks)
+		uc_rq->value = uclamp_rq_value(rq, clamp_id);
+}
+
+static inline void uclamp_rq_inc(struct rq *rq, struct task_struct *p)
+{
+	int clamp_id;
+
+	if (p->flags & PF_KTHREAD)
+		return;
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++)
+		uclamp_rq_inc_id(rq, p, clamp_id);
+}
+
+static inline void uclamp_rq_dec(struct rq *rq, struct task_struct *p)
+{
+	int clamp_id;
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++) {
+		if (p->uclamp[clamp_id].active)
+			uclamp_rq_dec_id(rq, p, clamp_id);
+	}
+}
+
+/*
+ * Called from the tick for the running task, so that a change of the
+ * clamps of its group applies to tasks that never sleep.
+ */
+static void uclamp_task_tick(struct rq *rq, struct task_struct *p)
+{
+	int clamp_id;
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++) {
+		if (!p->uclamp[clamp_id].active ||
+		    p->uclamp[clamp_id].value == task_group(p)->uclamp[clamp_id])
+			continue;
+
+		uclamp_rq_dec_id(rq, p, clamp_id);
+		uclamp_rq_inc_id(rq, p, clamp_id);
+	}
+}
+
+static void __init init_uclamp(void)
+{
+	int clamp_id, i;
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++) {
+		root_task_group.uclamp_req[clamp_id] = uclamp_none(clamp_id);
+		root_task_group.uclamp[clamp_id] = uclamp_none(clamp_id);
+
+		for_each_possible_cpu(i)
+			cpu_rq(i)->uclamp[clamp_id].value = uclamp_none(clamp_id);
+	}
+}
+
+static void init_uclamp_group(struct task_group *tg)
+{
+	int clamp_id;
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++) {
+		tg->uclamp_req[clamp_id] = uclamp_none(clamp_id);
+		tg->uclamp[clamp_id] = uclamp_none(clamp_id);
+	}
+}
+
+/*
+ * A group is never boosted or allowed above the cap of its parent, and
+ * never boosted above its own cap.
+ */
+static int tg_update_uclamp(struct task_group *tg, void *data)
+{
+	unsigned int cap = tg->parent ? tg->parent->uclamp[UCLAMP_MAX] : 100;
+
+	tg->uclamp[UCLAMP_MAX] = min(tg->uclamp_req[UCLAMP_MAX], cap);
+	tg->uclamp[UCLAMP_MIN] = min(tg->uclamp_req[UCLAMP_MIN],
+				     tg->uclamp[UCLAMP_MAX]);
+	return 0;
+}
+
+static void online_uclamp_group(struct task_group *tg)
+{
+	mutex_lock(&uclamp_mutex);
+	tg_update_uclamp(tg, NULL);
+	mutex_unlock(&uclamp_mutex);
+}
+
+/*
+ * Tasks pick up the new clamps when they are next enqueued, or at the
+ * next tick if they are running.
+ */
+static int sched_group_set_uclamp(struct task_group *tg, int clamp_id,
+				  u64 value)
+{
+	if (tg == &root_task_group)
+		return -EINVAL;
+	if (value > 100)
+		return -ERANGE;
+
+	mutex_lock(&uclamp_mutex);
+	tg->uclamp_req[clamp_id] = value;
+	rcu_read_lock();
+	walk_tg_tree_from(tg, tg_update_uclamp, tg_nop, NULL);
+	rcu_read_unlock();
+	mutex_unlock(&uclamp_mutex);
+
+	return 0;
+}
+#else
+static inline void uclamp_rq_inc(struct rq *rq, struct task_struct *p) { }
+static inline void uclamp_rq_dec(struct rq *rq, struct task_struct *p) { }
+static inline void uclamp_task_tick(struct rq *rq, struct task_struct *p) { }
+static inline void init_uclamp(void) { }
+static inline void init_uclamp_group(struct task_group *tg) { }
+static inline void online_uclamp_group(struct task_group *tg) { }
+#endif /* CONFIG_UCLAMP_TASK_GROUP */
+
 static void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_queued(p);
+	uclamp_rq_inc(rq, p);
 	p->sched_class->enqueue_task(rq, p, flags);
 }
 
@@ -773,6 +995,7 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_dequeued(p);
+	uclamp_rq_dec(rq, p);
 	p->sched_class->dequeue_task(rq, p, flags);
 }
 
@@ -901,7 +1124,9 @@ static inline int normal_prio(struct task_struct *p)
 {
 	int prio;
 
-	if (task_has_rt_policy(p))
+	if (task_has_dl_policy(p))
+		prio = MAX_DL_PRIO-1;
+	else if (task_has_rt_policy(p))
 		prio = MAX_RT_PRIO-1 - p->rt_priority;
 	else
 		prio = __normal_prio(p);
@@ -945,7 +1170,7 @@ static inline void check_class_changed(struct rq *rq, struct task_struct *p,
 		if (prev_class->switched_from)
 			prev_class->switched_from(rq, p);
 		p->sched_class->switched_to(rq, p);
-	} else if (oldprio != p->prio)
+	} else if (oldprio != p->prio || dl_task(p))
 		p->sched_class->prio_changed(rq, p, oldprio);
 }
 
@@ -1627,8 +1852,22 @@ static void __sched_fork(struct task_struct *p)
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
 
+	RB_CLEAR_NODE(&p->dl.rb_node);
+	init_dl_task_timer(&p->dl);
+	p->dl.dl_runtime = p->dl.runtime = 0;
+	p->dl.dl_deadline = p->dl.deadline = 0;
+	p->dl.dl_period = 0;
+	p->dl.dl_bw = 0;
+	p->dl.dl_throttled = 0;
+	p->dl.dl_new = 1;
+
 	INIT_LIST_HEAD(&p->rt.run_list);
 
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	p->uclamp[UCLAMP_MIN].active = 0;
+	p->uclamp[UCLAMP_MAX].active = 0;
+#endif
+
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	INIT_HLIST_HEAD(&p->preempt_notifiers);
 #endif
@@ -1709,6 +1948,20 @@ void sched_fork(struct task_struct *p)
 		p->sched_reset_on_fork = 0;
 	}
 
+	/*
+	 * A deadline reservation is not inherited: it would have to pass
+	 * admission control again, and fork() has no way to report that
+	 * it did not.  Children of SCHED_DEADLINE tasks start out as
+	 * SCHED_NORMAL, as if SCHED_RESET_ON_FORK had been set.
+	 */
+	if (unlikely(task_has_dl_policy(p))) {
+		p->policy = SCHED_NORMAL;
+		p->static_prio = NICE_TO_PRIO(0);
+		p->rt_priority = 0;
+		p->prio = p->normal_prio = __normal_prio(p);
+		set_load_weight(p);
+	}
+
 	if (!rt_prio(p->prio))
 		p->sched_class = &fair_sched_class;
 
@@ -1739,6 +1992,7 @@ void sched_fork(struct task_struct *p)
 #endif
 #ifdef CONFIG_SMP
 	plist_node_init(&p->pushable_tasks, MAX_PRIO);
+	RB_CLEAR_NODE(&p->pushable_dl_tasks);
 #endif
 
 	put_cpu();
@@ -1904,6 +2158,9 @@ static void finish_task_switch(struct rq *rq, struct task_struct *prev)
 	if (mm)
 		mmdrop(mm);
 	if (unlikely(prev_state == TASK_DEAD)) {
+		if (prev->sched_class->task_dead)
+			prev->sched_class->task_dead(prev);
+
 		/*
 		 * Remove function-return probe instances associated with this
 		 * task and put them back on the free list.
@@ -2746,6 +3003,7 @@ void scheduler_tick(void)
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
+	uclamp_task_tick(rq, curr);
 	raw_spin_unlock(&rq->lock);
 
 	perf_event_task_tick();
@@ -3609,7 +3867,15 @@ void rt_mutex_setprio(struct task_struct *p, int prio)
 	struct rq *rq;
 	const struct sched_class *prev_class;
 
-	BUG_ON(prio < 0 || prio > MAX_PRIO);
+	BUG_ON(prio > MAX_PRIO);
+
+	/*
+	 * There is no deadline inheritance: a task holding a lock a
+	 * SCHED_DEADLINE task waits for is boosted to the highest RT
+	 * priority instead.
+	 */
+	if (dl_prio(prio) && !task_has_dl_policy(p))
+		prio = 0;
 
 	rq = __task_rq_lock(p);
 
@@ -3641,7 +3907,9 @@ void rt_mutex_setprio(struct task_struct *p, int prio)
 	if (running)
 		p->sched_class->put_prev_task(rq, p);
 
-	if (rt_prio(prio))
+	if (dl_prio(prio))
+		p->sched_class = &dl_sched_class;
+	else if (rt_prio(prio))
 		p->sched_class = &rt_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
@@ -3675,9 +3943,9 @@ void set_user_nice(struct task_struct *p, long nice)
 	 * The RT priorities are set via sched_setscheduler(), but we still
 	 * allow the 'normal' nice value to be set - but as expected
 	 * it wont have any effect on scheduling until the task is
-	 * SCHED_FIFO/SCHED_RR:
+	 * SCHED_FIFO/SCHED_RR/SCHED_DEADLINE:
 	 */
-	if (task_has_rt_policy(p)) {
+	if (task_has_dl_policy(p) || task_has_rt_policy(p)) {
 		p->static_prio = NICE_TO_PRIO(nice);
 		goto out_unlock;
 	}
@@ -3824,16 +4092,81 @@ static struct task_struct *find_process_by_pid(pid_t pid)
 	return pid ? find_task_by_vpid(pid) : current;
 }
 
-/* Actually do priority change: must hold rq lock. */
+/*
+ * Set up the deadline parameters of a task becoming SCHED_DEADLINE, or
+ * of one changing its reservation.  The new instance starts, with
+ * deadline and runtime initialised from these, at the next enqueue
+ * (see setup_new_dl_entity()).  Must hold rq lock.
+ */
+static void
+__setparam_dl(struct task_struct *p, const struct sched_attr *attr)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+
+	hrtimer_try_to_cancel(&dl_se->dl_timer);
+	dl_se->dl_runtime = attr->sched_runtime;
+	dl_se->dl_deadline = attr->sched_deadline;
+	dl_se->dl_period = attr->sched_period ?: dl_se->dl_deadline;
+	dl_se->dl_bw = to_ratio(dl_se->dl_period, dl_se->dl_runtime);
+	dl_se->dl_throttled = 0;
+	dl_se->dl_new = 1;
+}
+
 static void
-__setscheduler(struct rq *rq, struct task_struct *p, int policy, int prio)
+__getparam_dl(struct task_struct *p, struct sched_attr *attr)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+
+	attr->sched_priority = p->rt_priority;
+	attr->sched_runtime = dl_se->dl_runtime;
+	attr->sched_deadline = dl_se->dl_deadline;
+	attr->sched_period = dl_se->dl_period;
+}
+
+/*
+ * A deadline task needs a relative deadline, a runtime that fits in it
+ * and a period, if given, no shorter than the deadline.  The runtime
+ * must be at least 1us-ish, and the values must stay clear of the sign
+ * bit so that the deadline arithmetic (see dl_time_before()) can not
+ * wrap.
+ */
+static bool
+__checkparam_dl(const struct sched_attr *attr)
+{
+	if (attr->sched_deadline == 0 ||
+	    attr->sched_runtime < (1ULL << 10))
+		return false;
+
+	if ((attr->sched_deadline | attr->sched_period) & (1ULL << 63))
+		return false;
+
+	if (attr->sched_period && attr->sched_period < attr->sched_deadline)
+		return false;
+
+	return attr->sched_runtime <= attr->sched_deadline;
+}
+
+/* Actually do priority change: must hold rq lock. */
+static void __setscheduler(struct rq *rq, struct task_struct *p,
+			   int policy, const struct sched_attr *attr)
 {
 	p->policy = policy;
-	p->rt_priority = prio;
+
+	if (dl_policy(policy))
+		__setparam_dl(p, attr);
+	else if (fair_policy(policy))
+		p->static_prio = NICE_TO_PRIO(attr->sched_nice);
+
+	p->rt_priority = attr->sched_priority;
 	p->normal_prio = normal_prio(p);
 	/* we are holding p->pi_lock already */
 	p->prio = rt_mutex_getprio(p);
-	if (rt_prio(p->prio))
+	/* no deadline inheritance, see rt_mutex_setprio() */
+	if (dl_prio(p->prio) && !task_has_dl_policy(p))
+		p->prio = 0;
+	if (dl_prio(p->prio))
+		p->sched_class = &dl_sched_class;
+	else if (rt_prio(p->prio))
 		p->sched_class = &rt_sched_class;
 	else
 		p->sched_class = &fair_sched_class;
@@ -3856,10 +4189,11 @@ static bool check_same_owner(struct task_struct *p)
 	return match;
 }
 
-static int __sched_setscheduler(struct task_struct *p, int policy,
-				const struct sched_param *param, bool user)
+static int __sched_setscheduler(struct task_struct *p,
+				const struct sched_attr *attr, bool user)
 {
 	int retval, oldprio, oldpolicy = -1, on_rq, running;
+	int policy = attr->sched_policy;
 	unsigned long flags;
 	const struct sched_class *prev_class;
 	struct rq *rq;
@@ -3873,31 +4207,43 @@ recheck:
 		reset_on_fork = p->sched_reset_on_fork;
 		policy = oldpolicy = p->policy;
 	} else {
-		reset_on_fork = !!(policy & SCHED_RESET_ON_FORK);
-		policy &= ~SCHED_RESET_ON_FORK;
+		reset_on_fork = !!(attr->sched_flags & SCHED_FLAG_RESET_ON_FORK);
 
-		if (policy != SCHED_FIFO && policy != SCHED_RR &&
+		if (policy != SCHED_DEADLINE &&
+				policy != SCHED_FIFO && policy != SCHED_RR &&
 				policy != SCHED_NORMAL && policy != SCHED_BATCH &&
 				policy != SCHED_IDLE)
 			return -EINVAL;
 	}
 
+	if (attr->sched_flags & ~(SCHED_FLAG_RESET_ON_FORK))
+		return -EINVAL;
+
 	/*
 	 * Valid priorities for SCHED_FIFO and SCHED_RR are
 	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL,
-	 * SCHED_BATCH and SCHED_IDLE is 0.
+	 * SCHED_BATCH, SCHED_IDLE and SCHED_DEADLINE is 0.
 	 */
-	if (param->sched_priority < 0 ||
-	    (p->mm && param->sched_priority > MAX_USER_RT_PRIO-1) ||
-	    (!p->mm && param->sched_priority > MAX_RT_PRIO-1))
+	if ((p->mm && attr->sched_priority > MAX_USER_RT_PRIO-1) ||
+	    (!p->mm && attr->sched_priority > MAX_RT_PRIO-1))
 		return -EINVAL;
-	if (rt_policy(policy) != (param->sched_priority != 0))
+	if ((dl_policy(policy) && !__checkparam_dl(attr)) ||
+	    (rt_policy(policy) != (attr->sched_priority != 0)))
+		return -EINVAL;
+	if (fair_policy(policy) &&
+	    (attr->sched_nice < -20 || attr->sched_nice > 19))
 		return -EINVAL;
 
 	/*
 	 * Allow unprivileged RT tasks to decrease priority:
 	 */
 	if (user && !capable(CAP_SYS_NICE)) {
+		if (fair_policy(policy)) {
+			if (attr->sched_nice < TASK_NICE(p) &&
+			    !can_nice(p, attr->sched_nice))
+				return -EPERM;
+		}
+
 		if (rt_policy(policy)) {
 			unsigned long rlim_rtprio =
 					task_rlimit(p, RLIMIT_RTPRIO);
@@ -3907,11 +4253,18 @@ recheck:
 				return -EPERM;
 
 			/* can't increase priority */
-			if (param->sched_priority > p->rt_priority &&
-			    param->sched_priority > rlim_rtprio)
+			if (attr->sched_priority > p->rt_priority &&
+			    attr->sched_priority > rlim_rtprio)
 				return -EPERM;
 		}
 
+		/*
+		 * Deadline reservations take bandwidth away from everybody
+		 * else in the root domain: they are privileged.
+		 */
+		if (dl_policy(policy))
+			return -EPERM;
+
 		/*
 		 * Treat SCHED_IDLE as nice 20. Only allow a switch to
 		 * SCHED_NORMAL if the RLIMIT_NICE would normally permit it.
@@ -3956,11 +4309,18 @@ recheck:
 	/*
 	 * If not changing anything there's no need to proceed further:
 	 */
-	if (unlikely(policy == p->policy && (!rt_policy(policy) ||
-			param->sched_priority == p->rt_priority))) {
+	if (unlikely(policy == p->policy)) {
+		if (fair_policy(policy) && attr->sched_nice != TASK_NICE(p))
+			goto change;
+		if (rt_policy(policy) && attr->sched_priority != p->rt_priority)
+			goto change;
+		if (dl_policy(policy))
+			goto change;
+
 		task_rq_unlock(rq, p, &flags);
 		return 0;
 	}
+change:
 
 #ifdef CONFIG_RT_GROUP_SCHED
 	if (user) {
@@ -3983,6 +4343,18 @@ recheck:
 		task_rq_unlock(rq, p, &flags);
 		goto recheck;
 	}
+
+	/*
+	 * Becoming SCHED_DEADLINE, or changing the reservation of a
+	 * SCHED_DEADLINE task, needs enough free bandwidth in its root
+	 * domain; leaving SCHED_DEADLINE gives it back.
+	 */
+	if ((dl_policy(policy) || task_has_dl_policy(p)) &&
+	    sched_dl_overflow(p, policy, attr)) {
+		task_rq_unlock(rq, p, &flags);
+		return -EBUSY;
+	}
+
 	on_rq = p->on_rq;
 	running = task_current(rq, p);
 	if (on_rq)
@@ -3994,7 +4366,7 @@ recheck:
 
 	oldprio = p->prio;
 	prev_class = p->sched_class;
-	__setscheduler(rq, p, policy, param->sched_priority);
+	__setscheduler(rq, p, policy, attr);
 
 	if (running)
 		p->sched_class->set_curr_task(rq);
@@ -4017,13 +4389,47 @@ recheck:
  *
  * NOTE that the task may be already dead.
  */
+static int _sched_setscheduler(struct task_struct *p, int policy,
+			       const struct sched_param *param, bool check)
+{
+	struct sched_attr attr = {
+		.sched_policy   = policy,
+		.sched_priority = param->sched_priority,
+		.sched_nice	= PRIO_TO_NICE(p->static_prio),
+	};
+
+	/* Fixup the legacy SCHED_RESET_ON_FORK hack. */
+	if (policy >= 0 && (policy & SCHED_RESET_ON_FORK)) {
+		attr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
+		policy &= ~SCHED_RESET_ON_FORK;
+		attr.sched_policy = policy;
+	}
+
+	return __sched_setscheduler(p, &attr, check);
+}
+
 int sched_setscheduler(struct task_struct *p, int policy,
 		       const struct sched_param *param)
 {
-	return __sched_setscheduler(p, policy, param, true);
+	return _sched_setscheduler(p, policy, param, true);
 }
 EXPORT_SYMBOL_GPL(sched_setscheduler);
 
+/**
+ * sched_setattr - change the scheduling policy and parameters of a thread.
+ * @p: the task in question.
+ * @attr: structure containing the new policy and its parameters.
+ *
+ * This is the only way to make a task SCHED_DEADLINE.
+ *
+ * NOTE that the task may be already dead.
+ */
+int sched_setattr(struct task_struct *p, const struct sched_attr *attr)
+{
+	return __sched_setscheduler(p, attr, true);
+}
+EXPORT_SYMBOL_GPL(sched_setattr);
+
 /**
  * sched_setscheduler_nocheck - change the scheduling policy and/or RT priority of a thread from kernelspace.
  * @p: the task in question.
@@ -4038,7 +4444,7 @@ EXPORT_SYMBOL_GPL(sched_setscheduler);
 int sched_setscheduler_nocheck(struct task_struct *p, int policy,
 			       const struct sched_param *param)
 {
-	return __sched_setscheduler(p, policy, param, false);
+	return _sched_setscheduler(p, policy, param, false);
 }
 
 static int
@@ -4063,6 +4469,95 @@ do_sched_setscheduler(pid_t pid, int policy, struct sched_param __user *param)
 	return retval;
 }
 
+/*
+ * Copy a struct sched_attr from user space, the way perf_copy_attr()
+ * does for perf_event_attr: @size says how big the caller's structure
+ * is; a smaller one is zero extended, a bigger one is fine as long as
+ * the bits we don't know about are zero.
+ */
+static int sched_copy_attr(struct sched_attr __user *uattr,
+			   struct sched_attr *attr)
+{
+	u32 size;
+	int ret;
+
+	if (!access_ok(VERIFY_WRITE, uattr, SCHED_ATTR_SIZE_VER0))
+		return -EFAULT;
+
+	memset(attr, 0, sizeof(*attr));
+
+	ret = get_user(size, &uattr->size);
+	if (ret)
+		return ret;
+
+	if (size > PAGE_SIZE)
+		goto err_size;
+
+	if (!size)		/* abi compat */
+		size = SCHED_ATTR_SIZE_VER0;
+
+	if (size < SCHED_ATTR_SIZE_VER0)
+		goto err_size;
+
+	if (size > sizeof(*attr)) {
+		unsigned char __user *addr;
+		unsigned char __user *end;
+		unsigned char val;
+
+		addr = (void __user *)uattr + sizeof(*attr);
+		end  = (void __user *)uattr + size;
+
+		for (; addr < end; addr++) {
+			ret = get_user(val, addr);
+			if (ret)
+				return ret;
+			if (val)
+				goto err_size;
+		}
+		size = sizeof(*attr);
+	}
+
+	if (copy_from_user(attr, uattr, size))
+		return -EFAULT;
+
+	return 0;
+
+err_size:
+	put_user(sizeof(*attr), &uattr->size);
+	return -E2BIG;
+}
+
+/*
+ * Copy @attr out to a user structure of @usize bytes.  An older, smaller
+ * structure is only good enough if everything it can't hold is zero.
+ */
+static int sched_read_attr(struct sched_attr __user *uattr,
+			   struct sched_attr *attr,
+			   unsigned int usize)
+{
+	if (!access_ok(VERIFY_WRITE, uattr, usize))
+		return -EFAULT;
+
+	if (usize < sizeof(*attr)) {
+		unsigned char *addr, *end;
+
+		addr = (void *)attr + usize;
+		end  = (void *)attr + sizeof(*attr);
+
+		for (; addr < end; addr++) {
+			if (*addr)
+				return -EFBIG;
+		}
+
+		attr->size = usize;
+	}
+
+	if (copy_to_user(uattr, attr, attr->size))
+		return -EFAULT;
+
+	return 0;
+}
+
 /**
  * sys_sched_setscheduler - set/change the scheduler policy and RT priority
  * @pid: the pid in question.
@@ -4089,6 +4584,39 @@ SYSCALL_DEFINE2(sched_setparam, pid_t, pid, struct sched_param __user *, param)
 	return do_sched_setscheduler(pid, -1, param);
 }
 
+/**
+ * sys_sched_setattr - same as above, but with extended sched_attr
+ * @pid: the pid in question.
+ * @uattr: structure containing the extended parameters.
+ * @flags: for future extension, must be zero.
+ */
+SYSCALL_DEFINE3(sched_setattr, pid_t, pid, struct sched_attr __user *, uattr,
+		unsigned int, flags)
+{
+	struct sched_attr attr;
+	struct task_struct *p;
+	int retval;
+
+	if (!uattr || pid < 0 || flags)
+		return -EINVAL;
+
+	retval = sched_copy_attr(uattr, &attr);
+	if (retval)
+		return retval;
+
+	if ((int)attr.sched_policy < 0)
+		return -EINVAL;
+
+	rcu_read_lock();
+	retval = -ESRCH;
+	p = find_process_by_pid(pid);
+	if (p != NULL)
+		retval = sched_setattr(p, &attr);
+	rcu_read_unlock();
+
+	return retval;
+}
+
 /**
  * sys_sched_getscheduler - get the policy (scheduling class) of a thread
  * @pid: the pid in question.
@@ -4153,6 +4681,55 @@ out_unlock:
 	return retval;
 }
 
+/**
+ * sys_sched_getattr - similar to sched_getparam, but with sched_attr
+ * @pid: the pid in question.
+ * @uattr: structure containing the extended parameters.
+ * @size: sizeof(attr) for fwd/bwd comp.
+ * @flags: for future extension, must be zero.
+ */
+SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
+		unsigned int, size, unsigned int, flags)
+{
+	struct sched_attr attr = {
+		.size = sizeof(struct sched_attr),
+	};
+	struct task_struct *p;
+	int retval;
+
+	if (!uattr || pid < 0 || size > PAGE_SIZE ||
+	    size < SCHED_ATTR_SIZE_VER0 || flags)
+		return -EINVAL;
+
+	rcu_read_lock();
+	p = find_process_by_pid(pid);
+	retval = -ESRCH;
+	if (!p)
+		goto out_unlock;
+
+	retval = security_task_getscheduler(p);
+	if (retval)
+		goto out_unlock;
+
+	attr.sched_policy = p->policy;
+	if (p->sched_reset_on_fork)
+		attr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
+	if (task_has_dl_policy(p))
+		__getparam_dl(p, &attr);
+	else if (task_has_rt_policy(p))
+		attr.sched_priority = p->rt_priority;
+	else
+		attr.sched_nice = TASK_NICE(p);
+
+	rcu_read_unlock();
+
+	return sched_read_attr(uattr, &attr, size);
+
+out_unlock:
+	rcu_read_unlock();
+	return retval;
+}
+
 long sched_setaffinity(pid_t pid, const struct cpumask *in_mask)
 {
 	cpumask_var_t cpus_allowed, new_mask;
@@ -4567,6 +5144,7 @@ SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
 	case SCHED_RR:
 		ret = MAX_USER_RT_PRIO-1;
 		break;
+	case SCHED_DEADLINE:
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
@@ -4592,6 +5170,7 @@ SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
 	case SCHED_RR:
 		ret = 1;
 		break;
+	case SCHED_DEADLINE:
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
@@ -5505,6 +6084,7 @@ static void free_rootdomain(struct rcu_head *rcu)
 	struct root_domain *rd = container_of(rcu, struct root_domain, rcu);
 
 	cpupri_cleanup(&rd->cpupri);
+	free_cpumask_var(rd->dlo_mask);
 	free_cpumask_var(rd->rto_mask);
 	free_cpumask_var(rd->online);
 	free_cpumask_var(rd->span);
@@ -5558,11 +6138,17 @@ static int init_rootdomain(struct root_domain *rd)
 		goto free_span;
 	if (!alloc_cpumask_var(&rd->rto_mask, GFP_KERNEL))
 		goto free_online;
+	if (!alloc_cpumask_var(&rd->dlo_mask, GFP_KERNEL))
+		goto free_rto_mask;
+
+	init_dl_bw(&rd->dl_bw);
 
 	if (cpupri_init(&rd->cpupri) != 0)
-		goto free_rto_mask;
+		goto free_dlo_mask;
 	return 0;
 
+free_dlo_mask:
+	free_cpumask_var(rd->dlo_mask);
 free_rto_mask:
 	free_cpumask_var(rd->rto_mask);
 free_online:
@@ -6890,6 +7476,7 @@ void __init sched_init_smp(void)
 	free_cpumask_var(non_isolated_cpus);
 
 	init_sched_rt_class();
+	init_sched_dl_class();
 }
 #else
 void __init sched_init_smp(void)
@@ -6976,6 +7563,7 @@ void __init sched_init(void)
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
 	autogroup_init(&init_task);
+	init_uclamp();
 
 #endif /* CONFIG_CGROUP_SCHED */
 
@@ -6989,6 +7577,7 @@ void __init sched_init(void)
 		rq->calc_load_update = jiffies + LOAD_FREQ;
 		init_cfs_rq(&rq->cfs);
 		init_rt_rq(&rq->rt, rq);
+		init_dl_rq(&rq->dl, rq);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		root_task_group.shares = ROOT_TASK_GROUP_LOAD;
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
@@ -7034,6 +7623,8 @@ void __init sched_init(void)
 		rq->active_balance = 0;
 		rq->next_balance = jiffies;
 		rq->push_cpu = 0;
+		rq->misfit_cpu = -1;
+		rq->misfit_balance = 0;
 		rq->cpu = i;
 		rq->online = 0;
 		rq->idle_stamp = 0;
@@ -7147,13 +7738,21 @@ EXPORT_SYMBOL(__might_sleep);
 static void normalize_task(struct rq *rq, struct task_struct *p)
 {
 	const struct sched_class *prev_class = p->sched_class;
+	struct sched_attr attr = {
+		.sched_policy = SCHED_NORMAL,
+		.sched_nice = PRIO_TO_NICE(p->static_prio),
+	};
 	int old_prio = p->prio;
 	int on_rq;
 
+	/* give a deadline task's bandwidth back */
+	if (task_has_dl_policy(p))
+		sched_dl_overflow(p, SCHED_NORMAL, &attr);
+
 	on_rq = p->on_rq;
 	if (on_rq)
 		dequeue_task(rq, p, 0);
-	__setscheduler(rq, p, SCHED_NORMAL, 0);
+	__setscheduler(rq, p, SCHED_NORMAL, &attr);
 	if (on_rq) {
 		enqueue_task(rq, p, 0);
 		resched_task(rq->curr);
@@ -7281,6 +7880,8 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+	init_uclamp_group(tg);
+
 	return tg;
 
 err:
@@ -7301,6 +7902,8 @@ void sched_online_group(struct task_group *tg, struct task_group *parent)
 	INIT_LIST_HEAD(&tg->children);
 	list_add_rcu(&tg->siblings, &parent->children);
 	spin_unlock_irqrestore(&task_group_lock, flags);
+
+	online_uclamp_group(tg);
 }
 
 /* rcu callback to free various structures associated with a task group */
@@ -7376,15 +7979,21 @@ void sched_move_task(struct task_struct *tsk)
 }
 #endif /* CONFIG_CGROUP_SCHED */
 
-#if defined(CONFIG_RT_GROUP_SCHED) || defined(CONFIG_CFS_BANDWIDTH)
-static unsigned long to_ratio(u64 period, u64 runtime)
+unsigned long to_ratio(u64 period, u64 runtime)
 {
 	if (runtime == RUNTIME_INF)
 		return 1ULL << 20;
 
+	/*
+	 * Doing this here saves a lot of checks in all
+	 * the calling paths, and returning zero seems
+	 * safe for them anyway.
+	 */
+	if (period == 0)
+		return 0;
+
 	return div64_u64(runtime << 20, period);
 }
-#endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
 /*
@@ -7659,7 +8268,9 @@ int sched_rt_handler(struct ctl_table *table, int write,
 	ret = proc_dointvec(table, write, buffer, lenp, ppos);
 
 	if (!ret && write) {
-		ret = sched_rt_global_constraints();
+		ret = sched_dl_global_constraints();
+		if (!ret)
+			ret = sched_rt_global_constraints();
 		if (ret) {
 			sysctl_sched_rt_period = old_period;
 			sysctl_sched_rt_runtime = old_runtime;
@@ -8046,6 +8657,19 @@ static u64 cpu_rt_period_read_uint(struct cgroup *cgrp, struct cftype *cft)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+static int cpu_uclamp_write_u64(struct cgroup *cgrp, struct cftype *cft,
+				u64 val)
+{
+	return sched_group_set_uclamp(cgroup_tg(cgrp), cft->private, val);
+}
+
+static u64 cpu_uclamp_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->uclamp_req[cft->private];
+}
+#endif /* CONFIG_UCLAMP_TASK_GROUP */
+
 static struct cftype cpu_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -8081,6 +8705,22 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_rt_period_read_uint,
 		.write_u64 = cpu_rt_period_write_uint,
 	},
+#endif
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	{
+		.name = "uclamp_min",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.private = UCLAMP_MIN,
+		.read_u64 = cpu_uclamp_read_u64,
+		.write_u64 = cpu_uclamp_write_u64,
+	},
+	{
+		.name = "uclamp_max",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.private = UCLAMP_MAX,
+		.read_u64 = cpu_uclamp_read_u64,
+		.write_u64 = cpu_uclamp_write_u64,
+	},
 #endif
 	{ }	/* terminate */
 };
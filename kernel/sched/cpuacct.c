@@ -31,6 +31,9 @@ struct cpuacct {
 	/* cpuusage holds pointer to a u64-type object on every cpu */
 	u64 __percpu *cpuusage;
 	struct kernel_cpustat __percpu *cpustat;
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	struct sched_lat_hist __percpu *lat_hist;
+#endif
 };
 
 /* return cpu accounting group corresponding to this container */
@@ -60,9 +63,15 @@ static inline struct cpuacct *parent_ca(struct cpuacct *ca)
 }
 
 static DEFINE_PER_CPU(u64, root_cpuacct_cpuusage);
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static DEFINE_PER_CPU(struct sched_lat_hist, root_cpuacct_lat_hist);
+#endif
 static struct cpuacct root_cpuacct = {
 	.cpustat	= &kernel_cpustat,
 	.cpuusage	= &root_cpuacct_cpuusage,
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	.lat_hist	= &root_cpuacct_lat_hist,
+#endif
 };
 
 /* create a new cpu accounting group */
@@ -85,8 +94,18 @@ static struct cgroup_subsys_state *cpuacct_css_alloc(struct cgroup *cgrp)
 	if (!ca->cpustat)
 		goto out_free_cpuusage;
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	ca->lat_hist = alloc_percpu(struct sched_lat_hist);
+	if (!ca->lat_hist)
+		goto out_free_cpustat;
+#endif
+
 	return &ca->css;
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+out_free_cpustat:
+	free_percpu(ca->cpustat);
+#endif
 out_free_cpuusage:
 	free_percpu(ca->cpuusage);
 out_free_ca:
@@ -100,6 +119,9 @@ static void cpuacct_css_free(struct cgroup *cgrp)
 {
 	struct cpuacct *ca = cgroup_ca(cgrp);
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	free_percpu(ca->lat_hist);
+#endif
 	free_percpu(ca->cpustat);
 	free_percpu(ca->cpuusage);
 	kfree(ca);
@@ -221,6 +243,32 @@ static int cpuacct_stats_show(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static int cpuacct_lat_hist_show(struct cgroup *cgrp, struct cftype *cft,
+				 struct seq_file *m)
+{
+	struct cpuacct *ca = cgroup_ca(cgrp);
+	struct sched_lat_hist *hist;
+	int cpu, type, i;
+
+	hist = kzalloc(sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct sched_lat_hist *h = per_cpu_ptr(ca->lat_hist, cpu);
+
+		for (type = 0; type < SCHED_LAT_NR_TYPES; type++)
+			for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+				hist->count[type][i] += h->count[type][i];
+	}
+	sched_lat_hist_show(m, hist);
+	kfree(hist);
+
+	return 0;
+}
+#endif
+
 static struct cftype files[] = {
 	{
 		.name = "usage",
@@ -235,6 +283,12 @@ static struct cftype files[] = {
 		.name = "stat",
 		.read_map = cpuacct_stats_show,
 	},
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	{
+		.name = "latency_hist",
+		.read_seq_string = cpuacct_lat_hist_show,
+	},
+#endif
 	{ }	/* terminate */
 };
 
@@ -286,6 +340,25 @@ void cpuacct_account_field(struct task_struct *p, int index, u64 val)
 	rcu_read_unlock();
 }
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+/*
+ * Count a runqueue wait in the latency histograms of the task's group and
+ * all its parents.
+ *
+ * called with rq->lock held.
+ */
+void cpuacct_lat_hist_add(struct task_struct *tsk, int type, int bucket)
+{
+	struct cpuacct *ca;
+	int cpu = task_cpu(tsk);
+
+	rcu_read_lock();
+	for (ca = task_ca(tsk); ca; ca = parent_ca(ca))
+		per_cpu_ptr(ca->lat_hist, cpu)->count[type][bucket]++;
+	rcu_read_unlock();
+}
+#endif
+
 struct cgroup_subsys cpuacct_subsys = {
 	.name		= "cpuacct",
 	.css_alloc	= cpuacct_css_alloc,
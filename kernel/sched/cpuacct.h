@@ -2,6 +2,14 @@
 
 extern void cpuacct_charge(struct task_struct *tsk, u64 cputime);
 extern void cpuacct_account_field(struct task_struct *p, int index, u64 val);
+#ifdef CONFIG_SCHED_LATENCY_HIST
+extern void cpuacct_lat_hist_add(struct task_struct *tsk, int type, int bucket);
+#else
+static inline void
+cpuacct_lat_hist_add(struct task_struct *tsk, int type, int bucket)
+{
+}
+#endif
 
 #else
 
@@ -14,4 +22,9 @@ cpuacct_account_field(struct task_struct *p, int index, u64 val)
 {
 }
 
+static inline void
+cpuacct_lat_hist_add(struct task_struct *tsk, int type, int bucket)
+{
+}
+
 #endif
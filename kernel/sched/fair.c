@@ -29,6 +29,7 @@
 #include <linux/mempolicy.h>
 #include <linux/migrate.h>
 #include <linux/task_work.h>
+#include <linux/static_key.h>
 
 #include <trace/events/sched.h>
 
@@ -3220,6 +3221,240 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p, int sync)
 	return 0;
 }
 
+/*
+ * Capacity-aware placement
+ *
+ * When the cpus do not all have the same maximum capacity, as reported by
+ * arch_scale_cpu_capacity() with the biggest ones at SCHED_POWER_SCALE, a
+ * waking task is placed by its tracked utilization.  A task may stay on a
+ * cpu while it uses less than sysctl_sched_upmigrate percent of the cpu's
+ * capacity, and may move to a smaller cpu only if it would use less than
+ * sysctl_sched_downmigrate percent of that one.  The gap between the two
+ * keeps tasks from bouncing between clusters.  A running task that outgrows
+ * its cpu is pushed to an idle bigger one from the tick.
+ *
+ * Utilization comes from per-entity load tracking, so all of this is only
+ * done with CONFIG_FAIR_GROUP_SCHED.
+ */
+unsigned int sysctl_sched_upmigrate = 80;
+unsigned int sysctl_sched_downmigrate = 60;
+
+/*
+ * A downmigrate threshold above the upmigrate one would invert the
+ * hysteresis and let tasks ping-pong between big and little cpus.
+ */
+int sched_migrate_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp,
+		loff_t *ppos)
+{
+	unsigned int old_up, old_down;
+	static DEFINE_MUTEX(mutex);
+	int ret;
+
+	mutex_lock(&mutex);
+	old_up = sysctl_sched_upmigrate;
+	old_down = sysctl_sched_downmigrate;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+
+	if (!ret && write &&
+	    sysctl_sched_downmigrate > sysctl_sched_upmigrate) {
+		sysctl_sched_upmigrate = old_up;
+		sysctl_sched_downmigrate = old_down;
+		ret = -EINVAL;
+	}
+	mutex_unlock(&mutex);
+
+	return ret;
+}
+
+static struct static_key sched_asym_capacity = STATIC_KEY_INIT_FALSE;
+static DEFINE_MUTEX(sched_asym_capacity_mutex);
+static bool sched_asym_capacity_on;
+
+unsigned long __weak arch_scale_cpu_capacity(int cpu)
+{
+	return SCHED_POWER_SCALE;
+}
+
+/*
+ * Architectures call this whenever arch_scale_cpu_capacity() changes, to
+ * turn capacity-aware placement on or off.
+ */
+void update_asym_cpu_capacity(void)
+{
+	unsigned long cap, min_cap = ULONG_MAX, max_cap = 0;
+	bool asym;
+	int cpu;
+
+	mutex_lock(&sched_asym_capacity_mutex);
+	for_each_possible_cpu(cpu) {
+		cap = arch_scale_cpu_capacity(cpu);
+		min_cap = min(min_cap, cap);
+		max_cap = max(max_cap, cap);
+	}
+	asym = min_cap != max_cap;
+
+	if (asym != sched_asym_capacity_on) {
+		if (asym)
+			static_key_slow_inc(&sched_asym_capacity);
+		else
+			static_key_slow_dec(&sched_asym_capacity);
+		sched_asym_capacity_on = asym;
+	}
+	mutex_unlock(&sched_asym_capacity_mutex);
+}
+
+#ifdef CONFIG_FAIR_GROUP_SCHED
+static inline bool sched_capacity_aware(void)
+{
+	return static_key_false(&sched_asym_capacity);
+}
+
+/* Fraction of time p was runnable, scaled to SCHED_POWER_SCALE */
+static unsigned long task_util(struct task_struct *p)
+{
+	struct sched_avg *sa = &p->se.avg;
+
+	return div_u64((u64)sa->runnable_avg_sum << SCHED_POWER_SHIFT,
+		       sa->runnable_avg_period + 1);
+}
+
+/* Fraction of time cpu had runnable tasks, scaled to SCHED_POWER_SCALE */
+static unsigned long cpu_util(int cpu)
+{
+	struct sched_avg *sa = &cpu_rq(cpu)->avg;
+
+	return div_u64((u64)sa->runnable_avg_sum << SCHED_POWER_SHIFT,
+		       sa->runnable_avg_period + 1);
+}
+#else
+static inline bool sched_capacity_aware(void)
+{
+	return false;
+}
+
+static inline unsigned long task_util(struct task_struct *p)
+{
+	return 0;
+}
+
+static inline unsigned long cpu_util(int cpu)
+{
+	return 0;
+}
+#endif
+
+static inline bool
+util_fits_capacity(unsigned long util, unsigned long capacity,
+		   unsigned int pct)
+{
+	return util * 100 < capacity * pct;
+}
+
+/* Is cpu a better target than the one described by best_idle/best_util? */
+static inline bool
+capacity_cpu_better(int cpu, bool *best_idle, unsigned long *best_util)
+{
+	bool idle = idle_cpu(cpu);
+	unsigned long util = cpu_util(cpu);
+
+	if (idle < *best_idle || (idle == *best_idle && util >= *best_util))
+		return false;
+
+	*best_idle = idle;
+	*best_util = util;
+	return true;
+}
+
+/*
+ * Pick a cpu for waking task p: one of the smallest capacity p fits, idle
+ * if possible and the least utilized otherwise.  If p fits nowhere, one of
+ * the biggest cpus.  Returns -1 to leave the choice to the regular path,
+ * which is when the waker, prev_cpu and the result all share a capacity.
+ */
+static int select_capacity_cpu(struct task_struct *p, int prev_cpu,
+			       int this_cpu)
+{
+	unsigned long util = task_util(p);
+	unsigned long prev_cap = arch_scale_cpu_capacity(prev_cpu);
+	unsigned long cap, best_cap = ULONG_MAX, big_cap = 0;
+	unsigned long best_util = ULONG_MAX, big_util = ULONG_MAX;
+	bool best_idle = false, big_idle = false;
+	int cpu, best_cpu = -1, big_cpu = -1;
+	unsigned int pct;
+
+	for_each_cpu_and(cpu, tsk_cpus_allowed(p), cpu_active_mask) {
+		cap = arch_scale_cpu_capacity(cpu);
+
+		if (cap > big_cap) {
+			big_cap = cap;
+			big_idle = false;
+			big_util = ULONG_MAX;
+		}
+		if (cap == big_cap &&
+		    capacity_cpu_better(cpu, &big_idle, &big_util))
+			big_cpu = cpu;
+
+		pct = cap < prev_cap ? sysctl_sched_downmigrate :
+				       sysctl_sched_upmigrate;
+		if (!util_fits_capacity(util, cap, pct) || cap > best_cap)
+			continue;
+
+		if (cap < best_cap) {
+			best_cap = cap;
+			best_idle = false;
+			best_util = ULONG_MAX;
+		}
+		if (capacity_cpu_better(cpu, &best_idle, &best_util))
+			best_cpu = cpu;
+	}
+
+	if (best_cpu < 0)
+		best_cpu = big_cpu;
+	if (best_cpu < 0)
+		return -1;
+
+	cap = arch_scale_cpu_capacity(best_cpu);
+	if (cap != prev_cap)
+		return best_cpu;
+	if (cap == arch_scale_cpu_capacity(this_cpu))
+		return -1;
+	/* Stay cache affine if prev_cpu is as good */
+	if (idle_cpu(prev_cpu) || !best_idle)
+		return prev_cpu;
+	return best_cpu;
+}
+
+/*
+ * Called from the tick: if the running task has outgrown its cpu, note an
+ * idle bigger cpu to push it to.  The push itself is done from
+ * run_rebalance_domains(), where rq->lock is not held.
+ */
+static void check_misfit_task(struct rq *rq, struct task_struct *p)
+{
+	unsigned long cap, best_cap;
+	int cpu, target = -1;
+
+	if (!sched_capacity_aware() || p->nr_cpus_allowed == 1 ||
+	    rq->misfit_cpu >= 0 || rq->active_balance)
+		return;
+
+	cap = arch_scale_cpu_capacity(cpu_of(rq));
+	if (util_fits_capacity(task_util(p), cap, sysctl_sched_upmigrate))
+		return;
+
+	best_cap = cap;
+	for_each_cpu_and(cpu, tsk_cpus_allowed(p), cpu_active_mask) {
+		cap = arch_scale_cpu_capacity(cpu);
+		if (cap > best_cap && idle_cpu(cpu)) {
+			best_cap = cap;
+			target = cpu;
+		}
+	}
+	rq->misfit_cpu = target;
+}
+
 /*
  * find_idlest_group finds and returns the least busy CPU group within the
  * domain.
@@ -3366,6 +3601,18 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	if (p->nr_cpus_allowed == 1)
 		return prev_cpu;
 
+	/*
+	 * New tasks have no utilization history yet, so only wakeups are
+	 * placed by capacity; forked tasks are pushed up from the tick if
+	 * they turn out to be big.
+	 */
+	if ((sd_flag & SD_BALANCE_WAKE) && sched_capacity_aware()) {
+		new_cpu = select_capacity_cpu(p, prev_cpu, cpu);
+		if (new_cpu >= 0)
+			return new_cpu;
+		new_cpu = cpu;
+	}
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
 			want_affine = 1;
@@ -3847,6 +4094,7 @@ static unsigned long __read_mostly max_load_balance_interval = HZ/10;
 #define LBF_ALL_PINNED	0x01
 #define LBF_NEED_BREAK	0x02
 #define LBF_SOME_PINNED 0x04
+#define LBF_MISFIT	0x08
 
 struct lb_env {
 	struct sched_domain	*sd;
@@ -3968,6 +4216,22 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 		return 0;
 	}
 
+	if (sched_capacity_aware()) {
+		unsigned long src_cap = arch_scale_cpu_capacity(env->src_cpu);
+		unsigned long dst_cap = arch_scale_cpu_capacity(env->dst_cpu);
+
+		/* A misfit push moves only a task that outgrew src_cpu */
+		if (env->flags & LBF_MISFIT)
+			return !util_fits_capacity(task_util(p), src_cap,
+						   sysctl_sched_upmigrate);
+
+		/* Don't pull a task down to a cpu it does not fit */
+		if (dst_cap < src_cap &&
+		    !util_fits_capacity(task_util(p), dst_cap,
+					sysctl_sched_downmigrate))
+			return 0;
+	}
+
 	/*
 	 * Aggressive migration if:
 	 * 1) task is cache cold, or
@@ -5366,6 +5630,8 @@ static int active_load_balance_cpu_stop(void *data)
 			.src_cpu	= busiest_rq->cpu,
 			.src_rq		= busiest_rq,
 			.idle		= CPU_IDLE,
+			.flags		= busiest_rq->misfit_balance ?
+					  LBF_MISFIT : 0,
 		};
 
 		schedstat_inc(sd, alb_count);
@@ -5379,10 +5645,39 @@ static int active_load_balance_cpu_stop(void *data)
 	double_unlock_balance(busiest_rq, target_rq);
 out_unlock:
 	busiest_rq->active_balance = 0;
+	busiest_rq->misfit_balance = 0;
 	raw_spin_unlock_irq(&busiest_rq->lock);
 	return 0;
 }
 
+/*
+ * Push the running task of this_rq to the bigger cpu check_misfit_task()
+ * found for it.
+ */
+static void misfit_balance(struct rq *this_rq)
+{
+	int target = ACCESS_ONCE(this_rq->misfit_cpu);
+	unsigned long flags;
+
+	if (target < 0)
+		return;
+
+	raw_spin_lock_irqsave(&this_rq->lock, flags);
+	this_rq->misfit_cpu = -1;
+	if (this_rq->active_balance || !cpu_active(target) ||
+	    !idle_cpu(target)) {
+		raw_spin_unlock_irqrestore(&this_rq->lock, flags);
+		return;
+	}
+	this_rq->active_balance = 1;
+	this_rq->misfit_balance = 1;
+	this_rq->push_cpu = target;
+	raw_spin_unlock_irqrestore(&this_rq->lock, flags);
+
+	stop_one_cpu_nowait(cpu_of(this_rq), active_load_balance_cpu_stop,
+			    this_rq, &this_rq->active_balance_work);
+}
+
 #ifdef CONFIG_NO_HZ_COMMON
 /*
  * idle load balancing details
@@ -5721,6 +6016,7 @@ static void run_rebalance_domains(struct softirq_action *h)
 	enum cpu_idle_type idle = this_rq->idle_balance ?
 						CPU_IDLE : CPU_NOT_IDLE;
 
+	misfit_balance(this_rq);
 	rebalance_domains(this_cpu, idle);
 
 	/*
@@ -5742,8 +6038,8 @@ static inline int on_null_domain(int cpu)
 void trigger_load_balance(struct rq *rq, int cpu)
 {
 	/* Don't need to rebalance while attached to NULL domain */
-	if (time_after_eq(jiffies, rq->next_balance) &&
-	    likely(!on_null_domain(cpu)))
+	if ((time_after_eq(jiffies, rq->next_balance) ||
+	     rq->misfit_cpu >= 0) && likely(!on_null_domain(cpu)))
 		raise_softirq(SCHED_SOFTIRQ);
 #ifdef CONFIG_NO_HZ_COMMON
 	if (nohz_kick_needed(rq, cpu) && likely(!on_null_domain(cpu)))
@@ -5783,6 +6079,9 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		task_tick_numa(rq, curr);
 
 	update_rq_runnable_avg(rq, 1);
+#ifdef CONFIG_SMP
+	check_misfit_task(rq, curr);
+#endif
 }
 
 /*
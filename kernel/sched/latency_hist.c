@@ -0,0 +1,24 @@
+/*
+ * Runqueue latency histograms, see CONFIG_SCHED_LATENCY_HIST.
+ *
+ * The histograms are updated from sched_info_arrive(); this file only
+ * formats them for /proc/<pid>/sched_latency and cpuacct.latency_hist.
+ */
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+
+/*
+ * One line per bucket: the lower bound of the bucket in nanoseconds, then
+ * the number of waits after a wakeup and after a preemption.
+ */
+void sched_lat_hist_show(struct seq_file *m, const struct sched_lat_hist *hist)
+{
+	int i;
+
+	seq_printf(m, "%-12s %12s %12s\n", "nsecs", "wakeup", "preempt");
+	for (i = 0; i < SCHED_LAT_HIST_BUCKETS; i++)
+		seq_printf(m, "%-12llu %12lu %12lu\n",
+			   i ? 1ULL << (i + 9) : 0ULL,
+			   hist->count[SCHED_LAT_WAKEUP][i],
+			   hist->count[SCHED_LAT_PREEMPT][i]);
+}
@@ -561,6 +561,21 @@ static inline struct rt_bandwidth *sched_rt_bandwidth(struct rt_rq *rt_rq)
 
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+/*
+ * Should runtime be charged to @rt_rq?  Only while the period timer is
+ * running to replenish it, or while there is quota left: the timer is
+ * started by RT enqueues only, so charges from other classes (deadline
+ * tasks) would otherwise pile up and throttle the next RT task for many
+ * periods.
+ */
+bool sched_rt_bandwidth_account(struct rt_rq *rt_rq)
+{
+	struct rt_bandwidth *rt_b = sched_rt_bandwidth(rt_rq);
+
+	return (hrtimer_active(&rt_b->rt_period_timer) ||
+		rt_rq->rt_time < rt_rq->rt_runtime);
+}
+
 #ifdef CONFIG_SMP
 /*
  * We ran out of runtime, see if we can borrow some from our neighbours.
@@ -2,6 +2,7 @@
 #include <linux/sched.h>
 #include <linux/sched/sysctl.h>
 #include <linux/sched/rt.h>
+#include <linux/sched/deadline.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/stop_machine.h>
@@ -79,11 +80,40 @@ static inline int rt_policy(int policy)
 	return 0;
 }
 
+static inline int fair_policy(int policy)
+{
+	return policy == SCHED_NORMAL || policy == SCHED_BATCH;
+}
+
+static inline int dl_policy(int policy)
+{
+	return unlikely(policy == SCHED_DEADLINE);
+}
+
 static inline int task_has_rt_policy(struct task_struct *p)
 {
 	return rt_policy(p->policy);
 }
 
+static inline int task_has_dl_policy(struct task_struct *p)
+{
+	return dl_policy(p->policy);
+}
+
+static inline bool dl_time_before(u64 a, u64 b)
+{
+	return (s64)(a - b) < 0;
+}
+
+/*
+ * Tells if entity @a should preempt entity @b.
+ */
+static inline bool
+dl_entity_preempt(struct sched_dl_entity *a, struct sched_dl_entity *b)
+{
+	return dl_time_before(a->deadline, b->deadline);
+}
+
 /*
  * This is the priority-queue data structure of the RT scheduling class:
  */
@@ -100,6 +130,23 @@ struct rt_bandwidth {
 	struct hrtimer		rt_period_timer;
 };
 
+/*
+ * Deadline admission control: the sum of the bandwidths of the
+ * SCHED_DEADLINE tasks in a root domain, checked against the global rt
+ * limit times the number of cpus in it.  Bandwidths are fixed point
+ * with 20 fractional bits, as returned by to_ratio().
+ */
+struct dl_bw {
+	raw_spinlock_t lock;
+	u64 total_bw;
+};
+
+extern unsigned long to_ratio(u64 period, u64 runtime);
+extern void init_dl_bw(struct dl_bw *dl_b);
+extern int sched_dl_overflow(struct task_struct *p, int policy,
+			     const struct sched_attr *attr);
+extern int sched_dl_global_constraints(void);
+
 extern struct mutex sched_domains_mutex;
 
 #ifdef CONFIG_CGROUP_SCHED
@@ -164,6 +211,13 @@ struct task_group {
 #endif
 
 	struct cfs_bandwidth cfs_bandwidth;
+
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	/* clamps requested through cpu.uclamp_{min,max}, in percent */
+	unsigned int uclamp_req[UCLAMP_CNT];
+	/* clamps applied to the tasks, restricted by the parent's */
+	unsigned int uclamp[UCLAMP_CNT];
+#endif
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -358,6 +412,41 @@ struct rt_rq {
 #endif
 };
 
+/* Deadline class' related fields in a runqueue */
+struct dl_rq {
+	/* runqueue is an rbtree, ordered by deadline */
+	struct rb_root rb_root;
+	struct rb_node *rb_leftmost;
+
+	unsigned long dl_nr_running;
+
+#ifdef CONFIG_SMP
+	/*
+	 * Deadline values of the currently executing and the
+	 * earliest ready task on this rq, 0 if there is none.
+	 * Read without the rq lock by the push and pull code,
+	 * which rechecks them once the lock is taken.
+	 */
+	struct {
+		u64 curr;
+		u64 next;
+	} earliest_dl;
+
+	unsigned long dl_nr_migratory;
+	int overloaded;
+
+	/*
+	 * Tasks on this rq that can be pushed away.  They are kept in
+	 * an rbtree, ordered by deadline, so the earliest one is pushed
+	 * first.
+	 */
+	struct rb_root pushable_dl_tasks_root;
+	struct rb_node *pushable_dl_tasks_leftmost;
+#else
+	struct dl_bw dl_bw;
+#endif
+};
+
 #ifdef CONFIG_SMP
 
 /*
@@ -381,12 +470,43 @@ struct root_domain {
 	 */
 	cpumask_var_t rto_mask;
 	struct cpupri cpupri;
+
+	/*
+	 * The "deadline overload" mask: cpus with more than one runnable
+	 * deadline task, at least one of which can migrate.
+	 */
+	cpumask_var_t dlo_mask;
+	atomic_t dlo_count;
+	struct dl_bw dl_bw;
 };
 
 extern struct root_domain def_root_domain;
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+/*
+ * Runnable tasks are accounted in buckets of UCLAMP_BUCKET_DELTA percent
+ * of clamp values.  A bucket remembers the highest clamp of the tasks
+ * accounted in it since it was last empty, and the clamp of a runqueue
+ * is the value of its highest non-empty bucket: a cpu is boosted as
+ * much as its most boosted task, and capped only as much as its least
+ * capped one.
+ */
+#define UCLAMP_BUCKET_DELTA	5
+#define UCLAMP_BUCKETS		(100 / UCLAMP_BUCKET_DELTA + 1)
+
+struct uclamp_bucket {
+	unsigned int value;
+	unsigned int tasks;
+};
+
+struct uclamp_rq {
+	unsigned int value;
+	struct uclamp_bucket bucket[UCLAMP_BUCKETS];
+};
+#endif
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -422,6 +542,11 @@ struct rq {
 
 	struct cfs_rq cfs;
 	struct rt_rq rt;
+	struct dl_rq dl;
+
+#ifdef CONFIG_UCLAMP_TASK_GROUP
+	struct uclamp_rq uclamp[UCLAMP_CNT];
+#endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
@@ -464,6 +589,10 @@ struct rq {
 	int active_balance;
 	int push_cpu;
 	struct cpu_stop_work active_balance_work;
+	/* bigger cpu to push the running task to, or -1 */
+	int misfit_cpu;
+	/* the pending active balance is a misfit push */
+	int misfit_balance;
 	/* cpu of this runqueue: */
 	int cpu;
 	int online;
@@ -962,6 +1091,7 @@ static const u32 prio_to_wmult[40] = {
 #else
 #define ENQUEUE_WAKING		0
 #endif
+#define ENQUEUE_REPLENISH	8	/* deadline entity gets a new instance */
 
 #define DEQUEUE_SLEEP		1
 
@@ -997,6 +1127,7 @@ struct sched_class {
 	void (*set_curr_task) (struct rq *rq);
 	void (*task_tick) (struct rq *rq, struct task_struct *p, int queued);
 	void (*task_fork) (struct task_struct *p);
+	void (*task_dead) (struct task_struct *p);
 
 	void (*switched_from) (struct rq *this_rq, struct task_struct *task);
 	void (*switched_to) (struct rq *this_rq, struct task_struct *task);
@@ -1016,6 +1147,7 @@ struct sched_class {
    for (class = sched_class_highest; class; class = class->next)
 
 extern const struct sched_class stop_sched_class;
+extern const struct sched_class dl_sched_class;
 extern const struct sched_class rt_sched_class;
 extern const struct sched_class fair_sched_class;
 extern const struct sched_class idle_sched_class;
@@ -1052,6 +1184,7 @@ extern void sysrq_sched_debug_show(void);
 extern void sched_init_granularity(void);
 extern void update_max_interval(void);
 extern int update_runtime(struct notifier_block *nfb, unsigned long action, void *hcpu);
+extern void init_sched_dl_class(void);
 extern void init_sched_rt_class(void);
 extern void init_sched_fair_class(void);
 
@@ -1061,6 +1194,8 @@ extern void resched_cpu(int cpu);
 extern struct rt_bandwidth def_rt_bandwidth;
 extern void init_rt_bandwidth(struct rt_bandwidth *rt_b, u64 period, u64 runtime);
 
+extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
+
 extern void update_idle_cpu_load(struct rq *this_rq);
 
 #ifdef CONFIG_PARAVIRT
@@ -1317,6 +1452,9 @@ extern void print_rt_stats(struct seq_file *m, int cpu);
 
 extern void init_cfs_rq(struct cfs_rq *cfs_rq);
 extern void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq);
+extern void init_dl_rq(struct dl_rq *dl_rq, struct rq *rq);
+
+extern bool sched_rt_bandwidth_account(struct rt_rq *rt_rq);
 
 extern void cfs_bandwidth_usage_inc(void);
 extern void cfs_bandwidth_usage_dec(void);
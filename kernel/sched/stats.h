@@ -47,6 +47,51 @@ rq_sched_info_depart(struct rq *rq, unsigned long long delta)
 # define schedstat_set(var, val)	do { } while (0)
 #endif
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static inline int sched_lat_hist_bucket(unsigned long long delta)
+{
+	return min_t(int, fls64(delta >> 10), SCHED_LAT_HIST_BUCKETS - 1);
+}
+
+/*
+ * A wait that is split by a migration is accounted as a whole when the
+ * task finally runs; the rq->clock skew is annulled as for run_delay.
+ */
+static inline void
+sched_lat_hist_dequeued(struct task_struct *t, unsigned long long delta)
+{
+	t->sched_info.lat_wait += delta;
+}
+
+static inline void
+sched_lat_hist_arrive(struct task_struct *t, unsigned long long delta)
+{
+	struct sched_info *si = &t->sched_info;
+	int type = si->lat_preempted ? SCHED_LAT_PREEMPT : SCHED_LAT_WAKEUP;
+	int bucket = sched_lat_hist_bucket(si->lat_wait + delta);
+
+	si->lat_hist.count[type][bucket]++;
+	cpuacct_lat_hist_add(t, type, bucket);
+
+	si->lat_wait = 0;
+	si->lat_preempted = 0;
+}
+
+static inline void sched_lat_hist_preempted(struct task_struct *t)
+{
+	t->sched_info.lat_preempted = 1;
+}
+#else
+static inline void
+sched_lat_hist_dequeued(struct task_struct *t, unsigned long long delta)
+{}
+static inline void
+sched_lat_hist_arrive(struct task_struct *t, unsigned long long delta)
+{}
+static inline void sched_lat_hist_preempted(struct task_struct *t)
+{}
+#endif /* CONFIG_SCHED_LATENCY_HIST */
+
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 static inline void sched_info_reset_dequeued(struct task_struct *t)
 {
@@ -68,6 +113,7 @@ static inline void sched_info_dequeued(struct task_struct *t)
 			delta = now - t->sched_info.last_queued;
 	sched_info_reset_dequeued(t);
 	t->sched_info.run_delay += delta;
+	sched_lat_hist_dequeued(t, delta);
 
 	rq_sched_info_dequeued(task_rq(t), delta);
 }
@@ -81,8 +127,10 @@ static void sched_info_arrive(struct task_struct *t)
 {
 	unsigned long long now = task_rq(t)->clock, delta = 0;
 
-	if (t->sched_info.last_queued)
+	if (t->sched_info.last_queued) {
 		delta = now - t->sched_info.last_queued;
+		sched_lat_hist_arrive(t, delta);
+	}
 	sched_info_reset_dequeued(t);
 	t->sched_info.run_delay += delta;
 	t->sched_info.last_arrival = now;
@@ -117,8 +165,10 @@ static inline void sched_info_depart(struct task_struct *t)
 
 	rq_sched_info_depart(task_rq(t), delta);
 
-	if (t->state == TASK_RUNNING)
+	if (t->state == TASK_RUNNING) {
+		sched_lat_hist_preempted(t);
 		sched_info_queued(t);
+	}
 }
 
 /*
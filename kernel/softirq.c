@@ -60,6 +60,33 @@ char *softirq_to_name[NR_SOFTIRQS] = {
 	"TASKLET", "SCHED", "HRTIMER", "RCU"
 };
 
+/*
+ * Time each vector may run per __do_softirq() invocation, in us, before
+ * it is deferred to ksoftirqd. 0 means no per vector limit. Only the
+ * bulk processing vectors are limited by default, so that e.g. a NET_RX
+ * flood does not hold up timers and block completions behind it.
+ */
+int softirq_budget_us[NR_SOFTIRQS] = {
+	[NET_TX_SOFTIRQ]	= 1000,
+	[NET_RX_SOFTIRQ]	= 1000,
+	[BLOCK_IOPOLL_SOFTIRQ]	= 1000,
+	[TASKLET_SOFTIRQ]	= 1000,
+};
+
+/* Vectors left to ksoftirqd, skipped on irq exit and bh enable */
+static DEFINE_PER_CPU(__u32, softirq_deferred);
+
+struct softirq_raise_time {
+	u64	at[NR_SOFTIRQS];
+};
+static DEFINE_PER_CPU(struct softirq_raise_time, softirq_raised);
+
+/* Pending vectors which may be processed outside of ksoftirqd */
+static inline __u32 local_softirq_runnable(void)
+{
+	return local_softirq_pending() & ~__this_cpu_read(softirq_deferred);
+}
+
 /*
  * we cannot loop indefinitely here to avoid userspace starvation,
  * but we also don't want to introduce a worst case 1/HZ latency
@@ -170,7 +197,7 @@ static inline void _local_bh_enable_ip(unsigned long ip)
  	 */
 	sub_preempt_count(SOFTIRQ_DISABLE_OFFSET - 1);
 
-	if (unlikely(!in_interrupt() && local_softirq_pending()))
+	if (unlikely(!in_interrupt() && local_softirq_runnable()))
 		do_softirq();
 
 	dec_preempt_count();
@@ -200,6 +227,10 @@ EXPORT_SYMBOL(local_bh_enable_ip);
  * increment and so we need the MAX_SOFTIRQ_RESTART limit as
  * well to make sure we eventually return from this method.
  *
+ * Within those limits a vector which has used up its softirq_budget_us
+ * and is raised again is deferred to ksoftirqd on its own, while the
+ * other vectors keep being processed here.
+ *
  * These limits have been established via experimentation.
  * The two things to balance is latency against fairness -
  * we want to handle softirqs as soon as possible, but they
@@ -208,11 +239,31 @@ EXPORT_SYMBOL(local_bh_enable_ip);
 #define MAX_SOFTIRQ_TIME  msecs_to_jiffies(2)
 #define MAX_SOFTIRQ_RESTART 10
 
+static __u32 softirq_overrun(__u32 pending, const u64 *runtime)
+{
+	__u32 overrun = 0;
+	unsigned int vec_nr;
+	int budget;
+
+	for (vec_nr = 0; pending; vec_nr++, pending >>= 1) {
+		if (!(pending & 1))
+			continue;
+		budget = ACCESS_ONCE(softirq_budget_us[vec_nr]);
+		if (budget && runtime[vec_nr] >= (u64)budget * NSEC_PER_USEC) {
+			__this_cpu_inc(kstat.softirqs_deferred[vec_nr]);
+			overrun |= 1U << vec_nr;
+		}
+	}
+	return overrun;
+}
+
 asmlinkage void __do_softirq(void)
 {
 	struct softirq_action *h;
-	__u32 pending;
+	__u32 pending, deferred;
 	unsigned long end = jiffies + MAX_SOFTIRQ_TIME;
+	u64 runtime[NR_SOFTIRQS] = { 0 };
+	u64 now, then;
 	int cpu;
 	unsigned long old_flags = current->flags;
 	int max_restart = MAX_SOFTIRQ_RESTART;
@@ -232,21 +283,35 @@ asmlinkage void __do_softirq(void)
 	lockdep_softirq_enter();
 
 	cpu = smp_processor_id();
+
+	/* ksoftirqd is where the deferred vectors are processed */
+	if (current == __this_cpu_read(ksoftirqd))
+		__this_cpu_write(softirq_deferred, 0);
+	deferred = __this_cpu_read(softirq_deferred);
 restart:
 	/* Reset the pending bitmask before enabling irqs */
-	set_softirq_pending(0);
+	set_softirq_pending(pending & deferred);
+	pending &= ~deferred;
 
 	local_irq_enable();
 
 	h = softirq_vec;
+	now = local_clock();
 
-	do {
+	while (pending) {
 		if (pending & 1) {
 			unsigned int vec_nr = h - softirq_vec;
 			int prev_count = preempt_count();
+			u64 latency;
 
 			kstat_incr_softirqs_this_cpu(vec_nr);
 
+			latency = now - __this_cpu_read(softirq_raised.at[vec_nr]);
+			if ((s64)latency > 0 && latency >
+			    __this_cpu_read(kstat.softirq_latency_max[vec_nr]))
+				__this_cpu_write(kstat.softirq_latency_max[vec_nr],
+						 latency);
+
 			trace_softirq_entry(vec_nr);
 			h->action(h);
 			trace_softirq_exit(vec_nr);
@@ -260,17 +325,25 @@ restart:
 			}
 
 			rcu_bh_qs(cpu);
+
+			then = local_clock();
+			runtime[vec_nr] += then - now;
+			__this_cpu_add(kstat.softirq_time[vec_nr], then - now);
+			now = then;
 		}
 		h++;
 		pending >>= 1;
-	} while (pending);
+	}
 
 	local_irq_disable();
 
 	pending = local_softirq_pending();
 	if (pending) {
-		if (time_before(jiffies, end) && !need_resched() &&
-		    --max_restart)
+		deferred |= softirq_overrun(pending & ~deferred, runtime);
+		__this_cpu_write(softirq_deferred, deferred);
+
+		if ((pending & ~deferred) && time_before(jiffies, end) &&
+		    !need_resched() && --max_restart)
 			goto restart;
 
 		wakeup_softirqd();
@@ -295,7 +368,7 @@ asmlinkage void do_softirq(void)
 
 	local_irq_save(flags);
 
-	pending = local_softirq_pending();
+	pending = local_softirq_runnable();
 
 	if (pending)
 		__do_softirq();
@@ -370,7 +443,7 @@ void irq_exit(void)
 	account_irq_exit_time(current);
 	trace_hardirq_exit();
 	sub_preempt_count(HARDIRQ_OFFSET);
-	if (!in_interrupt() && local_softirq_pending())
+	if (!in_interrupt() && local_softirq_runnable())
 		invoke_softirq();
 
 	tick_irq_exit();
@@ -409,6 +482,8 @@ void raise_softirq(unsigned int nr)
 void __raise_softirq_irqoff(unsigned int nr)
 {
 	trace_softirq_raise(nr);
+	if (!(local_softirq_pending() & (1UL << nr)))
+		__this_cpu_write(softirq_raised.at[nr], local_clock());
 	or_softirq_pending(1UL << nr);
 }
 
@@ -46,23 +46,30 @@
 #define BUILD_LOCK_OPS(op, locktype)					\
 void __lockfunc __raw_##op##_lock(locktype##_t *lock)			\
 {									\
+	u64 contended = 0;						\
+									\
 	for (;;) {							\
 		preempt_disable();					\
 		if (likely(do_raw_##op##_trylock(lock)))		\
 			break;						\
 		preempt_enable();					\
 									\
+		if (lock_contention_enabled && !contended)		\
+			contended = lock_contention_begin(lock, _RET_IP_);\
 		if (!(lock)->break_lock)				\
 			(lock)->break_lock = 1;				\
 		while (!raw_##op##_can_lock(lock) && (lock)->break_lock)\
 			arch_##op##_relax(&lock->raw_lock);		\
 	}								\
 	(lock)->break_lock = 0;						\
+	if (contended)							\
+		lock_contention_end(lock, _RET_IP_, contended);		\
 }									\
 									\
 unsigned long __lockfunc __raw_##op##_lock_irqsave(locktype##_t *lock)	\
 {									\
 	unsigned long flags;						\
+	u64 contended = 0;						\
 									\
 	for (;;) {							\
 		preempt_disable();					\
@@ -72,12 +79,16 @@ unsigned long __lockfunc __raw_##op##_lock_irqsave(locktype##_t *lock)	\
 		local_irq_restore(flags);				\
 		preempt_enable();					\
 									\
+		if (lock_contention_enabled && !contended)		\
+			contended = lock_contention_begin(lock, _RET_IP_);\
 		if (!(lock)->break_lock)				\
 			(lock)->break_lock = 1;				\
 		while (!raw_##op##_can_lock(lock) && (lock)->break_lock)\
 			arch_##op##_relax(&lock->raw_lock);		\
 	}								\
 	(lock)->break_lock = 0;						\
+	if (contended)							\
+		lock_contention_end(lock, _RET_IP_, contended);		\
 	return flags;							\
 }									\
 									\
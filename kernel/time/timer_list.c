@@ -193,6 +193,23 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 
 #undef P
 #undef P_ns
+
+#define P(x) \
+	SEQ_printf(m, "  .%-15s: %Lu\n", #x, \
+		   (unsigned long long)(tstats.x))
+	{
+		struct timer_base_stats tstats;
+
+		timer_get_base_stats(cpu, &tstats);
+		SEQ_printf(m, " timer wheel:\n");
+		P(timer_jiffies);
+		P(next_timer);
+		P(active_timers);
+		P(pending_buckets);
+		P(nr_requeue_skipped);
+		P(nr_migrated);
+	}
+#undef P
 	SEQ_printf(m, "\n");
 }
 
@@ -256,7 +273,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.7\n");
+	SEQ_printf(m, "Timer List Version: v0.8\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
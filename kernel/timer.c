@@ -57,23 +57,61 @@ u64 jiffies_64 __cacheline_aligned_in_smp = INITIAL_JIFFIES;
 EXPORT_SYMBOL(jiffies_64);
 
 /*
- * per-CPU timer vector definitions:
+ * The timer wheel has LVL_DEPTH array levels of LVL_SIZE buckets each.
+ * Every level is driven by its own clock and so has its own granularity:
+ * the clock of level n ticks every LVL_CLK_DIV^n jiffies.  A timer is
+ * queued into the lowest level whose range covers its expiry time, with
+ * the expiry rounded up to the granularity of that level, and is never
+ * moved to a lower level afterwards.
+ *
+ * The classic wheel kept timers "exact" by cascading them down a level
+ * every time a lower level wrapped, which meant rehashing every timer of
+ * a bucket in one go from softirq context.  Most timers with long
+ * timeouts (networking, I/O) are cancelled or rearmed long before they
+ * expire, so the precision was paid for and then thrown away.  Here the
+ * price of a long timeout is a lower precision instead: a timer never
+ * fires early, but may fire up to about 12.5% of its timeout late.
+ *
+ * HZ 1000 steps
+ * Level Offset  Granularity            Range
+ *  0      0         1 ms                0 ms -         62 ms
+ *  1     64         8 ms               63 ms -        503 ms
+ *  2    128        64 ms              504 ms -       4031 ms (~4s)
+ *  3    192       512 ms             4032 ms -      32255 ms (~32s)
+ *  4    256      4096 ms (~4s)      32256 ms -     258047 ms (~4m)
+ *  5    320     32768 ms (~32s)    258048 ms -    2064383 ms (~34m)
+ *  6    384    262144 ms (~4m)    2064384 ms -   16515071 ms (~4h)
+ *  7    448   2097152 ms (~34m)  16515072 ms -  132120575 ms (~1d)
+ *  8    512  16777216 ms (~4h)  132120576 ms - 1056964607 ms (~12d)
+ *
+ * Timers beyond the range of the last level are queued at its end.
  */
-#define TVN_BITS (CONFIG_BASE_SMALL ? 4 : 6)
-#define TVR_BITS (CONFIG_BASE_SMALL ? 6 : 8)
-#define TVN_SIZE (1 << TVN_BITS)
-#define TVR_SIZE (1 << TVR_BITS)
-#define TVN_MASK (TVN_SIZE - 1)
-#define TVR_MASK (TVR_SIZE - 1)
-#define MAX_TVAL ((unsigned long)((1ULL << (TVR_BITS + 4*TVN_BITS)) - 1))
-
-struct tvec {
-	struct list_head vec[TVN_SIZE];
-};
+#define LVL_CLK_SHIFT	3
+#define LVL_CLK_DIV	(1UL << LVL_CLK_SHIFT)
+#define LVL_CLK_MASK	(LVL_CLK_DIV - 1)
+#define LVL_SHIFT(n)	((n) * LVL_CLK_SHIFT)
+#define LVL_GRAN(n)	(1UL << LVL_SHIFT(n))
+
+/* Timeouts from LVL_START(n) on go to level n */
+#define LVL_START(n)	((LVL_SIZE - 1) << (((n) - 1) * LVL_CLK_SHIFT))
+
+#define LVL_BITS	6
+#define LVL_SIZE	(1UL << LVL_BITS)
+#define LVL_MASK	(LVL_SIZE - 1)
+#define LVL_OFFS(n)	((n) * LVL_SIZE)
+
+/* Level depth */
+#if HZ > 100
+# define LVL_DEPTH	9
+#else
+# define LVL_DEPTH	8
+#endif
 
-struct tvec_root {
-	struct list_head vec[TVR_SIZE];
-};
+/* The cutoff (max. capacity of the wheel) */
+#define WHEEL_TIMEOUT_CUTOFF	(LVL_START(LVL_DEPTH))
+#define WHEEL_TIMEOUT_MAX	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
+
+#define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
 struct tvec_base {
 	spinlock_t lock;
@@ -81,11 +119,11 @@ struct tvec_base {
 	unsigned long timer_jiffies;
 	unsigned long next_timer;
 	unsigned long active_timers;
-	struct tvec_root tv1;
-	struct tvec tv2;
-	struct tvec tv3;
-	struct tvec tv4;
-	struct tvec tv5;
+	int cpu;
+	unsigned long nr_requeue_skipped;
+	unsigned long nr_migrated;
+	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
+	struct list_head vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
 
 struct tvec_base boot_tvec_bases;
@@ -328,8 +366,8 @@ EXPORT_SYMBOL_GPL(round_jiffies_up_relative);
  * will schedule the actual timer somewhere between
  * the time mod_timer() asks for, and that time plus the slack.
  *
- * By setting the slack to -1, a percentage of the delay is used
- * instead.
+ * By setting the slack to -1, only the granularity of the timer wheel
+ * level the timer ends up in applies.
  */
 void set_timer_slack(struct timer_list *timer, int slack_hz)
 {
@@ -337,61 +375,89 @@ void set_timer_slack(struct timer_list *timer, int slack_hz)
 }
 EXPORT_SYMBOL_GPL(set_timer_slack);
 
-static void
-__internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+/*
+ * Bucket of level @lvl for a timer expiring at @expires.  The expiry is
+ * rounded up to the granularity of the level, so that the timer never
+ * fires early, and the rounded value is returned in @bucket_expiry.
+ */
+static inline unsigned int calc_index(unsigned long expires, unsigned int lvl,
+				      unsigned long *bucket_expiry)
 {
-	unsigned long expires = timer->expires;
-	unsigned long idx = expires - base->timer_jiffies;
-	struct list_head *vec;
+	expires = (expires + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+	*bucket_expiry = expires << LVL_SHIFT(lvl);
+	return LVL_OFFS(lvl) + (expires & LVL_MASK);
+}
 
-	if (idx < TVR_SIZE) {
-		int i = expires & TVR_MASK;
-		vec = base->tv1.vec + i;
-	} else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
-		int i = (expires >> TVR_BITS) & TVN_MASK;
-		vec = base->tv2.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK;
-		vec = base->tv3.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv4.vec + i;
-	} else if ((signed long) idx < 0) {
+static unsigned int calc_wheel_index(unsigned long expires, unsigned long clk,
+				     unsigned long *bucket_expiry)
+{
+	unsigned long delta = expires - clk;
+	unsigned int lvl;
+
+	if ((long)delta < 0) {
 		/*
 		 * Can happen if you add a timer with expires == jiffies,
 		 * or you set a timer to go off in the past
 		 */
-		vec = base->tv1.vec + (base->timer_jiffies & TVR_MASK);
-	} else {
-		int i;
-		/* If the timeout is larger than MAX_TVAL (on 64-bit
-		 * architectures or with CONFIG_BASE_SMALL=1) then we
-		 * use the maximum timeout.
-		 */
-		if (idx > MAX_TVAL) {
-			idx = MAX_TVAL;
-			expires = idx + base->timer_jiffies;
-		}
-		i = (expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv5.vec + i;
+		*bucket_expiry = clk;
+		return clk & LVL_MASK;
+	}
+
+	for (lvl = 0; lvl < LVL_DEPTH - 1; lvl++) {
+		if (delta < LVL_START(lvl + 1))
+			return calc_index(expires, lvl, bucket_expiry);
 	}
+
+	/*
+	 * If the timeout is larger than the capacity of the wheel, force
+	 * it to expire at the capacity.
+	 */
+	if (delta >= WHEEL_TIMEOUT_CUTOFF)
+		expires = clk + WHEEL_TIMEOUT_MAX;
+	return calc_index(expires, LVL_DEPTH - 1, bucket_expiry);
+}
+
+static void enqueue_timer(struct tvec_base *base, struct timer_list *timer,
+			  unsigned int idx)
+{
 	/*
 	 * Timers are FIFO:
 	 */
-	list_add_tail(&timer->entry, vec);
+	list_add_tail(&timer->entry, base->vectors + idx);
+	__set_bit(idx, base->pending_map);
+	timer->bucket = idx;
 }
 
-static void internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+/*
+ * Returns true if the first expiry of @base may have moved earlier, i.e.
+ * a CPU sleeping on the previous one has to look at the wheel again.
+ */
+static bool internal_add_timer(struct tvec_base *base, struct timer_list *timer)
 {
-	__internal_add_timer(base, timer);
+	unsigned long bucket_expiry;
+	unsigned int idx;
+
+	idx = calc_wheel_index(timer->expires, base->timer_jiffies,
+			       &bucket_expiry);
+	enqueue_timer(base, timer, idx);
+	if (tbase_get_deferrable(timer->base))
+		return false;
 	/*
-	 * Update base->active_timers and base->next_timer
+	 * Update base->active_timers and base->next_timer. A next_timer
+	 * at or before timer_jiffies is stale and gets recomputed on the
+	 * next lookup, so nothing is known about it.
 	 */
-	if (!tbase_get_deferrable(timer->base)) {
-		if (time_before(timer->expires, base->next_timer))
-			base->next_timer = timer->expires;
-		base->active_timers++;
+	if (!base->active_timers++) {
+		base->next_timer = bucket_expiry;
+		return true;
+	}
+	if (time_before_eq(base->next_timer, base->timer_jiffies))
+		return true;
+	if (time_before(bucket_expiry, base->next_timer)) {
+		base->next_timer = bucket_expiry;
+		return true;
 	}
+	return false;
 }
 
 #ifdef CONFIG_TIMER_STATS
@@ -676,15 +742,28 @@ detach_expired_timer(struct timer_list *timer, struct tvec_base *base)
 static int detach_if_pending(struct timer_list *timer, struct tvec_base *base,
 			     bool clear_pending)
 {
+	unsigned int idx = timer->bucket;
+	struct list_head *vec;
+
 	if (!timer_pending(timer))
 		return 0;
 
-	detach_timer(timer, clear_pending);
-	if (!tbase_get_deferrable(timer->base)) {
-		base->active_timers--;
-		if (timer->expires == base->next_timer)
+	vec = base->vectors + idx;
+
+	/*
+	 * An expired timer sits on a private list of __run_timers() and
+	 * never matches its bucket head here.
+	 */
+	if (timer->entry.next == vec && timer->entry.prev == vec) {
+		__clear_bit(idx, base->pending_map);
+		/* The cached next expiry may have gone with it */
+		if (!tbase_get_deferrable(timer->base))
 			base->next_timer = base->timer_jiffies;
 	}
+
+	detach_timer(timer, clear_pending);
+	if (!tbase_get_deferrable(timer->base))
+		base->active_timers--;
 	return 1;
 }
 
@@ -720,6 +799,99 @@ static struct tvec_base *lock_timer_base(struct timer_list *timer,
 	}
 }
 
+static bool bucket_has_active(struct tvec_base *base, unsigned int idx)
+{
+	struct timer_list *timer;
+
+	list_for_each_entry(timer, base->vectors + idx, entry) {
+		if (!tbase_get_deferrable(timer->base))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Distance from @clk to the first pending bucket of the level starting at
+ * @offset, or -1 if there is none.  Unless @deferrable is set, buckets
+ * holding nothing but deferrable timers are skipped.
+ */
+static int next_pending_bucket(struct tvec_base *base, unsigned int offset,
+			       unsigned int clk, bool deferrable)
+{
+	unsigned int pos, start = offset + clk, end = offset + LVL_SIZE;
+
+	for (pos = find_next_bit(base->pending_map, end, start); pos < end;
+	     pos = find_next_bit(base->pending_map, end, pos + 1)) {
+		if (deferrable || bucket_has_active(base, pos))
+			return pos - start;
+	}
+	for (pos = find_next_bit(base->pending_map, start, offset); pos < start;
+	     pos = find_next_bit(base->pending_map, start, pos + 1)) {
+		if (deferrable || bucket_has_active(base, pos))
+			return pos + LVL_SIZE - start;
+	}
+	return -1;
+}
+
+/*
+ * Find the jiffy at which the first pending bucket of @base is due.  The
+ * caller must hold the base lock.
+ */
+static unsigned long __next_timer_interrupt(struct tvec_base *base,
+					    bool deferrable)
+{
+	unsigned long clk, next, adj;
+	unsigned int lvl, offset = 0;
+
+	next = base->timer_jiffies + NEXT_TIMER_MAX_DELTA;
+	clk = base->timer_jiffies;
+	for (lvl = 0; lvl < LVL_DEPTH; lvl++, offset += LVL_SIZE) {
+		int pos = next_pending_bucket(base, offset, clk & LVL_MASK,
+					      deferrable);
+
+		if (pos >= 0) {
+			unsigned long tmp = clk + (unsigned long)pos;
+
+			tmp <<= LVL_SHIFT(lvl);
+			if (time_before(tmp, next))
+				next = tmp;
+		}
+		/*
+		 * Clock of the next level.  If the lower bits of this
+		 * level's clock are zero, the next level is due at its
+		 * current index; otherwise that index has already been
+		 * passed and its next bucket is the one after.  This also
+		 * covers the case where the increment carries into the
+		 * level above.
+		 */
+		adj = clk & LVL_CLK_MASK ? 1 : 0;
+		clk >>= LVL_CLK_SHIFT;
+		clk += adj;
+	}
+	return next;
+}
+
+/*
+ * A CPU whose tick was stopped has not run the timer softirq for a while,
+ * leaving ->timer_jiffies behind jiffies.  Queueing relative to such a
+ * stale clock would put timers in needlessly coarse levels, so move the
+ * clock forward first, as far as the first pending bucket allows.
+ */
+static void forward_timer_base(struct tvec_base *base)
+{
+	unsigned long jnow = ACCESS_ONCE(jiffies);
+	unsigned long next;
+
+	if ((long)(jnow - base->timer_jiffies) < 2)
+		return;
+
+	next = __next_timer_interrupt(base, true);
+	if (time_after(next, jnow))
+		base->timer_jiffies = jnow;
+	else if (time_after(next, base->timer_jiffies))
+		base->timer_jiffies = next;
+}
+
 static inline int
 __mod_timer(struct timer_list *timer, unsigned long expires,
 						bool pending_only, int pinned)
@@ -727,12 +899,34 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	struct tvec_base *base, *new_base;
 	unsigned long flags;
 	int ret = 0 , cpu;
+	bool first;
 
 	timer_stats_timer_set_start_info(timer);
 	BUG_ON(!timer->function);
 
 	base = lock_timer_base(timer, &flags);
 
+	/*
+	 * Networking rearms its timers on nearly every packet, mostly by a
+	 * few jiffies at a time.  If the timer would land in the bucket it
+	 * already sits in, just update its expiry.  Not while __run_timers()
+	 * is expiring timers on this base: the timer may be sitting on its
+	 * private list rather than in a bucket.
+	 */
+	if (timer_pending(timer) && !base->running_timer &&
+	    (!pinned || base == __this_cpu_read(tvec_bases))) {
+		unsigned long bucket_expiry;
+
+		forward_timer_base(base);
+		if (calc_wheel_index(expires, base->timer_jiffies,
+				     &bucket_expiry) == timer->bucket) {
+			timer->expires = expires;
+			base->nr_requeue_skipped++;
+			ret = 1;
+			goto out_unlock;
+		}
+	}
+
 	ret = detach_if_pending(timer, base, false);
 	if (!ret && pending_only)
 		goto out_unlock;
@@ -742,7 +936,7 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	cpu = smp_processor_id();
 
 #if defined(CONFIG_NO_HZ_COMMON) && defined(CONFIG_SMP)
-	if (!pinned && get_sysctl_timer_migration() && idle_cpu(cpu))
+	if (!pinned && get_sysctl_timer_migration())
 		cpu = get_nohz_timer_target();
 #endif
 	new_base = per_cpu(tvec_bases, cpu);
@@ -765,8 +959,20 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 		}
 	}
 
+	forward_timer_base(base);
 	timer->expires = expires;
-	internal_add_timer(base, timer);
+	first = internal_add_timer(base, timer);
+
+	/*
+	 * get_nohz_timer_target() may pick an idle housekeeping CPU, which
+	 * then has to reevaluate its next timer event, but only if this
+	 * timer comes before the one it is already waiting for.
+	 */
+	if (base->cpu != smp_processor_id()) {
+		base->nr_migrated++;
+		if (first)
+			wake_up_nohz_cpu(base->cpu);
+	}
 
 out_unlock:
 	spin_unlock_irqrestore(&base->lock, flags);
@@ -806,16 +1012,15 @@ unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
 	unsigned long expires_limit, mask;
 	int bit;
 
-	if (timer->slack >= 0) {
-		expires_limit = expires + timer->slack;
-	} else {
-		long delta = expires - jiffies;
-
-		if (delta < 256)
-			return expires;
+	/*
+	 * Without explicit slack there is nothing to do: the wheel level
+	 * granularity already batches long timeouts far more coarsely than
+	 * the 0.4% this used to add.
+	 */
+	if (timer->slack < 0)
+		return expires;
 
-		expires_limit = expires + delta / 256;
-	}
+	expires_limit = expires + timer->slack;
 	mask = expires ^ expires_limit;
 	if (mask == 0)
 		return expires;
@@ -931,6 +1136,7 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	spin_lock_irqsave(&base->lock, flags);
 	timer_set_base(timer, base);
 	debug_activate(timer, timer->expires);
+	forward_timer_base(base);
 	internal_add_timer(base, timer);
 	/*
 	 * Check whether the other CPU is in dynticks mode and needs
@@ -1068,27 +1274,6 @@ int del_timer_sync(struct timer_list *timer)
 EXPORT_SYMBOL(del_timer_sync);
 #endif
 
-static int cascade(struct tvec_base *base, struct tvec *tv, int index)
-{
-	/* cascade all the timers from tv up one level */
-	struct timer_list *timer, *tmp;
-	struct list_head tv_list;
-
-	list_replace_init(tv->vec + index, &tv_list);
-
-	/*
-	 * We are removing _all_ timers from the list, so we
-	 * don't have to detach them individually.
-	 */
-	list_for_each_entry_safe(timer, tmp, &tv_list, entry) {
-		BUG_ON(tbase_get_base(timer->base) != base);
-		/* No accounting, while moving them */
-		__internal_add_timer(base, timer);
-	}
-
-	return index;
-}
-
 static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 			  unsigned long data)
 {
@@ -1132,141 +1317,87 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 	}
 }
 
-#define INDEX(N) ((base->timer_jiffies >> (TVR_BITS + (N) * TVN_BITS)) & TVN_MASK)
+static void expire_timers(struct tvec_base *base, struct list_head *head)
+{
+	while (!list_empty(head)) {
+		struct timer_list *timer;
+		void (*fn)(unsigned long);
+		unsigned long data;
+		bool irqsafe;
+
+		timer = list_first_entry(head, struct timer_list, entry);
+		fn = timer->function;
+		data = timer->data;
+		irqsafe = tbase_get_irqsafe(timer->base);
+
+		timer_stats_account_timer(timer);
+
+		base->running_timer = timer;
+		detach_expired_timer(timer, base);
+
+		if (irqsafe) {
+			spin_unlock(&base->lock);
+			call_timer_fn(timer, fn, data);
+			spin_lock(&base->lock);
+		} else {
+			spin_unlock_irq(&base->lock);
+			call_timer_fn(timer, fn, data);
+			spin_lock_irq(&base->lock);
+		}
+	}
+}
+
+/*
+ * Move the buckets due at ->timer_jiffies onto @heads, one per level.
+ * Level n is only due when the lower n * LVL_CLK_SHIFT bits of the clock
+ * are zero.  Returns the number of lists filled in.
+ */
+static int collect_expired_timers(struct tvec_base *base,
+				  struct list_head *heads)
+{
+	unsigned long clk = base->timer_jiffies;
+	unsigned int idx;
+	int i, levels = 0;
+
+	for (i = 0; i < LVL_DEPTH; i++) {
+		idx = (clk & LVL_MASK) + i * LVL_SIZE;
+
+		if (__test_and_clear_bit(idx, base->pending_map))
+			list_replace_init(base->vectors + idx, heads + levels++);
+		/* Is it time to look at the next level? */
+		if (clk & LVL_CLK_MASK)
+			break;
+		/* Shift clock for the next level granularity */
+		clk >>= LVL_CLK_SHIFT;
+	}
+	return levels;
+}
 
 /**
  * __run_timers - run all expired timers (if any) on this CPU.
  * @base: the timer vector to be processed.
  *
- * This function cascades all vectors and executes all expired timer
- * vectors.
+ * This function executes all expired timer vectors.  Timers are never
+ * cascaded between levels, so the cost of a tick does not depend on the
+ * number of timers queued for later.
  */
 static inline void __run_timers(struct tvec_base *base)
 {
-	struct timer_list *timer;
+	struct list_head heads[LVL_DEPTH];
+	int levels;
 
 	spin_lock_irq(&base->lock);
 	while (time_after_eq(jiffies, base->timer_jiffies)) {
-		struct list_head work_list;
-		struct list_head *head = &work_list;
-		int index = base->timer_jiffies & TVR_MASK;
-
-		/*
-		 * Cascade timers:
-		 */
-		if (!index &&
-			(!cascade(base, &base->tv2, INDEX(0))) &&
-				(!cascade(base, &base->tv3, INDEX(1))) &&
-					!cascade(base, &base->tv4, INDEX(2)))
-			cascade(base, &base->tv5, INDEX(3));
+		levels = collect_expired_timers(base, heads);
 		++base->timer_jiffies;
-		list_replace_init(base->tv1.vec + index, &work_list);
-		while (!list_empty(head)) {
-			void (*fn)(unsigned long);
-			unsigned long data;
-			bool irqsafe;
-
-			timer = list_first_entry(head, struct timer_list,entry);
-			fn = timer->function;
-			data = timer->data;
-			irqsafe = tbase_get_irqsafe(timer->base);
-
-			timer_stats_account_timer(timer);
-
-			base->running_timer = timer;
-			detach_expired_timer(timer, base);
-
-			if (irqsafe) {
-				spin_unlock(&base->lock);
-				call_timer_fn(timer, fn, data);
-				spin_lock(&base->lock);
-			} else {
-				spin_unlock_irq(&base->lock);
-				call_timer_fn(timer, fn, data);
-				spin_lock_irq(&base->lock);
-			}
-		}
+		while (levels--)
+			expire_timers(base, heads + levels);
 	}
 	base->running_timer = NULL;
 	spin_unlock_irq(&base->lock);
 }
 
 #ifdef CONFIG_NO_HZ_COMMON
-/*
- * Find out when the next timer event is due to happen. This
- * is used on S/390 to stop all activity when a CPU is idle.
- * This function needs to be called with interrupts disabled.
- */
-static unsigned long __next_timer_interrupt(struct tvec_base *base)
-{
-	unsigned long timer_jiffies = base->timer_jiffies;
-	unsigned long expires = timer_jiffies + NEXT_TIMER_MAX_DELTA;
-	int index, slot, array, found = 0;
-	struct timer_list *nte;
-	struct tvec *varray[4];
-
-	/* Look for timer events in tv1. */
-	index = slot = timer_jiffies & TVR_MASK;
-	do {
-		list_for_each_entry(nte, base->tv1.vec + slot, entry) {
-			if (tbase_get_deferrable(nte->base))
-				continue;
-
-			found = 1;
-			expires = nte->expires;
-			/* Look at the cascade bucket(s)? */
-			if (!index || slot < index)
-				goto cascade;
-			return expires;
-		}
-		slot = (slot + 1) & TVR_MASK;
-	} while (slot != index);
-
-cascade:
-	/* Calculate the next cascade event */
-	if (index)
-		timer_jiffies += TVR_SIZE - index;
-	timer_jiffies >>= TVR_BITS;
-
-	/* Check tv2-tv5. */
-	varray[0] = &base->tv2;
-	varray[1] = &base->tv3;
-	varray[2] = &base->tv4;
-	varray[3] = &base->tv5;
-
-	for (array = 0; array < 4; array++) {
-		struct tvec *varp = varray[array];
-
-		index = slot = timer_jiffies & TVN_MASK;
-		do {
-			list_for_each_entry(nte, varp->vec + slot, entry) {
-				if (tbase_get_deferrable(nte->base))
-					continue;
-
-				found = 1;
-				if (time_before(nte->expires, expires))
-					expires = nte->expires;
-			}
-			/*
-			 * Do we still search for the first timer or are
-			 * we looking up the cascade buckets ?
-			 */
-			if (found) {
-				/* Look at the cascade bucket(s)? */
-				if (!index || slot < index)
-					break;
-				return expires;
-			}
-			slot = (slot + 1) & TVN_MASK;
-		} while (slot != index);
-
-		if (index)
-			timer_jiffies += TVN_SIZE - index;
-		timer_jiffies >>= TVN_BITS;
-	}
-	return expires;
-}
-
 /*
  * Check, if the next hrtimer event is before the next timer wheel
  * event:
@@ -1330,7 +1461,7 @@ unsigned long get_next_timer_interrupt(unsigned long now)
 	spin_lock(&base->lock);
 	if (base->active_timers) {
 		if (time_before_eq(base->next_timer, base->timer_jiffies))
-			base->next_timer = __next_timer_interrupt(base);
+			base->next_timer = __next_timer_interrupt(base, false);
 		expires = base->next_timer;
 	}
 	spin_unlock(&base->lock);
@@ -1342,6 +1473,28 @@ unsigned long get_next_timer_interrupt(unsigned long now)
 }
 #endif
 
+/**
+ * timer_get_base_stats - snapshot the timer wheel of a CPU
+ * @cpu: the CPU whose wheel to look at
+ * @stats: where to store the snapshot
+ *
+ * Used by /proc/timer_list.
+ */
+void timer_get_base_stats(int cpu, struct timer_base_stats *stats)
+{
+	struct tvec_base *base = per_cpu(tvec_bases, cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&base->lock, flags);
+	stats->timer_jiffies = base->timer_jiffies;
+	stats->next_timer = base->next_timer;
+	stats->active_timers = base->active_timers;
+	stats->pending_buckets = bitmap_weight(base->pending_map, WHEEL_SIZE);
+	stats->nr_requeue_skipped = base->nr_requeue_skipped;
+	stats->nr_migrated = base->nr_migrated;
+	spin_unlock_irqrestore(&base->lock, flags);
+}
+
 /*
  * Called from the timer interrupt handler to charge one tick to the current
  * process.  user_tick is 1 if the tick is user time, 0 for system.
@@ -1547,16 +1700,11 @@ static int __cpuinit init_timers_cpu(int cpu)
 		base = per_cpu(tvec_bases, cpu);
 	}
 
+	for (j = 0; j < WHEEL_SIZE; j++)
+		INIT_LIST_HEAD(base->vectors + j);
+	bitmap_zero(base->pending_map, WHEEL_SIZE);
 
-	for (j = 0; j < TVN_SIZE; j++) {
-		INIT_LIST_HEAD(base->tv5.vec + j);
-		INIT_LIST_HEAD(base->tv4.vec + j);
-		INIT_LIST_HEAD(base->tv3.vec + j);
-		INIT_LIST_HEAD(base->tv2.vec + j);
-	}
-	for (j = 0; j < TVR_SIZE; j++)
-		INIT_LIST_HEAD(base->tv1.vec + j);
-
+	base->cpu = cpu;
 	base->timer_jiffies = jiffies;
 	base->next_timer = base->timer_jiffies;
 	base->active_timers = 0;
@@ -1595,14 +1743,9 @@ static void __cpuinit migrate_timers(int cpu)
 
 	BUG_ON(old_base->running_timer);
 
-	for (i = 0; i < TVR_SIZE; i++)
-		migrate_timer_list(new_base, old_base->tv1.vec + i);
-	for (i = 0; i < TVN_SIZE; i++) {
-		migrate_timer_list(new_base, old_base->tv2.vec + i);
-		migrate_timer_list(new_base, old_base->tv3.vec + i);
-		migrate_timer_list(new_base, old_base->tv4.vec + i);
-		migrate_timer_list(new_base, old_base->tv5.vec + i);
-	}
+	forward_timer_base(new_base);
+	for (i = 0; i < WHEEL_SIZE; i++)
+		migrate_timer_list(new_base, old_base->vectors + i);
 
 	spin_unlock(&old_base->lock);
 	spin_unlock_irq(&new_base->lock);
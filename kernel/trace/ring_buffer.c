@@ -469,6 +469,7 @@ struct ring_buffer_per_cpu {
 	struct buffer_page		*tail_page;	/* write to tail */
 	struct buffer_page		*commit_page;	/* committed pages */
 	struct buffer_page		*reader_page;
+	struct buffer_data_page		*free_page;	/* cached read page */
 	unsigned long			lost_events;
 	unsigned long			last_overrun;
 	local_t				entries_bytes;
@@ -1250,6 +1251,7 @@ static void rb_free_cpu_buffer(struct ring_buffer_per_cpu *cpu_buffer)
 	struct buffer_page *bpage, *tmp;
 
 	free_buffer_page(cpu_buffer->reader_page);
+	free_page((unsigned long)cpu_buffer->free_page);
 
 	rb_head_page_deactivate(cpu_buffer);
 
@@ -4360,6 +4362,7 @@ EXPORT_SYMBOL_GPL(ring_buffer_swap_cpu);
 /**
  * ring_buffer_alloc_read_page - allocate a page to read from buffer
  * @buffer: the buffer to allocate for.
+ * @cpu: the cpu buffer the page will be read from.
  *
  * This function is used in conjunction with ring_buffer_read_page.
  * When reading a full page from the ring buffer, these functions
@@ -4369,14 +4372,36 @@ EXPORT_SYMBOL_GPL(ring_buffer_swap_cpu);
  * of this function into ring_buffer_read_page, which will swap
  * the page that was allocated, with the read page of the buffer.
  *
+ * Each cpu buffer caches one page given back through
+ * ring_buffer_free_read_page(), so that a reader splicing page after
+ * page does not go to the page allocator every time.
+ *
  * Returns:
  *  The page allocated, or NULL on error.
  */
 void *ring_buffer_alloc_read_page(struct ring_buffer *buffer, int cpu)
 {
-	struct buffer_data_page *bpage;
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct buffer_data_page *bpage = NULL;
+	unsigned long flags;
 	struct page *page;
 
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return NULL;
+
+	cpu_buffer = buffer->buffers[cpu];
+	local_irq_save(flags);
+	arch_spin_lock(&cpu_buffer->lock);
+	if (cpu_buffer->free_page) {
+		bpage = cpu_buffer->free_page;
+		cpu_buffer->free_page = NULL;
+	}
+	arch_spin_unlock(&cpu_buffer->lock);
+	local_irq_restore(flags);
+
+	if (bpage)
+		goto out;
+
 	page = alloc_pages_node(cpu_to_node(cpu),
 				GFP_KERNEL | __GFP_NORETRY, 0);
 	if (!page)
@@ -4384,6 +4409,7 @@ void *ring_buffer_alloc_read_page(struct ring_buffer *buffer, int cpu)
 
 	bpage = page_address(page);
 
+ out:
 	rb_init_page(bpage);
 
 	return bpage;
@@ -4393,13 +4419,39 @@ EXPORT_SYMBOL_GPL(ring_buffer_alloc_read_page);
 /**
  * ring_buffer_free_read_page - free an allocated read page
  * @buffer: the buffer the page was allocate for
+ * @cpu: the cpu buffer the page was allocated for
  * @data: the page to free
  *
- * Free a page allocated from ring_buffer_alloc_read_page.
+ * Free a page allocated from ring_buffer_alloc_read_page.  The page
+ * is kept for the next ring_buffer_alloc_read_page() on @cpu if that
+ * cpu buffer has no cached page yet and nobody else holds a reference
+ * to it.  The caller must make sure @buffer is not freed meanwhile;
+ * a page that can outlive it is released with free_page() instead.
  */
-void ring_buffer_free_read_page(struct ring_buffer *buffer, void *data)
+void ring_buffer_free_read_page(struct ring_buffer *buffer, int cpu,
+				void *data)
 {
-	free_page((unsigned long)data);
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct buffer_data_page *bpage = data;
+	unsigned long flags;
+
+	/* A spliced page may still be mapped by someone else */
+	if (!cpumask_test_cpu(cpu, buffer->cpumask) ||
+	    page_count(virt_to_page(bpage)) > 1)
+		goto out;
+
+	cpu_buffer = buffer->buffers[cpu];
+	local_irq_save(flags);
+	arch_spin_lock(&cpu_buffer->lock);
+	if (!cpu_buffer->free_page) {
+		cpu_buffer->free_page = bpage;
+		bpage = NULL;
+	}
+	arch_spin_unlock(&cpu_buffer->lock);
+	local_irq_restore(flags);
+
+ out:
+	free_page((unsigned long)bpage);
 }
 EXPORT_SYMBOL_GPL(ring_buffer_free_read_page);
 
@@ -7,6 +7,7 @@
 #include <linux/completion.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
+#include <linux/math64.h>
 #include <linux/time.h>
 #include <asm/local.h>
 
@@ -40,6 +41,14 @@ static int write_iteration = 50;
 module_param(write_iteration, uint, 0644);
 MODULE_PARM_DESC(write_iteration, "# of writes between timestamp readings");
 
+static int filter_keep;
+module_param(filter_keep, uint, 0644);
+MODULE_PARM_DESC(filter_keep, "filter events, keeping 1 in filter_keep (0: no filter)");
+
+static int filter_early = 1;
+module_param(filter_early, uint, 0644);
+MODULE_PARM_DESC(filter_early, "filter before reserving instead of discarding after");
+
 static int producer_nice = 19;
 static int consumer_nice = 19;
 
@@ -75,6 +84,49 @@ enum event_status {
 	EVENT_DROPPED,
 };
 
+enum write_status {
+	WRITE_HIT,
+	WRITE_MISSED,
+	WRITE_FILTERED,
+};
+
+/*
+ * Write an event that goes through a filter on its second word, the
+ * way a filtered trace event does.  With filter_early the event is
+ * built on the stack and only written out if it passes, otherwise it
+ * is reserved, filled in and discarded if it does not.
+ */
+static enum write_status write_filtered_event(unsigned int seq)
+{
+	struct ring_buffer_event *event;
+	int *entry;
+
+	if (filter_early) {
+		int data[3] = { get_cpu(), seq };
+		enum write_status ret = WRITE_FILTERED;
+
+		if (!(data[1] % filter_keep))
+			ret = ring_buffer_write(buffer, 10, data) ?
+				WRITE_MISSED : WRITE_HIT;
+		put_cpu();
+		return ret;
+	}
+
+	event = ring_buffer_lock_reserve(buffer, 10);
+	if (!event)
+		return WRITE_MISSED;
+
+	entry = ring_buffer_event_data(event);
+	entry[0] = smp_processor_id();
+	entry[1] = seq;
+	if (entry[1] % filter_keep) {
+		ring_buffer_discard_commit(buffer, event);
+		return WRITE_FILTERED;
+	}
+	ring_buffer_unlock_commit(buffer, event);
+	return WRITE_HIT;
+}
+
 static enum event_status read_event(int cpu)
 {
 	struct ring_buffer_event *event;
@@ -165,7 +217,7 @@ static enum event_status read_page(int cpu)
 			}
 		}
 	}
-	ring_buffer_free_read_page(buffer, bpage);
+	ring_buffer_free_read_page(buffer, cpu, bpage);
 
 	if (ret < 0)
 		return EVENT_DROPPED;
@@ -218,8 +270,11 @@ static void ring_buffer_producer(void)
 	unsigned long long time;
 	unsigned long long entries;
 	unsigned long long overruns;
+	unsigned long long events;
 	unsigned long missed = 0;
 	unsigned long hit = 0;
+	unsigned long filtered = 0;
+	unsigned int seq = 0;
 	unsigned long avg;
 	int cnt = 0;
 
@@ -235,6 +290,21 @@ static void ring_buffer_producer(void)
 		int i;
 
 		for (i = 0; i < write_iteration; i++) {
+			if (filter_keep) {
+				switch (write_filtered_event(seq++)) {
+				case WRITE_HIT:
+					hit++;
+					break;
+				case WRITE_MISSED:
+					missed++;
+					break;
+				case WRITE_FILTERED:
+					filtered++;
+					break;
+				}
+				continue;
+			}
+
 			event = ring_buffer_lock_reserve(buffer, 10);
 			if (!event) {
 				missed++;
@@ -322,6 +392,16 @@ static void ring_buffer_producer(void)
 	trace_printk("Total:    %lld\n", entries + overruns + read);
 	trace_printk("Missed:   %ld\n", missed);
 	trace_printk("Hit:      %ld\n", hit);
+	if (filter_keep)
+		trace_printk("Filtered: %ld  (keep 1 in %d, %s reserve)\n",
+			     filtered, filter_keep,
+			     filter_early ? "before" : "after");
+
+	/* every event the producer generated, written or not */
+	events = (unsigned long long)hit + missed + filtered;
+	if (time)
+		trace_printk("Events per second: %llu\n",
+			     div64_u64(events * USEC_PER_SEC, time));
 
 	/* Convert time from usecs to millisecs */
 	do_div(time, USEC_PER_MSEC);
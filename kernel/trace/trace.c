@@ -1553,11 +1553,102 @@ trace_buffer_lock_reserve(struct ring_buffer *buffer,
 	return event;
 }
 
+/*
+ * Filtered events are built in a per-cpu page first and only copied into
+ * the ring buffer once the filter has matched, so that an event that gets
+ * filtered out never reserves, commits and discards ring buffer space.
+ * trace_buffered_event_cnt keeps nested events (interrupts) off the page.
+ */
+DEFINE_PER_CPU(struct ring_buffer_event *, trace_buffered_event);
+DEFINE_PER_CPU(int, trace_buffered_event_cnt);
+static int trace_buffered_event_ref;
+
+#define TRACE_BUFFERED_EVENT_MAX \
+	(PAGE_SIZE - sizeof(struct ring_buffer_event) - sizeof(u32))
+
+/**
+ * trace_buffered_event_enable - build filtered events in per-cpu pages
+ *
+ * Called when an event gets a filter; the pages are allocated by the
+ * first user.  Must be called with event_mutex held.
+ */
+void trace_buffered_event_enable(void)
+{
+	struct page *page;
+	int cpu;
+
+	WARN_ON_ONCE(!mutex_is_locked(&event_mutex));
+
+	if (trace_buffered_event_ref++)
+		return;
+
+	for_each_tracing_cpu(cpu) {
+		page = alloc_pages_node(cpu_to_node(cpu),
+					GFP_KERNEL | __GFP_NORETRY, 0);
+		/* without a page this cpu just keeps using the ring buffer */
+		if (page)
+			per_cpu(trace_buffered_event, cpu) = page_address(page);
+	}
+}
+
+static void disable_trace_buffered_event(void *data)
+{
+	this_cpu_inc(trace_buffered_event_cnt);
+}
+
+static void enable_trace_buffered_event(void *data)
+{
+	this_cpu_dec(trace_buffered_event_cnt);
+}
+
+/**
+ * trace_buffered_event_disable - stop building filtered events in pages
+ *
+ * Called when an event loses its filter; the pages are freed once the
+ * last filter is gone.  Must be called with event_mutex held.
+ */
+void trace_buffered_event_disable(void)
+{
+	int cpu;
+
+	WARN_ON_ONCE(!mutex_is_locked(&event_mutex));
+
+	if (WARN_ON_ONCE(!trace_buffered_event_ref))
+		return;
+
+	if (--trace_buffered_event_ref)
+		return;
+
+	/* Mark the pages busy so that no new event starts using them */
+	on_each_cpu_mask(tracing_buffer_mask, disable_trace_buffered_event,
+			 NULL, true);
+
+	/* Writers run with preemption disabled, wait for them to finish */
+	synchronize_sched();
+
+	for_each_tracing_cpu(cpu) {
+		free_page((unsigned long)per_cpu(trace_buffered_event, cpu));
+		per_cpu(trace_buffered_event, cpu) = NULL;
+	}
+
+	/* The pages must be gone before the counters allow their use again */
+	smp_wmb();
+
+	on_each_cpu_mask(tracing_buffer_mask, enable_trace_buffered_event,
+			 NULL, true);
+}
+
 void
 __buffer_unlock_commit(struct ring_buffer *buffer, struct ring_buffer_event *event)
 {
 	__this_cpu_write(trace_cmdline_save, true);
-	ring_buffer_unlock_commit(buffer, event);
+
+	/* An event built in the per-cpu page is copied in only now */
+	if (this_cpu_read(trace_buffered_event) == event) {
+		ring_buffer_write(buffer, event->array[0], &event->array[1]);
+		this_cpu_dec(trace_buffered_event_cnt);
+	} else
+		ring_buffer_unlock_commit(buffer, event);
 }
 
 static inline void
@@ -1585,7 +1676,29 @@ trace_event_buffer_lock_reserve(struct ring_buffer **current_rb,
 			  int type, unsigned long len,
 			  unsigned long flags, int pc)
 {
+	struct ring_buffer_event *entry;
+
 	*current_rb = ftrace_file->tr->trace_buffer.buffer;
+
+	if ((ftrace_file->event_call->flags & TRACE_EVENT_FL_FILTERED) &&
+	    len <= TRACE_BUFFERED_EVENT_MAX &&
+	    (entry = this_cpu_read(trace_buffered_event))) {
+		if (this_cpu_inc_return(trace_buffered_event_cnt) == 1) {
+			struct trace_entry *ent;
+
+			/* length in array[0], like a large ring buffer event */
+			entry->type_len = 0;
+			entry->time_delta = 0;
+			entry->array[0] = len;
+
+			ent = ring_buffer_event_data(entry);
+			tracing_generic_entry_update(ent, flags, pc);
+			ent->type = type;
+			return entry;
+		}
+		this_cpu_dec(trace_buffered_event_cnt);
+	}
+
 	return trace_buffer_lock_reserve(*current_rb,
 					 type, len, flags, pc);
 }
@@ -1625,7 +1738,7 @@ EXPORT_SYMBOL_GPL(trace_buffer_unlock_commit_regs);
 void trace_current_buffer_discard_commit(struct ring_buffer *buffer,
 					 struct ring_buffer_event *event)
 {
-	ring_buffer_discard_commit(buffer, event);
+	__trace_event_discard_commit(buffer, event);
 }
 EXPORT_SYMBOL_GPL(trace_current_buffer_discard_commit);
 
@@ -5166,7 +5279,8 @@ static int tracing_buffers_release(struct inode *inode, struct file *file)
 	__trace_array_put(iter->tr);
 
 	if (info->spare)
-		ring_buffer_free_read_page(iter->trace_buffer->buffer, info->spare);
+		ring_buffer_free_read_page(iter->trace_buffer->buffer,
+					   iter->cpu_file, info->spare);
 	kfree(info);
 
 	mutex_unlock(&trace_types_lock);
@@ -5177,6 +5291,7 @@ static int tracing_buffers_release(struct inode *inode, struct file *file)
 struct buffer_ref {
 	struct ring_buffer	*buffer;
 	void			*page;
+	int			cpu;
 	int			ref;
 };
 
@@ -5188,7 +5303,12 @@ static void buffer_pipe_buf_release(struct pipe_inode_info *pipe,
 	if (--ref->ref)
 		return;
 
-	ring_buffer_free_read_page(ref->buffer, ref->page);
+	/*
+	 * The page may outlive the reader, and with an instance or the
+	 * snapshot also the ring buffer, so it cannot go back to the
+	 * buffer's page cache from here.
+	 */
+	free_page((unsigned long)ref->page);
 	kfree(ref);
 	buf->private = 0;
 }
@@ -5215,6 +5335,8 @@ static const struct pipe_buf_operations buffer_pipe_buf_ops = {
 /*
  * Callback from splice_to_pipe(), if we need to release some pages
  * at the end of the spd in case we error'ed out in filling the pipe.
+ * This still runs within tracing_buffers_splice_read(), so the buffer
+ * is alive and the page can be cached for the next read.
  */
 static void buffer_spd_release(struct splice_pipe_desc *spd, unsigned int i)
 {
@@ -5224,11 +5346,29 @@ static void buffer_spd_release(struct splice_pipe_desc *spd, unsigned int i)
 	if (--ref->ref)
 		return;
 
-	ring_buffer_free_read_page(ref->buffer, ref->page);
+	ring_buffer_free_read_page(ref->buffer, ref->cpu, ref->page);
 	kfree(ref);
 	spd->partial[i].private = 0;
 }
 
+/*
+ * The per-cpu ring buffers are protected by trace_access_lock() and
+ * kept alive by the trace_array reference taken at open, so readers of
+ * different cpus splice in parallel.  Only the snapshot buffer can be
+ * swapped or freed under a reader, which still needs trace_types_lock.
+ */
+static inline void splice_buffers_lock(struct trace_iterator *iter)
+{
+	if (iter->snapshot)
+		mutex_lock(&trace_types_lock);
+}
+
+static inline void splice_buffers_unlock(struct trace_iterator *iter)
+{
+	if (iter->snapshot)
+		mutex_unlock(&trace_types_lock);
+}
+
 static ssize_t
 tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 			    struct pipe_inode_info *pipe, size_t len,
@@ -5250,7 +5390,7 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 	int entries, size, i;
 	ssize_t ret;
 
-	mutex_lock(&trace_types_lock);
+	splice_buffers_lock(iter);
 
 #ifdef CONFIG_TRACER_MAX_TRACE
 	if (iter->snapshot && iter->tr->current_trace->use_max_tr) {
@@ -5291,16 +5431,18 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 
 		ref->ref = 1;
 		ref->buffer = iter->trace_buffer->buffer;
-		ref->page = ring_buffer_alloc_read_page(ref->buffer, iter->cpu_file);
+		ref->cpu = iter->cpu_file;
+		ref->page = ring_buffer_alloc_read_page(ref->buffer, ref->cpu);
 		if (!ref->page) {
 			kfree(ref);
 			break;
 		}
 
 		r = ring_buffer_read_page(ref->buffer, &ref->page,
-					  len, iter->cpu_file, 1);
+					  len, ref->cpu, 1);
 		if (r < 0) {
-			ring_buffer_free_read_page(ref->buffer, ref->page);
+			ring_buffer_free_read_page(ref->buffer, ref->cpu,
+						   ref->page);
 			kfree(ref);
 			break;
 		}
@@ -5334,9 +5476,9 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 			ret = -EAGAIN;
 			goto out;
 		}
-		mutex_unlock(&trace_types_lock);
+		splice_buffers_unlock(iter);
 		ret = iter->trace->wait_pipe(iter);
-		mutex_lock(&trace_types_lock);
+		splice_buffers_lock(iter);
 		if (ret)
 			goto out;
 		if (signal_pending(current)) {
@@ -5349,7 +5491,7 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 	ret = splice_to_pipe(pipe, &spd);
 	splice_shrink_spd(&spd);
 out:
-	mutex_unlock(&trace_types_lock);
+	splice_buffers_unlock(iter);
 
 	return ret;
 }
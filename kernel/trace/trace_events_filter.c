@@ -760,9 +760,22 @@ static void __free_preds(struct event_filter *filter)
 	filter->n_preds = 0;
 }
 
+/* caller must hold event_mutex */
+static void filter_enable(struct ftrace_event_call *call)
+{
+	if (!(call->flags & TRACE_EVENT_FL_FILTERED)) {
+		call->flags |= TRACE_EVENT_FL_FILTERED;
+		trace_buffered_event_enable();
+	}
+}
+
+/* caller must hold event_mutex */
 static void filter_disable(struct ftrace_event_call *call)
 {
-	call->flags &= ~TRACE_EVENT_FL_FILTERED;
+	if (call->flags & TRACE_EVENT_FL_FILTERED) {
+		call->flags &= ~TRACE_EVENT_FL_FILTERED;
+		trace_buffered_event_disable();
+	}
 }
 
 static void __free_filter(struct event_filter *filter)
@@ -783,6 +796,7 @@ static void __free_filter(struct event_filter *filter)
  */
 void destroy_preds(struct ftrace_event_call *call)
 {
+	filter_disable(call);
 	__free_filter(call->filter);
 	call->filter = NULL;
 }
@@ -1687,7 +1701,7 @@ static int replace_system_preds(struct event_subsystem *system,
 			parse_error(ps, FILT_ERR_BAD_SUBSYS_FILTER, 0);
 			append_filter_err(ps, filter);
 		} else
-			call->flags |= TRACE_EVENT_FL_FILTERED;
+			filter_enable(call);
 		/*
 		 * Regardless of if this returned an error, we still
 		 * replace the filter for the call.
@@ -1876,7 +1890,7 @@ int apply_event_filter(struct ftrace_event_call *call, char *filter_string)
 		struct event_filter *tmp = call->filter;
 
 		if (!err)
-			call->flags |= TRACE_EVENT_FL_FILTERED;
+			filter_enable(call);
 		else
 			filter_disable(call);
 
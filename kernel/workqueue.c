@@ -47,6 +47,8 @@
 #include <linux/nodemask.h>
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_internal.h"
 
@@ -139,6 +141,25 @@ enum {
 
 /* struct worker is defined in workqueue_internal.h */
 
+#ifdef CONFIG_WQ_STATS
+/*
+ * log2 histograms of times in ns.  Bucket 0 counts times below 1024ns,
+ * bucket n > 0 times of 2^(n+9) to 2^(n+10)-1 ns, and the last bucket
+ * everything longer.
+ */
+#define WQ_STAT_BUCKETS		24
+
+struct wq_stats {
+	u64			executed;	/* work items executed */
+	u64			cpu_time;	/* their cpu time, ns */
+	u64			stalled;	/* queued with concurrency used up */
+	u64			throttled;	/* delayed by max_active */
+	u64			mayday;		/* rescuer requests */
+	unsigned int		latency[WQ_STAT_BUCKETS]; /* queue to start */
+	unsigned int		exec[WQ_STAT_BUCKETS];	/* start to end */
+};
+#endif
+
 struct worker_pool {
 	spinlock_t		lock;		/* the pool lock */
 	int			cpu;		/* I: the associated cpu */
@@ -169,6 +190,10 @@ struct worker_pool {
 	struct hlist_node	hash_node;	/* PL: unbound_pool_hash node */
 	int			refcnt;		/* PL: refcnt for unbound pools */
 
+#ifdef CONFIG_WQ_STATS
+	unsigned long		cm_wakeups;	/* X: wakeups for blocked workers */
+#endif
+
 	/*
 	 * The current concurrency level.  As it's likely to be accessed
 	 * from other CPUs during try_to_wake_up(), put it in a separate
@@ -202,6 +227,9 @@ struct pool_workqueue {
 	struct list_head	delayed_works;	/* L: delayed works */
 	struct list_head	pwqs_node;	/* WR: node on wq->pwqs */
 	struct list_head	mayday_node;	/* MD: node on wq->maydays */
+#ifdef CONFIG_WQ_STATS
+	struct wq_stats		stats;		/* L: */
+#endif
 
 	/*
 	 * Release of unbound pwq is punted to system_wq.  See put_pwq()
@@ -252,6 +280,9 @@ struct workqueue_struct {
 #ifdef CONFIG_SYSFS
 	struct wq_device	*wq_dev;	/* I: for sysfs interface */
 #endif
+#ifdef CONFIG_WQ_STATS
+	struct wq_stats		stats;		/* WQ: of released unbound pwqs */
+#endif
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map	lockdep_map;
 #endif
@@ -898,6 +929,10 @@ struct task_struct *wq_worker_sleeping(struct task_struct *task, int cpu)
 	if (atomic_dec_and_test(&pool->nr_running) &&
 	    !list_empty(&pool->worklist))
 		to_wakeup = first_worker(pool);
+#ifdef CONFIG_WQ_STATS
+	if (to_wakeup)
+		pool->cm_wakeups++;
+#endif
 	return to_wakeup ? to_wakeup->task : NULL;
 }
 
@@ -1278,6 +1313,59 @@ fail:
 	return -EAGAIN;
 }
 
+#ifdef CONFIG_WQ_STATS
+static inline int wq_stat_bucket(u64 ns)
+{
+	int bucket = ns < 1024 ? 0 : fls64(ns) - 10;
+
+	return min(bucket, WQ_STAT_BUCKETS - 1);
+}
+
+static inline void wq_stats_queued(struct work_struct *work)
+{
+	work->queued_at = local_clock();
+}
+
+/* @work is about to be executed by @worker, pool->lock held */
+static void wq_stats_start(struct worker *worker, struct work_struct *work)
+{
+	struct wq_stats *stats = &worker->current_pwq->stats;
+	u64 now = local_clock();
+
+	/* unbound work may start on another cpu than it was queued on */
+	stats->latency[wq_stat_bucket(now > work->queued_at ?
+				      now - work->queued_at : 0)]++;
+	worker->exec_time = now;
+	worker->exec_cpu = task_sched_runtime(current);
+}
+
+/* current_work returned, must be called before pool->lock is retaken */
+static void wq_stats_end(struct worker *worker)
+{
+	worker->exec_time = local_clock() - worker->exec_time;
+	worker->exec_cpu = task_sched_runtime(current) - worker->exec_cpu;
+}
+
+/* pool->lock held again, current_pwq still set */
+static void wq_stats_account(struct worker *worker)
+{
+	struct wq_stats *stats = &worker->current_pwq->stats;
+
+	stats->executed++;
+	stats->cpu_time += worker->exec_cpu;
+	stats->exec[wq_stat_bucket(worker->exec_time)]++;
+}
+
+#define wq_stats_inc(pwq, field)	((pwq)->stats.field++)
+#else
+static inline void wq_stats_queued(struct work_struct *work) { }
+static inline void wq_stats_start(struct worker *worker,
+				  struct work_struct *work) { }
+static inline void wq_stats_end(struct worker *worker) { }
+static inline void wq_stats_account(struct worker *worker) { }
+#define wq_stats_inc(pwq, field)	do { } while (0)
+#endif /* CONFIG_WQ_STATS */
+
 /**
  * insert_work - insert a work into a pool
  * @pwq: pwq @work belongs to
@@ -1300,6 +1388,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
+	wq_stats_queued(work);
 
 	/*
 	 * Ensure either wq_worker_sleeping() sees the above
@@ -1310,6 +1399,8 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 
 	if (__need_more_worker(pool))
 		wake_up_worker(pool);
+	else if (head == &pool->worklist)
+		wq_stats_inc(pwq, stalled);
 }
 
 /*
@@ -1422,6 +1513,7 @@ retry:
 	} else {
 		work_flags |= WORK_STRUCT_DELAYED;
 		worklist = &pwq->delayed_works;
+		wq_stats_inc(pwq, throttled);
 	}
 
 	insert_work(pwq, work, worklist, work_flags);
@@ -1930,6 +2022,7 @@ static void send_mayday(struct work_struct *work)
 		 */
 		get_pwq(pwq);
 		list_add_tail(&pwq->mayday_node, &wq->maydays);
+		wq_stats_inc(pwq, mayday);
 		wake_up_process(wq->rescuer->task);
 	}
 }
@@ -2210,6 +2303,8 @@ __acquires(&pool->lock)
 	 */
 	set_work_pool_and_clear_pending(work, pool->id);
 
+	wq_stats_start(worker, work);
+
 	spin_unlock_irq(&pool->lock);
 
 	lock_map_acquire_read(&pwq->wq->lockdep_map);
@@ -2221,6 +2316,7 @@ __acquires(&pool->lock)
 	 * point will only record its address.
 	 */
 	trace_workqueue_execute_end(work);
+	wq_stats_end(worker);
 	lock_map_release(&lockdep_map);
 	lock_map_release(&pwq->wq->lockdep_map);
 
@@ -2248,6 +2344,8 @@ __acquires(&pool->lock)
 	if (unlikely(cpu_intensive))
 		worker_clr_flags(worker, WORKER_CPU_INTENSIVE);
 
+	wq_stats_account(worker);
+
 	/* we're done with it, release */
 	hash_del(&worker->hentry);
 	worker->current_work = NULL;
@@ -3160,6 +3258,151 @@ int execute_in_process_context(work_func_t fn, struct execute_work *ew)
 }
 EXPORT_SYMBOL_GPL(execute_in_process_context);
 
+#ifdef CONFIG_WQ_STATS
+static void wq_stats_add(struct wq_stats *sum, const struct wq_stats *stats)
+{
+	int i;
+
+	sum->executed += stats->executed;
+	sum->cpu_time += stats->cpu_time;
+	sum->stalled += stats->stalled;
+	sum->throttled += stats->throttled;
+	sum->mayday += stats->mayday;
+	for (i = 0; i < WQ_STAT_BUCKETS; i++) {
+		sum->latency[i] += stats->latency[i];
+		sum->exec[i] += stats->exec[i];
+	}
+}
+
+/*
+ * Add up the stats of @wq, or only of its pwq on @pool if @pool is not
+ * NULL, into @sum.
+ */
+static void wq_stats_sum(struct workqueue_struct *wq, struct worker_pool *pool,
+			 struct wq_stats *sum)
+{
+	struct pool_workqueue *pwq;
+
+	mutex_lock(&wq->mutex);
+	if (!pool)
+		wq_stats_add(sum, &wq->stats);
+	for_each_pwq(pwq, wq) {
+		if (pool && pwq->pool != pool)
+			continue;
+		spin_lock_irq(&pwq->pool->lock);
+		wq_stats_add(sum, &pwq->stats);
+		spin_unlock_irq(&pwq->pool->lock);
+	}
+	mutex_unlock(&wq->mutex);
+}
+
+static void wq_stats_seq_show(struct seq_file *m, const struct wq_stats *stats)
+{
+	int i;
+
+	seq_printf(m, "  executed %llu cpu_time_ns %llu stalled %llu "
+		   "throttled %llu mayday %llu\n",
+		   stats->executed, stats->cpu_time, stats->stalled,
+		   stats->throttled, stats->mayday);
+	if (!stats->executed)
+		return;
+
+	seq_printf(m, "  %-12s %12s %12s\n", "nsecs", "latency", "exec");
+	for (i = 0; i < WQ_STAT_BUCKETS; i++)
+		seq_printf(m, "  %-12llu %12u %12u\n",
+			   i ? 1ULL << (i + 9) : 0ULL,
+			   stats->latency[i], stats->exec[i]);
+}
+
+static int wq_stats_workqueues_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	struct wq_stats *sum;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	mutex_lock(&wq_pool_mutex);
+	list_for_each_entry(wq, &workqueues, list) {
+		memset(sum, 0, sizeof(*sum));
+		wq_stats_sum(wq, NULL, sum);
+		seq_printf(m, "%s\n", wq->name);
+		wq_stats_seq_show(m, sum);
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	kfree(sum);
+	return 0;
+}
+
+static int wq_stats_pools_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	struct worker_pool *pool;
+	struct wq_stats *sum;
+	int pi;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	mutex_lock(&wq_pool_mutex);
+	for_each_pool(pool, pi) {
+		memset(sum, 0, sizeof(*sum));
+		list_for_each_entry(wq, &workqueues, list)
+			wq_stats_sum(wq, pool, sum);
+		seq_printf(m, "pool %d cpu %d nice %d cm_wakeups %lu\n",
+			   pool->id, pool->cpu, pool->attrs->nice,
+			   ACCESS_ONCE(pool->cm_wakeups));
+		wq_stats_seq_show(m, sum);
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	kfree(sum);
+	return 0;
+}
+
+static int wq_stats_workqueues_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_workqueues_show, NULL);
+}
+
+static int wq_stats_pools_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_pools_show, NULL);
+}
+
+static const struct file_operations wq_stats_workqueues_fops = {
+	.open		= wq_stats_workqueues_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations wq_stats_pools_fops = {
+	.open		= wq_stats_pools_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_stats_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("workqueues", 0444, dir, NULL,
+			    &wq_stats_workqueues_fops);
+	debugfs_create_file("pools", 0444, dir, NULL, &wq_stats_pools_fops);
+	return 0;
+}
+late_initcall(wq_stats_debugfs_init);
+#endif /* CONFIG_WQ_STATS */
+
 #ifdef CONFIG_SYSFS
 /*
  * Workqueues with WQ_SYSFS flag set is visible to userland via
@@ -3168,6 +3411,7 @@ EXPORT_SYMBOL_GPL(execute_in_process_context);
  *
  *  per_cpu	RO bool	: whether the workqueue is per-cpu or unbound
  *  max_active	RW int	: maximum number of in-flight work items
+ *  stats	RO	: execution statistics, with CONFIG_WQ_STATS
  *
  * Unbound workqueues have the following extra attributes.
  *
@@ -3217,9 +3461,36 @@ static ssize_t wq_max_active_store(struct device *dev,
 	return count;
 }
 
+#ifdef CONFIG_WQ_STATS
+static ssize_t wq_stats_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct wq_stats *sum;
+	ssize_t written;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	wq_stats_sum(wq, NULL, sum);
+	written = scnprintf(buf, PAGE_SIZE,
+			    "executed %llu\ncpu_time_ns %llu\nstalled %llu\n"
+			    "throttled %llu\nmayday %llu\n",
+			    sum->executed, sum->cpu_time, sum->stalled,
+			    sum->throttled, sum->mayday);
+	kfree(sum);
+
+	return written;
+}
+#endif
+
 static struct device_attribute wq_sysfs_attrs[] = {
 	__ATTR(per_cpu, 0444, wq_per_cpu_show, NULL),
 	__ATTR(max_active, 0644, wq_max_active_show, wq_max_active_store),
+#ifdef CONFIG_WQ_STATS
+	__ATTR(stats, 0444, wq_stats_show, NULL),
+#endif
 	__ATTR_NULL,
 };
 
@@ -3754,6 +4025,10 @@ static void pwq_unbound_release_workfn(struct work_struct *work)
 	mutex_lock(&wq->mutex);
 	list_del_rcu(&pwq->pwqs_node);
 	is_last = list_empty(&wq->pwqs);
+#ifdef CONFIG_WQ_STATS
+	/* keep the history of @wq across attribute and cpu hotplug changes */
+	wq_stats_add(&wq->stats, &pwq->stats);
+#endif
 	mutex_unlock(&wq->mutex);
 
 	mutex_lock(&wq_pool_mutex);
@@ -50,6 +50,12 @@ struct worker {
 
 	/* used only by rescuers to point to the target workqueue */
 	struct workqueue_struct	*rescue_wq;	/* I: the workqueue to rescue */
+
+#ifdef CONFIG_WQ_STATS
+	/* start of current_work, then its duration once it returned */
+	u64			exec_time;	/* L: wall clock, ns */
+	u64			exec_cpu;	/* L: cpu time, ns */
+#endif
 };
 
 /**
@@ -1108,6 +1108,97 @@ static inline void print_testname(const char *testname)
 	DO_TESTCASE_6IRW(desc, name, 312);			\
 	DO_TESTCASE_6IRW(desc, name, 321);
 
+#ifdef CONFIG_QUEUED_SPINLOCKS
+/*
+ * Sanity checks of the queued spinlock word.  These work on raw
+ * arch_spinlock_t's, below lockdep, and check what the lock itself
+ * promises: a held lock is seen as locked and cannot be trylocked, and
+ * unlock leaves a clean word behind, also with several locks held.
+ *
+ * The selftests run on the boot cpu alone, where nobody could ever hand
+ * a contended lock over, so the slowpath itself is left to locktorture
+ * (torture_type=spin_lock).  What can be checked here is that the owner
+ * sees and leaves alone the waiters encoded in the word.
+ */
+static int queued_spinlock_nested(void)
+{
+	arch_spinlock_t locks[4] = { [0 ... 3] = __ARCH_SPIN_LOCK_UNLOCKED };
+	int i, failed = 0;
+
+	for (i = 0; i < ARRAY_SIZE(locks); i++) {
+		arch_spin_lock(&locks[i]);
+		if (!arch_spin_is_locked(&locks[i]) ||
+		    arch_spin_is_contended(&locks[i]) ||
+		    arch_spin_trylock(&locks[i]))
+			failed++;
+	}
+	for (i = ARRAY_SIZE(locks) - 1; i >= 0; i--) {
+		arch_spin_unlock(&locks[i]);
+		if (atomic_read(&locks[i].val))
+			failed++;
+	}
+	if (!arch_spin_trylock(&locks[0]))
+		failed++;
+	arch_spin_unlock(&locks[0]);
+	if (arch_spin_is_locked(&locks[0]))
+		failed++;
+
+	return failed;
+}
+
+/*
+ * Hold the lock while a pending waiter and a queued waiter (cpu 0,
+ * node 0) stand in the word, as they would for another cpu.
+ */
+static int queued_spinlock_contended(void)
+{
+	arch_spinlock_t lock = __ARCH_SPIN_LOCK_UNLOCKED;
+	u32 waiters = _Q_PENDING_VAL | (1U << _Q_TAIL_CPU_OFFSET);
+	int failed = 0;
+
+	arch_spin_lock(&lock);
+	atomic_add(waiters, &lock.val);
+	if (!arch_spin_is_locked(&lock) || !arch_spin_is_contended(&lock) ||
+	    arch_spin_trylock(&lock))
+		failed++;
+	arch_spin_unlock(&lock);
+	if (arch_spin_is_locked(&lock) ||
+	    atomic_read(&lock.val) != waiters)
+		failed++;
+	/* A new locker must not slip past the queue */
+	if (arch_spin_trylock(&lock))
+		failed++;
+
+	return failed;
+}
+
+static void queued_spinlock_selftest(void)
+{
+	unsigned long flags;
+	int failed;
+
+	print_testname("queued spinlock");
+
+	local_irq_save(flags);
+	failed = queued_spinlock_nested();
+	failed += queued_spinlock_contended();
+	local_irq_restore(flags);
+
+	if (failed) {
+		unexpected_testcase_failures++;
+		printk("FAILED|");
+		dump_stack();
+	} else {
+		testcase_successes++;
+		printk("  ok  |");
+	}
+	testcase_total++;
+	printk("\n");
+}
+#else
+static inline void queued_spinlock_selftest(void) { }
+#endif
+
 
 void locking_selftest(void)
 {
@@ -1188,6 +1279,8 @@ void locking_selftest(void)
 	DO_TESTCASE_6x2("irq read-recursion", irq_read_recursion);
 //	DO_TESTCASE_6x2B("irq read-recursion #2", irq_read_recursion2);
 
+	queued_spinlock_selftest();
+
 	if (unexpected_testcase_failures) {
 		printk("-----------------------------------------------------------------\n");
 		debug_locks = 0;
@@ -1468,6 +1468,7 @@ struct sock *sk_clone_lock(const struct sock *sk, const gfp_t priority)
 		/* SANITY */
 		get_net(sock_net(newsk));
 		sk_node_init(&newsk->sk_node);
+		RCU_INIT_POINTER(newsk->sk_reuseport_cb, NULL);
 		sock_lock_init(newsk);
 		bh_lock_sock(newsk);
 		newsk->sk_backlog.head	= newsk->sk_backlog.tail = NULL;
@@ -529,7 +529,7 @@ static int esp_init_aead(struct xfrm_state *x)
 	struct crypto_aead *aead;
 	int err;
 
-	aead = crypto_alloc_aead(x->aead->alg_name, 0, 0);
+	aead = xfrm_aead_alloc(x, x->aead->alg_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -581,7 +581,7 @@ static int esp_init_authenc(struct xfrm_state *x)
 			goto error;
 	}
 
-	aead = crypto_alloc_aead(authenc_name, 0, 0);
+	aead = xfrm_aead_alloc(x, authenc_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -103,6 +103,7 @@ struct rt_trie_node {
 struct leaf {
 	unsigned long parent;
 	t_key key;
+	u64 plen_map;		/* bit n set: a prefix of length n is on list */
 	struct hlist_head list;
 	struct rcu_head rcu;
 };
@@ -110,7 +111,6 @@ struct leaf {
 struct leaf_info {
 	struct hlist_node hlist;
 	int plen;
-	u32 mask_plen; /* ntohl(inet_make_mask(plen)) */
 	struct list_head falh;
 	struct rcu_head rcu;
 };
@@ -137,6 +137,8 @@ struct trie_use_stats {
 	unsigned int semantic_match_miss;
 	unsigned int null_node_hit;
 	unsigned int resize_node_skipped;
+	unsigned int leaf_skipped;
+	unsigned int depth[MAX_STAT_DEPTH];	/* lookups by tnodes descended */
 };
 #endif
 
@@ -153,7 +155,7 @@ struct trie_stat {
 struct trie {
 	struct rt_trie_node __rcu *trie;
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-	struct trie_use_stats stats;
+	struct trie_use_stats __percpu *stats;
 #endif
 };
 
@@ -431,6 +433,7 @@ static struct leaf *leaf_new(void)
 	struct leaf *l = kmem_cache_alloc(trie_leaf_kmem, GFP_KERNEL);
 	if (l) {
 		l->parent = T_LEAF;
+		l->plen_map = 0;
 		INIT_HLIST_HEAD(&l->list);
 	}
 	return l;
@@ -441,7 +444,6 @@ static struct leaf_info *leaf_info_new(int plen)
 	struct leaf_info *li = kmalloc(sizeof(struct leaf_info),  GFP_KERNEL);
 	if (li) {
 		li->plen = plen;
-		li->mask_plen = ntohl(inet_make_mask(plen));
 		INIT_LIST_HEAD(&li->falh);
 	}
 	return li;
@@ -631,7 +633,7 @@ static struct rt_trie_node *resize(struct trie *t, struct tnode *tn)
 		if (IS_ERR(tn)) {
 			tn = old_tn;
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-			t->stats.resize_node_skipped++;
+			this_cpu_inc(t->stats->resize_node_skipped);
 #endif
 			break;
 		}
@@ -658,7 +660,7 @@ static struct rt_trie_node *resize(struct trie *t, struct tnode *tn)
 		if (IS_ERR(tn)) {
 			tn = old_tn;
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-			t->stats.resize_node_skipped++;
+			this_cpu_inc(t->stats->resize_node_skipped);
 #endif
 			break;
 		}
@@ -929,8 +931,9 @@ static inline struct list_head *get_fa_head(struct leaf *l, int plen)
 	return &li->falh;
 }
 
-static void insert_leaf_info(struct hlist_head *head, struct leaf_info *new)
+static void insert_leaf_info(struct leaf *l, struct leaf_info *new)
 {
+	struct hlist_head *head = &l->list;
 	struct leaf_info *li = NULL, *last = NULL;
 
 	if (hlist_empty(head)) {
@@ -947,6 +950,30 @@ static void insert_leaf_info(struct hlist_head *head, struct leaf_info *new)
 		else
 			hlist_add_before_rcu(&new->hlist, &li->hlist);
 	}
+	/* Publish the prefix length only once it can be found on the list */
+	smp_wmb();
+	l->plen_map |= 1ULL << new->plen;
+}
+
+static void remove_leaf_info(struct leaf *l, struct leaf_info *old)
+{
+	l->plen_map &= ~(1ULL << old->plen);
+	hlist_del_rcu(&old->hlist);
+	free_leaf_info(old);
+}
+
+/*
+ * Mask of the prefix lengths in plen_map that can match key, i.e. those
+ * no longer than the number of leading bits key has in common with l->key.
+ */
+static inline u64 leaf_plen_candidates(const struct leaf *l, t_key key)
+{
+	t_key diff = key ^ l->key;
+
+	if (!diff)
+		return ~0ULL;
+	/* fls(x) = __fls(x) + 1 */
+	return (1ULL << (KEYLENGTH - __fls(diff))) - 1;
 }
 
 /* rcu_read_lock needs to be hold by caller from readside */
@@ -1087,7 +1114,7 @@ static struct list_head *fib_insert_node(struct trie *t, u32 key, int plen)
 			return NULL;
 
 		fa_head = &li->falh;
-		insert_leaf_info(&l->list, li);
+		insert_leaf_info(l, li);
 		goto done;
 	}
 	l = leaf_new();
@@ -1104,7 +1131,7 @@ static struct list_head *fib_insert_node(struct trie *t, u32 key, int plen)
 	}
 
 	fa_head = &li->falh;
-	insert_leaf_info(&l->list, li);
+	insert_leaf_info(l, li);
 
 	if (t->trie && n == NULL) {
 		/* Case 2: n is NULL, and will just insert a new leaf */
@@ -1334,6 +1361,7 @@ out:
 err:
 	return err;
 }
+EXPORT_SYMBOL_GPL(fib_table_insert);
 
 /* should be called with rcu_read_lock */
 static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
@@ -1342,11 +1370,23 @@ static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
 {
 	struct leaf_info *li;
 	struct hlist_head *hhead = &l->list;
+	u64 candidates = ACCESS_ONCE(l->plen_map) & leaf_plen_candidates(l, key);
+
+	/*
+	 * Most leaves reached while backtracking hold no prefix that covers
+	 * the key; reject them without touching any leaf_info.
+	 */
+	if (!candidates) {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+		this_cpu_inc(t->stats->leaf_skipped);
+#endif
+		return 1;
+	}
 
 	hlist_for_each_entry_rcu(li, hhead, hlist) {
 		struct fib_alias *fa;
 
-		if (l->key != (key & li->mask_plen))
+		if (!(candidates & (1ULL << li->plen)))
 			continue;
 
 		list_for_each_entry_rcu(fa, &li->falh, fa_list) {
@@ -1363,7 +1403,7 @@ static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
 			err = fib_props[fa->fa_type].error;
 			if (err) {
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-				t->stats.semantic_match_passed++;
+				this_cpu_inc(t->stats->semantic_match_passed);
 #endif
 				return err;
 			}
@@ -1378,7 +1418,7 @@ static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
 					continue;
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-				t->stats.semantic_match_passed++;
+				this_cpu_inc(t->stats->semantic_match_passed);
 #endif
 				res->prefixlen = li->plen;
 				res->nh_sel = nhsel;
@@ -1394,7 +1434,7 @@ static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
 		}
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-		t->stats.semantic_match_miss++;
+		this_cpu_inc(t->stats->semantic_match_miss);
 #endif
 	}
 
@@ -1415,6 +1455,9 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 	unsigned int current_prefix_length = KEYLENGTH;
 	struct tnode *cn;
 	t_key pref_mismatch;
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+	unsigned int depth = 0;
+#endif
 
 	rcu_read_lock();
 
@@ -1423,7 +1466,7 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 		goto failed;
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-	t->stats.gets++;
+	this_cpu_inc(t->stats->gets);
 #endif
 
 	/* Just a leaf? */
@@ -1447,7 +1490,7 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 
 		if (n == NULL) {
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-			t->stats.null_node_hit++;
+			this_cpu_inc(t->stats->null_node_hit);
 #endif
 			goto backtrace;
 		}
@@ -1549,6 +1592,9 @@ int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
 
 		pn = (struct tnode *)n; /* Descend */
 		chopped_off = 0;
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+		depth++;
+#endif
 		continue;
 
 backtrace:
@@ -1582,7 +1628,7 @@ backtrace:
 			chopped_off = 0;
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-			t->stats.backtrack++;
+			this_cpu_inc(t->stats->backtrack);
 #endif
 			goto backtrace;
 		}
@@ -1590,6 +1636,9 @@ backtrace:
 failed:
 	ret = 1;
 found:
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+	this_cpu_inc(t->stats->depth[min(depth, MAX_STAT_DEPTH - 1U)]);
+#endif
 	rcu_read_unlock();
 	return ret;
 }
@@ -1689,10 +1738,8 @@ int fib_table_delete(struct fib_table *tb, struct fib_config *cfg)
 	if (!plen)
 		tb->tb_num_default--;
 
-	if (list_empty(fa_head)) {
-		hlist_del_rcu(&li->hlist);
-		free_leaf_info(li);
-	}
+	if (list_empty(fa_head))
+		remove_leaf_info(l, li);
 
 	if (hlist_empty(&l->list))
 		trie_leaf_remove(t, l);
@@ -1704,6 +1751,7 @@ int fib_table_delete(struct fib_table *tb, struct fib_config *cfg)
 	alias_free_mem_rcu(fa);
 	return 0;
 }
+EXPORT_SYMBOL_GPL(fib_table_delete);
 
 static int trie_flush_list(struct list_head *head)
 {
@@ -1733,10 +1781,8 @@ static int trie_flush_leaf(struct leaf *l)
 	hlist_for_each_entry_safe(li, tmp, lih, hlist) {
 		found += trie_flush_list(&li->falh);
 
-		if (list_empty(&li->falh)) {
-			hlist_del_rcu(&li->hlist);
-			free_leaf_info(li);
-		}
+		if (list_empty(&li->falh))
+			remove_leaf_info(l, li);
 	}
 	return found;
 }
@@ -1836,8 +1882,14 @@ int fib_table_flush(struct fib_table *tb)
 
 void fib_free_table(struct fib_table *tb)
 {
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+	struct trie *t = (struct trie *)tb->tb_data;
+
+	free_percpu(t->stats);
+#endif
 	kfree(tb);
 }
+EXPORT_SYMBOL_GPL(fib_free_table);
 
 static int fn_trie_dump_fa(t_key key, int plen, struct list_head *fah,
 			   struct fib_table *tb,
@@ -1981,8 +2033,17 @@ struct fib_table *fib_trie_table(u32 id)
 	t = (struct trie *) tb->tb_data;
 	memset(t, 0, sizeof(*t));
 
+#ifdef CONFIG_IP_FIB_TRIE_STATS
+	t->stats = alloc_percpu(struct trie_use_stats);
+	if (!t->stats) {
+		kfree(tb);
+		tb = NULL;
+	}
+#endif
+
 	return tb;
 }
+EXPORT_SYMBOL_GPL(fib_trie_table);
 
 #ifdef CONFIG_PROC_FS
 /* Depth first Trie walk iterator */
@@ -2145,18 +2206,53 @@ static void trie_show_stats(struct seq_file *seq, struct trie_stat *stat)
 
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 static void trie_show_usage(struct seq_file *seq,
-			    const struct trie_use_stats *stats)
-{
+			    const struct trie_use_stats __percpu *stats)
+{
+	struct trie_use_stats s = { 0 };
+	unsigned int i, max, avdepth;
+	unsigned long long totdepth = 0;
+	int cpu;
+
+	/* loop through all of the CPUs and gather up the stats */
+	for_each_possible_cpu(cpu) {
+		const struct trie_use_stats *pcpu = per_cpu_ptr(stats, cpu);
+
+		s.gets += pcpu->gets;
+		s.backtrack += pcpu->backtrack;
+		s.semantic_match_passed += pcpu->semantic_match_passed;
+		s.semantic_match_miss += pcpu->semantic_match_miss;
+		s.null_node_hit += pcpu->null_node_hit;
+		s.resize_node_skipped += pcpu->resize_node_skipped;
+		s.leaf_skipped += pcpu->leaf_skipped;
+		for (i = 0; i < MAX_STAT_DEPTH; i++)
+			s.depth[i] += pcpu->depth[i];
+	}
+
 	seq_printf(seq, "\nCounters:\n---------\n");
-	seq_printf(seq, "gets = %u\n", stats->gets);
-	seq_printf(seq, "backtracks = %u\n", stats->backtrack);
+	seq_printf(seq, "gets = %u\n", s.gets);
+	seq_printf(seq, "backtracks = %u\n", s.backtrack);
 	seq_printf(seq, "semantic match passed = %u\n",
-		   stats->semantic_match_passed);
-	seq_printf(seq, "semantic match miss = %u\n",
-		   stats->semantic_match_miss);
-	seq_printf(seq, "null node hit= %u\n", stats->null_node_hit);
-	seq_printf(seq, "skipped node resize = %u\n\n",
-		   stats->resize_node_skipped);
+		   s.semantic_match_passed);
+	seq_printf(seq, "semantic match miss = %u\n", s.semantic_match_miss);
+	seq_printf(seq, "null node hit= %u\n", s.null_node_hit);
+	seq_printf(seq, "leaf skipped = %u\n", s.leaf_skipped);
+	seq_printf(seq, "skipped node resize = %u\n", s.resize_node_skipped);
+
+	max = MAX_STAT_DEPTH;
+	while (max > 0 && s.depth[max-1] == 0)
+		max--;
+
+	seq_puts(seq, "lookup depth:");
+	for (i = 0; i < max; i++) {
+		totdepth += (unsigned long long)i * s.depth[i];
+		if (s.depth[i] != 0)
+			seq_printf(seq, "  %u: %u", i, s.depth[i]);
+	}
+	seq_putc(seq, '\n');
+
+	avdepth = s.gets ? div_u64(totdepth * 100, s.gets) : 0;
+	seq_printf(seq, "aver lookup depth = %u.%02u\n\n",
+		   avdepth / 100, avdepth % 100);
 }
 #endif /*  CONFIG_IP_FIB_TRIE_STATS */
 
@@ -2197,7 +2293,7 @@ static int fib_triestat_seq_show(struct seq_file *seq, void *v)
 			trie_collect_stats(t, &stat);
 			trie_show_stats(seq, &stat);
 #ifdef CONFIG_IP_FIB_TRIE_STATS
-			trie_show_usage(seq, &t->stats);
+			trie_show_usage(seq, t->stats);
 #endif
 		}
 	}
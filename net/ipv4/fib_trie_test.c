@@ -0,0 +1,156 @@
+/*
+ * FIB trie lookup benchmark
+ *
+ * Loads a private table with a synthetic Internet-sized set of prefixes
+ * and measures insert, lookup and delete rates.  The table is never
+ * linked into a namespace, so it does not affect forwarding, but route
+ * notifications for it are sent like for any other table.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version
+ *	2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/inetdevice.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/rtnetlink.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <net/ip_fib.h>
+
+#define FIB_TEST_TABLE	0xfffffffeU
+
+static unsigned int routes = 500000;
+module_param(routes, uint, 0444);
+MODULE_PARM_DESC(routes, "Number of prefixes to load (default 500000)");
+
+static unsigned int lookups = 10000000;
+module_param(lookups, uint, 0444);
+MODULE_PARM_DESC(lookups, "Number of lookups to time (default 10000000)");
+
+/*
+ * Rough prefix length distribution of a full BGP table, in parts per
+ * thousand: a little over half are /24s, most of the rest /16 to /23.
+ */
+static const struct {
+	u8 plen;
+	u16 weight;
+} plen_dist[] = {
+	{ 8, 1 }, { 12, 2 }, { 13, 3 }, { 14, 5 }, { 15, 8 }, { 16, 24 },
+	{ 17, 14 }, { 18, 24 }, { 19, 42 }, { 20, 64 }, { 21, 70 },
+	{ 22, 110 }, { 23, 90 }, { 24, 543 },
+};
+
+static int random_plen(struct rnd_state *rnd)
+{
+	unsigned int w = prandom_u32_state(rnd) % 1000;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(plen_dist) - 1; i++) {
+		if (w < plen_dist[i].weight)
+			break;
+		w -= plen_dist[i].weight;
+	}
+	return plen_dist[i].plen;
+}
+
+static void route_config(struct fib_config *cfg, struct rnd_state *rnd)
+{
+	int plen = random_plen(rnd);
+	u32 key = prandom_u32_state(rnd);
+
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->fc_dst_len = plen;
+	cfg->fc_dst = inet_make_mask(plen) & htonl(key);
+	cfg->fc_type = RTN_UNREACHABLE;
+	cfg->fc_scope = RT_SCOPE_UNIVERSE;
+	cfg->fc_protocol = RTPROT_STATIC;
+	cfg->fc_table = FIB_TEST_TABLE;
+	cfg->fc_nlflags = NLM_F_CREATE | NLM_F_EXCL;
+	cfg->fc_nlinfo.nl_net = &init_net;
+}
+
+static u64 rate(u64 count, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return div64_u64(count * NSEC_PER_SEC, ns ? ns : 1);
+}
+
+static int __init fib_trie_test_init(void)
+{
+	struct fib_table *tb;
+	struct fib_config cfg;
+	struct fib_result res;
+	struct flowi4 fl4;
+	struct rnd_state rnd;
+	unsigned int i, loaded = 0, dups = 0, hits = 0;
+	ktime_t start;
+	int err;
+
+	tb = fib_trie_table(FIB_TEST_TABLE);
+	if (!tb)
+		return -ENOMEM;
+
+	pr_info("fib_trie_test: loading %u prefixes\n", routes);
+	prandom_seed_state(&rnd, 3141592653589793238ULL);
+	start = ktime_get();
+	for (i = 0; i < routes; i++) {
+		route_config(&cfg, &rnd);
+		rtnl_lock();
+		err = fib_table_insert(tb, &cfg);
+		rtnl_unlock();
+		if (err == -EEXIST) {
+			dups++;
+		} else if (err) {
+			pr_err("fib_trie_test: insert failed: %d\n", err);
+			break;
+		} else {
+			loaded++;
+		}
+		cond_resched();
+	}
+	pr_info("fib_trie_test: %u prefixes (%u duplicates), %llu inserts/sec\n",
+		loaded, dups, rate(i, start));
+
+	memset(&fl4, 0, sizeof(fl4));
+	prandom_seed_state(&rnd, 2718281828459045235ULL);
+	start = ktime_get();
+	for (i = 0; i < lookups; i++) {
+		fl4.daddr = htonl(prandom_u32_state(&rnd));
+		if (fib_table_lookup(tb, &fl4, &res, FIB_LOOKUP_NOREF) <= 0)
+			hits++;
+		if (!(i & 0xffff))
+			cond_resched();
+	}
+	pr_info("fib_trie_test: %u lookups (%u hits), %llu lookups/sec\n",
+		lookups, hits, rate(lookups, start));
+
+	/* Replay the same sequence to remove everything that was added. */
+	prandom_seed_state(&rnd, 3141592653589793238ULL);
+	start = ktime_get();
+	for (i = 0; i < routes; i++) {
+		route_config(&cfg, &rnd);
+		rtnl_lock();
+		fib_table_delete(tb, &cfg);
+		rtnl_unlock();
+		cond_resched();
+	}
+	pr_info("fib_trie_test: %llu deletes/sec\n", rate(routes, start));
+
+	fib_free_table(tb);
+
+	return -EAGAIN; /* Fail will directly unload the module */
+}
+
+static void __exit fib_trie_test_exit(void)
+{
+}
+
+module_init(fib_trie_test_init)
+module_exit(fib_trie_test_exit)
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("FIB trie lookup benchmark");
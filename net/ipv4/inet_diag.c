@@ -417,119 +417,198 @@ static int inet_diag_cmd_exact(int cmd, struct sk_buff *in_skb,
 	return err;
 }
 
-static int bitstring_match(const __be32 *a1, const __be32 *a2, int bits)
+/*
+ * The request bytecode is translated once per dump into fixed-size
+ * instructions with decoded operands and jump targets resolved to
+ * instruction indices, so that filtering a socket does no parsing.
+ * A target of prog->len accepts the socket, anything past it rejects.
+ */
+struct inet_diag_bc_insn {
+	u8	code;
+	u8	family;		/* host conditions: address family */
+	u8	words;		/* host conditions: whole words of the prefix */
+	__be32	mask;		/* host conditions: mask of the partial word */
+	int	port;		/* port operand, -1 matches any */
+	u16	yes;
+	u16	no;
+	__be32	addr[4];
+};
+
+struct inet_diag_bc_prog {
+	int			len;
+	struct inet_diag_bc_insn insns[0];
+};
+
+/* Map a bytecode offset to the index of the op at that offset. */
+static u16 inet_diag_bc_target(const u16 *offs, int n, int total, int off)
 {
-	int words = bits >> 5;
+	int lo = 0, hi = n;
 
-	bits &= 0x1f;
+	if (off >= total)
+		return off == total ? n : n + 1;
 
-	if (words) {
-		if (memcmp(a1, a2, words << 2))
-			return 0;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (offs[mid] < off)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	if (bits) {
-		__be32 w1, w2;
-		__be32 mask;
+	return lo;
+}
 
-		w1 = a1[words];
-		w2 = a2[words];
+/* The bytecode must have passed inet_diag_bc_audit(). */
+static struct inet_diag_bc_prog *inet_diag_bc_compile(const struct nlattr *attr)
+{
+	const void *bytecode = nla_data(attr);
+	int total = nla_len(attr);
+	struct inet_diag_bc_prog *prog;
+	int off, n, i;
+	u16 *offs;
 
-		mask = htonl((0xffffffff) << (32 - bits));
+	/* The audit walked the yes chain, so that is where every op is. */
+	for (n = 0, off = 0; off < total; n++) {
+		const struct inet_diag_bc_op *op = bytecode + off;
 
-		if ((w1 ^ w2) & mask)
-			return 0;
+		off += op->yes;
 	}
 
-	return 1;
-}
+	offs = kmalloc(n * sizeof(*offs), GFP_KERNEL);
+	prog = kzalloc(sizeof(*prog) + n * sizeof(prog->insns[0]), GFP_KERNEL);
+	if (!offs || !prog) {
+		kfree(offs);
+		kfree(prog);
+		return NULL;
+	}
 
+	for (i = 0, off = 0; i < n; i++) {
+		const struct inet_diag_bc_op *op = bytecode + off;
 
-static int inet_diag_bc_run(const struct nlattr *_bc,
-		const struct inet_diag_entry *entry)
-{
-	const void *bc = nla_data(_bc);
-	int len = nla_len(_bc);
+		offs[i] = off;
+		off += op->yes;
+	}
 
-	while (len > 0) {
-		int yes = 1;
-		const struct inet_diag_bc_op *op = bc;
+	prog->len = n;
+	for (i = 0; i < n; i++) {
+		const struct inet_diag_bc_op *op = bytecode + offs[i];
+		struct inet_diag_bc_insn *insn = &prog->insns[i];
+
+		insn->code = op->code;
+		insn->yes = inet_diag_bc_target(offs, n, total,
+						offs[i] + op->yes);
+		insn->no = inet_diag_bc_target(offs, n, total,
+					       offs[i] + op->no);
 
 		switch (op->code) {
-		case INET_DIAG_BC_NOP:
+		case INET_DIAG_BC_S_GE:
+		case INET_DIAG_BC_S_LE:
+		case INET_DIAG_BC_D_GE:
+		case INET_DIAG_BC_D_LE:
+			insn->port = op[1].no;
+			break;
+		case INET_DIAG_BC_S_COND:
+		case INET_DIAG_BC_D_COND: {
+			const struct inet_diag_hostcond *cond = (void *)(op + 1);
+			int bits = cond->prefix_len & 0x1f;
+
+			insn->port = cond->port;
+			insn->family = cond->family;
+			insn->words = cond->prefix_len >> 5;
+			if (bits)
+				insn->mask = htonl(0xffffffff << (32 - bits));
+			memcpy(insn->addr, cond->addr,
+			       DIV_ROUND_UP(cond->prefix_len, 32) * 4);
 			break;
+		}
+		}
+	}
+
+	kfree(offs);
+	return prog;
+}
+
+static bool inet_diag_bc_addr_match(const __be32 *addr,
+				    const struct inet_diag_bc_insn *insn)
+{
+	int i;
+
+	for (i = 0; i < insn->words; i++)
+		if (addr[i] != insn->addr[i])
+			return false;
+
+	return !insn->mask || !((addr[i] ^ insn->addr[i]) & insn->mask);
+}
+
+static bool inet_diag_bc_hostcond(const struct inet_diag_bc_insn *insn,
+				  const struct inet_diag_entry *entry)
+{
+	const __be32 *addr;
+
+	if (insn->code == INET_DIAG_BC_S_COND) {
+		if (insn->port != -1 && insn->port != entry->sport)
+			return false;
+		addr = entry->saddr;
+	} else {
+		if (insn->port != -1 && insn->port != entry->dport)
+			return false;
+		addr = entry->daddr;
+	}
+
+	if (insn->family != AF_UNSPEC && insn->family != entry->family) {
+		return entry->family == AF_INET6 &&
+		       insn->family == AF_INET &&
+		       addr[0] == 0 && addr[1] == 0 &&
+		       addr[2] == htonl(0xffff) &&
+		       inet_diag_bc_addr_match(addr + 3, insn);
+	}
+
+	return inet_diag_bc_addr_match(addr, insn);
+}
+
+static int inet_diag_bc_run(const struct inet_diag_bc_prog *prog,
+			    const struct inet_diag_entry *entry)
+{
+	int pc = 0;
+
+	while (pc < prog->len) {
+		const struct inet_diag_bc_insn *insn = &prog->insns[pc];
+		bool yes;
+
+		switch (insn->code) {
 		case INET_DIAG_BC_JMP:
-			yes = 0;
+			yes = false;
 			break;
 		case INET_DIAG_BC_S_GE:
-			yes = entry->sport >= op[1].no;
+			yes = entry->sport >= insn->port;
 			break;
 		case INET_DIAG_BC_S_LE:
-			yes = entry->sport <= op[1].no;
+			yes = entry->sport <= insn->port;
 			break;
 		case INET_DIAG_BC_D_GE:
-			yes = entry->dport >= op[1].no;
+			yes = entry->dport >= insn->port;
 			break;
 		case INET_DIAG_BC_D_LE:
-			yes = entry->dport <= op[1].no;
+			yes = entry->dport <= insn->port;
 			break;
 		case INET_DIAG_BC_AUTO:
 			yes = !(entry->userlocks & SOCK_BINDPORT_LOCK);
 			break;
 		case INET_DIAG_BC_S_COND:
-		case INET_DIAG_BC_D_COND: {
-			struct inet_diag_hostcond *cond;
-			__be32 *addr;
-
-			cond = (struct inet_diag_hostcond *)(op + 1);
-			if (cond->port != -1 &&
-			    cond->port != (op->code == INET_DIAG_BC_S_COND ?
-					     entry->sport : entry->dport)) {
-				yes = 0;
-				break;
-			}
-
-			if (op->code == INET_DIAG_BC_S_COND)
-				addr = entry->saddr;
-			else
-				addr = entry->daddr;
-
-			if (cond->family != AF_UNSPEC &&
-			    cond->family != entry->family) {
-				if (entry->family == AF_INET6 &&
-				    cond->family == AF_INET) {
-					if (addr[0] == 0 && addr[1] == 0 &&
-					    addr[2] == htonl(0xffff) &&
-					    bitstring_match(addr + 3,
-							    cond->addr,
-							    cond->prefix_len))
-						break;
-				}
-				yes = 0;
-				break;
-			}
-
-			if (cond->prefix_len == 0)
-				break;
-			if (bitstring_match(addr, cond->addr,
-					    cond->prefix_len))
-				break;
-			yes = 0;
+		case INET_DIAG_BC_D_COND:
+			yes = inet_diag_bc_hostcond(insn, entry);
+			break;
+		default:
+			yes = true;
 			break;
-		}
 		}
 
-		if (yes) {
-			len -= op->yes;
-			bc += op->yes;
-		} else {
-			len -= op->no;
-			bc += op->no;
-		}
+		pc = yes ? insn->yes : insn->no;
 	}
-	return len == 0;
+	return pc == prog->len;
 }
 
-int inet_diag_bc_sk(const struct nlattr *bc, struct sock *sk)
+int inet_diag_bc_sk(const struct inet_diag_bc_prog *bc, struct sock *sk)
 {
 	struct inet_diag_entry entry;
 	struct inet_sock *inet = inet_sk(sk);
@@ -675,7 +754,7 @@ static int inet_csk_diag_dump(struct sock *sk,
 			      struct sk_buff *skb,
 			      struct netlink_callback *cb,
 			      struct inet_diag_req_v2 *r,
-			      const struct nlattr *bc)
+			      const struct inet_diag_bc_prog *bc)
 {
 	if (!inet_diag_bc_sk(bc, sk))
 		return 0;
@@ -690,7 +769,7 @@ static int inet_twsk_diag_dump(struct inet_timewait_sock *tw,
 			       struct sk_buff *skb,
 			       struct netlink_callback *cb,
 			       struct inet_diag_req_v2 *r,
-			       const struct nlattr *bc)
+			       const struct inet_diag_bc_prog *bc)
 {
 	if (bc != NULL) {
 		struct inet_diag_entry entry;
@@ -810,7 +889,7 @@ static int inet_diag_fill_req(struct sk_buff *skb, struct sock *sk,
 static int inet_diag_dump_reqs(struct sk_buff *skb, struct sock *sk,
 			       struct netlink_callback *cb,
 			       struct inet_diag_req_v2 *r,
-			       const struct nlattr *bc)
+			       const struct inet_diag_bc_prog *bc)
 {
 	struct inet_diag_entry entry;
 	struct inet_connection_sock *icsk = inet_csk(sk);
@@ -881,7 +960,8 @@ out:
 }
 
 void inet_diag_dump_icsk(struct inet_hashinfo *hashinfo, struct sk_buff *skb,
-		struct netlink_callback *cb, struct inet_diag_req_v2 *r, struct nlattr *bc)
+		struct netlink_callback *cb, struct inet_diag_req_v2 *r,
+		const struct inet_diag_bc_prog *bc)
 {
 	int i, num;
 	int s_i, s_num;
@@ -1042,7 +1122,7 @@ out:
 EXPORT_SYMBOL_GPL(inet_diag_dump_icsk);
 
 static int __inet_diag_dump(struct sk_buff *skb, struct netlink_callback *cb,
-		struct inet_diag_req_v2 *r, struct nlattr *bc)
+		struct inet_diag_req_v2 *r, const struct inet_diag_bc_prog *bc)
 {
 	const struct inet_diag_handler *handler;
 	int err = 0;
@@ -1057,15 +1137,40 @@ static int __inet_diag_dump(struct sk_buff *skb, struct netlink_callback *cb,
 	return err ? : skb->len;
 }
 
+/*
+ * Compile the filter on the first pass of a dump; it is kept in cb->data
+ * for the following passes and freed by inet_diag_dump_done().
+ */
+static int inet_diag_dump_prepare(struct netlink_callback *cb, int hdrlen)
+{
+	struct nlattr *attr;
+
+	if (cb->data || !nlmsg_attrlen(cb->nlh, hdrlen))
+		return 0;
+
+	attr = nlmsg_find_attr(cb->nlh, hdrlen, INET_DIAG_REQ_BYTECODE);
+	if (attr == NULL)
+		return 0;
+
+	cb->data = inet_diag_bc_compile(attr);
+	return cb->data ? 0 : -ENOMEM;
+}
+
+static int inet_diag_dump_done(struct netlink_callback *cb)
+{
+	kfree(cb->data);
+	return 0;
+}
+
 static int inet_diag_dump(struct sk_buff *skb, struct netlink_callback *cb)
 {
-	struct nlattr *bc = NULL;
-	int hdrlen = sizeof(struct inet_diag_req_v2);
+	int err;
 
-	if (nlmsg_attrlen(cb->nlh, hdrlen))
-		bc = nlmsg_find_attr(cb->nlh, hdrlen, INET_DIAG_REQ_BYTECODE);
+	err = inet_diag_dump_prepare(cb, sizeof(struct inet_diag_req_v2));
+	if (err)
+		return err;
 
-	return __inet_diag_dump(skb, cb, nlmsg_data(cb->nlh), bc);
+	return __inet_diag_dump(skb, cb, nlmsg_data(cb->nlh), cb->data);
 }
 
 static inline int inet_diag_type2proto(int type)
@@ -1084,8 +1189,11 @@ static int inet_diag_dump_compat(struct sk_buff *skb, struct netlink_callback *c
 {
 	struct inet_diag_req *rc = nlmsg_data(cb->nlh);
 	struct inet_diag_req_v2 req;
-	struct nlattr *bc = NULL;
-	int hdrlen = sizeof(struct inet_diag_req);
+	int err;
+
+	err = inet_diag_dump_prepare(cb, sizeof(struct inet_diag_req));
+	if (err)
+		return err;
 
 	req.sdiag_family = AF_UNSPEC; /* compatibility */
 	req.sdiag_protocol = inet_diag_type2proto(cb->nlh->nlmsg_type);
@@ -1093,10 +1201,7 @@ static int inet_diag_dump_compat(struct sk_buff *skb, struct netlink_callback *c
 	req.idiag_states = rc->idiag_states;
 	req.id = rc->id;
 
-	if (nlmsg_attrlen(cb->nlh, hdrlen))
-		bc = nlmsg_find_attr(cb->nlh, hdrlen, INET_DIAG_REQ_BYTECODE);
-
-	return __inet_diag_dump(skb, cb, &req, bc);
+	return __inet_diag_dump(skb, cb, &req, cb->data);
 }
 
 static int inet_diag_get_exact_compat(struct sk_buff *in_skb,
@@ -1137,6 +1242,7 @@ static int inet_diag_rcv_msg_compat(struct sk_buff *skb, struct nlmsghdr *nlh)
 		{
 			struct netlink_dump_control c = {
 				.dump = inet_diag_dump_compat,
+				.done = inet_diag_dump_done,
 			};
 			return netlink_dump_start(net->diag_nlsk, skb, nlh, &c);
 		}
@@ -1167,6 +1273,7 @@ static int inet_diag_handler_cmd(struct sk_buff *skb, struct nlmsghdr *h)
 		{
 			struct netlink_dump_control c = {
 				.dump = inet_diag_dump,
+				.done = inet_diag_dump_done,
 			};
 			return netlink_dump_start(net->diag_nlsk, skb, h, &c);
 		}
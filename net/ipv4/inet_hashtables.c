@@ -22,7 +22,9 @@
 #include <net/inet_connection_sock.h>
 #include <net/inet_hashtables.h>
 #include <net/secure_seq.h>
+#include <net/sock_reuseport.h>
 #include <net/ip.h>
+#include <net/ipv6.h>
 
 /*
  * Allocate and initialize a new local port bind bucket.
@@ -200,6 +202,10 @@ begin:
 			if (reuseport) {
 				phash = inet_ehashfn(net, daddr, hnum,
 						     saddr, sport);
+				result = reuseport_select_sock(sk, phash);
+				if (result)
+					goto found;
+				result = sk;
 				matches = 1;
 			}
 		} else if (score == hiscore && reuseport) {
@@ -217,6 +223,7 @@ begin:
 	if (get_nulls_value(node) != hash + LISTENING_NULLS_BASE)
 		goto begin;
 	if (result) {
+found:
 		if (unlikely(!atomic_inc_not_zero(&result->sk_refcnt)))
 			result = NULL;
 		else if (unlikely(compute_score(result, net, hnum, daddr,
@@ -423,6 +430,88 @@ int __inet_hash_nolisten(struct sock *sk, struct inet_timewait_sock *tw)
 }
 EXPORT_SYMBOL_GPL(__inet_hash_nolisten);
 
+static bool inet_reuseport_match(struct sock *sk, struct sock *sk2)
+{
+	if (!sk2->sk_reuseport ||
+	    sk2->sk_family != sk->sk_family ||
+	    sk2->sk_bound_dev_if != sk->sk_bound_dev_if ||
+	    !uid_eq(sock_i_uid(sk2), sock_i_uid(sk)))
+		return false;
+
+#if IS_ENABLED(CONFIG_IPV6)
+	if (sk->sk_family == AF_INET6)
+		return ipv6_only_sock(sk2) == ipv6_only_sock(sk) &&
+		       ipv6_addr_equal(&inet6_sk(sk2)->rcv_saddr,
+				       &inet6_sk(sk)->rcv_saddr);
+#endif
+	return inet_sk(sk2)->inet_rcv_saddr == inet_sk(sk)->inet_rcv_saddr;
+}
+
+/* Could @sk and @sk2 both be candidates for the same connection? */
+static bool inet_listen_overlap(struct sock *sk, struct sock *sk2)
+{
+	__be32 addr, addr2;
+
+	if (sk->sk_bound_dev_if && sk2->sk_bound_dev_if &&
+	    sk->sk_bound_dev_if != sk2->sk_bound_dev_if)
+		return false;
+
+	if (sk->sk_family != AF_INET || sk2->sk_family != AF_INET)
+		return true;
+
+	addr = inet_sk(sk)->inet_rcv_saddr;
+	addr2 = inet_sk(sk2)->inet_rcv_saddr;
+	return !addr || !addr2 || addr == addr2;
+}
+
+/*
+ * Put a new SO_REUSEPORT listener in the group of the listeners it
+ * shares its address and port with, or start a group.  Lookups then
+ * pick a member as soon as they find any one of them, unless the group
+ * is marked partial: other listeners on the port that may match the
+ * same connections, possibly better, still have to be scored.  A listener without a
+ * group, e.g. when allocation failed, is found by scoring as before.
+ * Called with the listening bucket locked.
+ */
+void inet_reuseport_add_sock(struct sock *sk, struct inet_listen_hashbucket *ilb)
+{
+	struct sock_reuseport *reuse = NULL;
+	struct hlist_nulls_node *node;
+	struct sock *sk2, *group = NULL;
+	bool partial = false;
+
+	sk_nulls_for_each(sk2, node, &ilb->head) {
+		if (!net_eq(sock_net(sk2), sock_net(sk)) ||
+		    inet_sk(sk2)->inet_num != inet_sk(sk)->inet_num)
+			continue;
+
+		if (reuse && rcu_access_pointer(sk2->sk_reuseport_cb) == reuse)
+			continue;
+
+		if (!group && sk->sk_reuseport &&
+		    rcu_access_pointer(sk2->sk_reuseport_cb) &&
+		    inet_reuseport_match(sk, sk2)) {
+			group = sk2;
+			reuse = rcu_access_pointer(sk2->sk_reuseport_cb);
+			continue;
+		}
+
+		if (inet_listen_overlap(sk, sk2)) {
+			reuseport_set_partial(sk2);
+			partial = true;
+		}
+	}
+
+	if (!sk->sk_reuseport)
+		return;
+
+	if (group ? reuseport_add_sock(sk, group) : reuseport_alloc(sk))
+		return;
+	if (partial)
+		reuseport_set_partial(sk);
+}
+EXPORT_SYMBOL_GPL(inet_reuseport_add_sock);
+
 static void __inet_hash(struct sock *sk)
 {
 	struct inet_hashinfo *hashinfo = sk->sk_prot->h.hashinfo;
@@ -437,6 +526,7 @@ static void __inet_hash(struct sock *sk)
 	ilb = &hashinfo->listening_hash[inet_sk_listen_hashfn(sk)];
 
 	spin_lock(&ilb->lock);
+	inet_reuseport_add_sock(sk, ilb);
 	__sk_nulls_add_node_rcu(sk, &ilb->head);
 	sock_prot_inuse_add(sock_net(sk), sk->sk_prot, 1);
 	spin_unlock(&ilb->lock);
@@ -467,6 +557,8 @@ void inet_unhash(struct sock *sk)
 		lock = inet_ehash_lockp(hashinfo, sk->sk_hash);
 
 	spin_lock_bh(lock);
+	if (rcu_access_pointer(sk->sk_reuseport_cb))
+		reuseport_detach_sock(sk);
 	done =__sk_nulls_del_node_init_rcu(sk);
 	if (done)
 		sock_prot_inuse_add(sock_net(sk), sk->sk_prot, -1);
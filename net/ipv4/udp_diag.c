@@ -19,7 +19,7 @@
 
 static int sk_diag_dump(struct sock *sk, struct sk_buff *skb,
 		struct netlink_callback *cb, struct inet_diag_req_v2 *req,
-		struct nlattr *bc)
+		const struct inet_diag_bc_prog *bc)
 {
 	if (!inet_diag_bc_sk(bc, sk))
 		return 0;
@@ -91,7 +91,7 @@ out_nosk:
 }
 
 static void udp_dump(struct udp_table *table, struct sk_buff *skb, struct netlink_callback *cb,
-		struct inet_diag_req_v2 *r, struct nlattr *bc)
+		struct inet_diag_req_v2 *r, const struct inet_diag_bc_prog *bc)
 {
 	int num, s_num, slot, s_slot;
 	struct net *net = sock_net(skb->sk);
@@ -144,7 +144,7 @@ done:
 }
 
 static void udp_diag_dump(struct sk_buff *skb, struct netlink_callback *cb,
-		struct inet_diag_req_v2 *r, struct nlattr *bc)
+		struct inet_diag_req_v2 *r, const struct inet_diag_bc_prog *bc)
 {
 	udp_dump(&udp_table, skb, cb, r, bc);
 }
@@ -170,7 +170,7 @@ static const struct inet_diag_handler udp_diag_handler = {
 };
 
 static void udplite_diag_dump(struct sk_buff *skb, struct netlink_callback *cb,
-		struct inet_diag_req_v2 *r, struct nlattr *bc)
+		struct inet_diag_req_v2 *r, const struct inet_diag_bc_prog *bc)
 {
 	udp_dump(&udplite_table, skb, cb, r, bc);
 }
@@ -35,6 +35,7 @@ int __inet6_hash(struct sock *sk, struct inet_timewait_sock *tw)
 
 		ilb = &hashinfo->listening_hash[inet_sk_listen_hashfn(sk)];
 		spin_lock(&ilb->lock);
+		inet_reuseport_add_sock(sk, ilb);
 		__sk_nulls_add_node_rcu(sk, &ilb->head);
 		spin_unlock(&ilb->lock);
 	} else {
@@ -183,6 +184,10 @@ begin:
 			if (reuseport) {
 				phash = inet6_ehashfn(net, daddr, hnum,
 						      saddr, sport);
+				result = reuseport_select_sock(sk, phash);
+				if (result)
+					goto found;
+				result = sk;
 				matches = 1;
 			}
 		} else if (score == hiscore && reuseport) {
@@ -200,6 +205,7 @@ begin:
 	if (get_nulls_value(node) != hash + LISTENING_NULLS_BASE)
 		goto begin;
 	if (result) {
+found:
 		if (unlikely(!atomic_inc_not_zero(&result->sk_refcnt)))
 			result = NULL;
 		else if (unlikely(compute_score(result, net, hnum, daddr,
@@ -1596,14 +1596,26 @@ static void fib6_prune_clones(struct net *net, struct fib6_node *fn,
  *	Garbage collection
  */
 
-static struct fib6_gc_args
-{
+/*
+ * Nodes visited per GC run.  A pass over a large tree is spread over
+ * several runs; the walker stays linked in between, so tree changes
+ * fix it up just like they do for suspended dumps.
+ */
+#define FIB6_GC_BUDGET		1024
+
+struct fib6_gc_state {
+	spinlock_t		lock;
+	struct fib6_cleaner_t	c;
+	struct fib6_table	*table;		/* table of the pass in progress */
+	bool			suspended;	/* c.w is linked into table */
+	unsigned int		budget;
 	int			timeout;
 	int			more;
-} gc_args;
+};
 
 static int fib6_age(struct rt6_info *rt, void *arg)
 {
+	struct fib6_gc_state *gc = arg;
 	unsigned long now = jiffies;
 
 	/*
@@ -1619,10 +1631,10 @@ static int fib6_age(struct rt6_info *rt, void *arg)
 			RT6_TRACE("expiring %p\n", rt);
 			return -1;
 		}
-		gc_args.more++;
+		gc->more++;
 	} else if (rt->rt6i_flags & RTF_CACHE) {
 		if (atomic_read(&rt->dst.__refcnt) == 0 &&
-		    time_after_eq(now, rt->dst.lastuse + gc_args.timeout)) {
+		    time_after_eq(now, rt->dst.lastuse + gc->timeout)) {
 			RT6_TRACE("aging clone %p\n", rt);
 			return -1;
 		} else if (rt->rt6i_flags & RTF_GATEWAY) {
@@ -1640,40 +1652,120 @@ static int fib6_age(struct rt6_info *rt, void *arg)
 				return -1;
 			}
 		}
-		gc_args.more++;
+		gc->more++;
 	}
 
 	return 0;
 }
 
-static DEFINE_SPINLOCK(fib6_gc_lock);
+static int fib6_gc_node(struct fib6_walker_t *w)
+{
+	struct fib6_gc_state *gc = container_of(w, struct fib6_gc_state, c.w);
+
+	if (!gc->budget)
+		return 1;	/* suspend, resume at this node next run */
+	gc->budget--;
+	return fib6_clean_node(w);
+}
+
+static struct fib6_table *fib6_gc_next_table(struct net *net,
+					     struct fib6_table *table)
+{
+	struct hlist_node *node = NULL;
+	unsigned int h = 0;
+
+	rcu_read_lock();
+	if (table) {
+		node = rcu_dereference(hlist_next_rcu(&table->tb6_hlist));
+		h = (table->tb6_id & (FIB6_TABLE_HASHSZ - 1)) + 1;
+	}
+	for (; !node && h < FIB6_TABLE_HASHSZ; h++)
+		node = rcu_dereference(hlist_first_rcu(&net->ipv6.fib_table_hash[h]));
+	rcu_read_unlock();
+
+	/* Tables are only freed when the namespace goes away */
+	return node ? hlist_entry(node, struct fib6_table, tb6_hlist) : NULL;
+}
+
+/*
+ * Age the routes of as many tables as the budget allows.  Returns true
+ * when the pass is complete.
+ */
+static bool fib6_gc_walk(struct net *net, struct fib6_gc_state *gc)
+{
+	struct fib6_table *table;
+	int res;
+
+	while ((table = gc->table) != NULL) {
+		write_lock_bh(&table->tb6_lock);
+		if (gc->suspended) {
+			res = fib6_walk_continue(&gc->c.w);
+			if (res <= 0)
+				fib6_walker_unlink(&gc->c.w);
+		} else {
+			gc->c.w.root = &table->tb6_root;
+			gc->c.w.count = 0;
+			gc->c.w.skip = 0;
+			res = fib6_walk(&gc->c.w);
+		}
+		gc->suspended = res > 0;
+		write_unlock_bh(&table->tb6_lock);
+
+		if (gc->suspended)
+			return false;
+		gc->table = fib6_gc_next_table(net, table);
+	}
+	return true;
+}
 
 void fib6_run_gc(unsigned long expires, struct net *net, bool force)
 {
+	struct fib6_gc_state *gc = net->ipv6.fib6_gc;
 	unsigned long now;
 
 	if (force) {
-		spin_lock_bh(&fib6_gc_lock);
-	} else if (!spin_trylock_bh(&fib6_gc_lock)) {
+		spin_lock_bh(&gc->lock);
+	} else if (!spin_trylock_bh(&gc->lock)) {
 		mod_timer(&net->ipv6.ip6_fib_timer, jiffies + HZ);
 		return;
 	}
-	gc_args.timeout = expires ? (int)expires :
-			  net->ipv6.sysctl.ip6_rt_gc_interval;
+	gc->timeout = expires ? (int)expires :
+		      net->ipv6.sysctl.ip6_rt_gc_interval;
 
-	gc_args.more = icmp6_dst_gc();
+	/*
+	 * A forced run comes from dst pressure: drop any pass in progress,
+	 * which may have aged the first nodes with a longer timeout, and
+	 * age the whole tree now.
+	 */
+	if (force && gc->table) {
+		if (gc->suspended) {
+			write_lock_bh(&gc->table->tb6_lock);
+			fib6_walker_unlink(&gc->c.w);
+			write_unlock_bh(&gc->table->tb6_lock);
+			gc->suspended = false;
+		}
+		gc->table = NULL;
+	}
+
+	if (!gc->table) {
+		/* Start a new pass */
+		gc->more = icmp6_dst_gc();
+		gc->table = fib6_gc_next_table(net, NULL);
+	}
+	gc->budget = force ? UINT_MAX : FIB6_GC_BUDGET;
 
-	fib6_clean_all(net, fib6_age, 0, NULL);
 	now = jiffies;
 	net->ipv6.ip6_rt_last_gc = now;
 
-	if (gc_args.more)
+	if (!fib6_gc_walk(net, gc))
+		mod_timer(&net->ipv6.ip6_fib_timer, now + max(HZ / 50, 1));
+	else if (gc->more)
 		mod_timer(&net->ipv6.ip6_fib_timer,
 			  round_jiffies(now
 					+ net->ipv6.sysctl.ip6_rt_gc_interval));
 	else
 		del_timer(&net->ipv6.ip6_fib_timer);
-	spin_unlock_bh(&fib6_gc_lock);
+	spin_unlock_bh(&gc->lock);
 }
 
 static void fib6_gc_timer_cb(unsigned long arg)
@@ -1687,9 +1779,18 @@ static int __net_init fib6_net_init(struct net *net)
 
 	setup_timer(&net->ipv6.ip6_fib_timer, fib6_gc_timer_cb, (unsigned long)net);
 
+	net->ipv6.fib6_gc = kzalloc(sizeof(*net->ipv6.fib6_gc), GFP_KERNEL);
+	if (!net->ipv6.fib6_gc)
+		goto out_timer;
+	spin_lock_init(&net->ipv6.fib6_gc->lock);
+	net->ipv6.fib6_gc->c.w.func = fib6_gc_node;
+	net->ipv6.fib6_gc->c.func = fib6_age;
+	net->ipv6.fib6_gc->c.arg = net->ipv6.fib6_gc;
+	net->ipv6.fib6_gc->c.net = net;
+
 	net->ipv6.rt6_stats = kzalloc(sizeof(*net->ipv6.rt6_stats), GFP_KERNEL);
 	if (!net->ipv6.rt6_stats)
-		goto out_timer;
+		goto out_fib6_gc;
 
 	/* Avoid false sharing : Use at least a full cache line */
 	size = max_t(size_t, size, L1_CACHE_BYTES);
@@ -1732,6 +1833,8 @@ out_fib_table_hash:
 	kfree(net->ipv6.fib_table_hash);
 out_rt6_stats:
 	kfree(net->ipv6.rt6_stats);
+out_fib6_gc:
+	kfree(net->ipv6.fib6_gc);
 out_timer:
 	return -ENOMEM;
  }
@@ -1740,6 +1843,8 @@ static void fib6_net_exit(struct net *net)
 {
 	rt6_ifdown(net, NULL);
 	del_timer_sync(&net->ipv6.ip6_fib_timer);
+	if (net->ipv6.fib6_gc->suspended)
+		fib6_walker_unlink(&net->ipv6.fib6_gc->c.w);
 
 #ifdef CONFIG_IPV6_MULTIPLE_TABLES
 	inetpeer_invalidate_tree(&net->ipv6.fib6_local_tbl->tb6_peers);
@@ -1749,6 +1854,7 @@ static void fib6_net_exit(struct net *net)
 	kfree(net->ipv6.fib6_main_tbl);
 	kfree(net->ipv6.fib_table_hash);
 	kfree(net->ipv6.rt6_stats);
+	kfree(net->ipv6.fib6_gc);
 }
 
 static struct pernet_operations fib6_net_ops = {
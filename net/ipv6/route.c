@@ -925,7 +925,16 @@ restart:
 	dst_hold(&rt->dst);
 	read_unlock_bh(&table->tb6_lock);
 
-	if (!(rt->rt6i_flags & (RTF_NONEXTHOP | RTF_GATEWAY)))
+	/*
+	 * Routes via a gateway are the same for every destination they
+	 * cover, so use them directly rather than inserting a clone per
+	 * destination into the tree.  Per-destination state (PMTU and
+	 * redirects) gets its own RTF_CACHE entry when it shows up.
+	 */
+	if (rt->rt6i_flags & RTF_GATEWAY)
+		goto out2;
+
+	if (!(rt->rt6i_flags & RTF_NONEXTHOP))
 		nrt = rt6_alloc_cow(rt, &fl6->daddr, &fl6->saddr);
 	else if (!(rt->dst.flags & DST_HOST))
 		nrt = rt6_alloc_clone(rt, &fl6->daddr);
@@ -1127,22 +1136,62 @@ static void ip6_link_failure(struct sk_buff *skb)
 	}
 }
 
-static void ip6_rt_update_pmtu(struct dst_entry *dst, struct sock *sk,
-			       struct sk_buff *skb, u32 mtu)
+static void __ip6_rt_update_pmtu(struct dst_entry *dst, const struct sock *sk,
+				 const struct ipv6hdr *iph, u32 mtu)
 {
 	struct rt6_info *rt6 = (struct rt6_info*)dst;
+	struct net *net = dev_net(dst->dev);
+	const struct in6_addr *daddr, *saddr;
+	struct rt6_info *nrt6;
 
 	dst_confirm(dst);
-	if (mtu < dst_mtu(dst) && rt6->rt6i_dst.plen == 128) {
-		struct net *net = dev_net(dst->dev);
+	if (mtu >= dst_mtu(dst))
+		return;
+	if (mtu < IPV6_MIN_MTU)
+		mtu = IPV6_MIN_MTU;
 
+	if (rt6->rt6i_dst.plen == 128) {
 		rt6->rt6i_flags |= RTF_MODIFIED;
-		if (mtu < IPV6_MIN_MTU)
-			mtu = IPV6_MIN_MTU;
-
 		dst_metric_set(dst, RTAX_MTU, mtu);
 		rt6_update_expires(rt6, net->ipv6.sysctl.ip6_rt_mtu_expires);
+		return;
 	}
+
+	/*
+	 * A shared route (see ip6_pol_route()): record the new path MTU in
+	 * a host route for this destination only.  Inserting it changes
+	 * the serial number of the shared route's node, so sockets caching
+	 * that route look it up again and find the new entry.
+	 */
+	if (iph) {
+		daddr = &iph->daddr;
+		saddr = &iph->saddr;
+	} else if (sk) {
+		daddr = &inet6_sk(sk)->daddr;
+		saddr = &inet6_sk(sk)->saddr;
+	} else {
+		return;
+	}
+
+	if (!(rt6->rt6i_flags & (RTF_NONEXTHOP | RTF_GATEWAY)))
+		nrt6 = rt6_alloc_cow(rt6, daddr, saddr);
+	else
+		nrt6 = rt6_alloc_clone(rt6, daddr);
+	if (!nrt6)
+		return;
+
+	nrt6->rt6i_flags |= RTF_MODIFIED;
+	dst_metric_set(&nrt6->dst, RTAX_MTU, mtu);
+	rt6_update_expires(nrt6, net->ipv6.sysctl.ip6_rt_mtu_expires);
+
+	/* fib6_add() frees the clone if this destination already has one */
+	ip6_ins_rt(nrt6);
+}
+
+static void ip6_rt_update_pmtu(struct dst_entry *dst, struct sock *sk,
+			       struct sk_buff *skb, u32 mtu)
+{
+	__ip6_rt_update_pmtu(dst, sk, skb ? ipv6_hdr(skb) : NULL, mtu);
 }
 
 void ip6_update_pmtu(struct sk_buff *skb, struct net *net, __be32 mtu,
@@ -1163,7 +1212,7 @@ void ip6_update_pmtu(struct sk_buff *skb, struct net *net, __be32 mtu,
 
 	dst = ip6_route_output(net, NULL, &fl6);
 	if (!dst->error)
-		ip6_rt_update_pmtu(dst, NULL, skb, ntohl(mtu));
+		__ip6_rt_update_pmtu(dst, NULL, iph, ntohl(mtu));
 	dst_release(dst);
 }
 EXPORT_SYMBOL_GPL(ip6_update_pmtu);
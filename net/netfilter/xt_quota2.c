@@ -12,8 +12,11 @@
  *	version 2 of the License, as published by the Free Software Foundation.
  */
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/skbuff.h>
 #include <linux/spinlock.h>
 #include <asm/atomic.h>
@@ -26,11 +29,34 @@
 #endif
 
 /**
+ * @budget:	bytes carved from the global quota (countdown mode) or
+ *		increments not yet settled into it (grow mode)
+ * @gen:	value of xt_quota_counter.gen the budget belongs to
+ */
+struct xt_quota_pcpu {
+	u_int64_t budget;
+	unsigned int gen;
+};
+
+/**
+ * @quota:	global pool; per-CPU budgets are accounted separately
  * @lock:	lock to protect quota writers from each other
+ * @pcpu:	per-CPU budgets, NULL when batching is disabled
+ * @batch:	largest chunk a CPU carves from @quota at once
+ * @gen:	bumped under @lock to invalidate all per-CPU budgets
+ * @refills:	number of times a CPU went back to the global pool
+ * @cutoffs:	number of times the quota ran out
+ *
+ * Everything up to @list is also used by anonymous counters.
  */
 struct xt_quota_counter {
 	u_int64_t quota;
 	spinlock_t lock;
+	struct xt_quota_pcpu __percpu *pcpu;
+	u_int64_t batch;
+	unsigned int gen;
+	u_int64_t refills;
+	u_int64_t cutoffs;
 	struct list_head list;
 	atomic_t ref;
 	char name[sizeof(((struct xt_quota_mtinfo2 *)NULL)->name)];
@@ -58,6 +84,15 @@ module_param_named(perms, quota_list_perms, uint, S_IRUGO | S_IWUSR);
 module_param_named(uid, quota_list_uid, uint, S_IRUGO | S_IWUSR);
 module_param_named(gid, quota_list_gid, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * Each CPU carves up to this many bytes from a counter at a time, so the
+ * shared lock is only taken once per batch instead of once per packet.
+ * A packet may be refused while at most (nr_cpus - 1) * pcpu_batch bytes
+ * are still held by other CPUs.  0 disables per-CPU accounting.
+ * Applies to counters created after the change.
+ */
+static unsigned int quota_pcpu_batch = 65536;
+module_param_named(pcpu_batch, quota_pcpu_batch, uint, S_IRUGO | S_IWUSR);
 
 #ifdef CONFIG_NETFILTER_XT_MATCH_QUOTA2_LOG
 static void quota2_log(unsigned int hooknum,
@@ -122,6 +157,61 @@ static void quota2_log(unsigned int hooknum,
 }
 #endif  /* if+else CONFIG_NETFILTER_XT_MATCH_QUOTA2_LOG */
 
+/**
+ * q2_fold_local - move this CPU's budget back into the global pool
+ *
+ * Called with @e->lock held and BH disabled.
+ */
+static void q2_fold_local(struct xt_quota_counter *e)
+{
+	struct xt_quota_pcpu *pc;
+
+	if (e->pcpu == NULL)
+		return;
+	pc = this_cpu_ptr(e->pcpu);
+	if (pc->gen == e->gen)
+		e->quota += pc->budget;
+	pc->budget = 0;
+	pc->gen = e->gen;
+}
+
+/**
+ * q2_read_quota - global pool plus whatever the CPUs currently hold
+ *
+ * Called with @e->lock held.  Per-CPU budgets are read without their
+ * owners' cooperation, so the result is only as exact as the batch size.
+ */
+static u_int64_t q2_read_quota(const struct xt_quota_counter *e)
+{
+	u_int64_t quota = e->quota;
+	const struct xt_quota_pcpu *pc;
+	unsigned int cpu;
+
+	if (e->pcpu == NULL)
+		return quota;
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(e->pcpu, cpu);
+		if (ACCESS_ONCE(pc->gen) == e->gen)
+			quota += ACCESS_ONCE(pc->budget);
+	}
+	return quota;
+}
+
+/**
+ * q2_fold_all - move every CPU's budget back into the global pool
+ *
+ * Called with @e->lock held and BH disabled.  Bumping @e->gen makes the
+ * other CPUs drop their (now folded) budgets the next time they look; a
+ * packet already past that check may still be charged to the old budget.
+ */
+static void q2_fold_all(struct xt_quota_counter *e)
+{
+	if (e->pcpu == NULL)
+		return;
+	e->quota = q2_read_quota(e);
+	e->gen++;
+}
+
 static ssize_t quota_proc_read(struct file *file, char __user *buf,
 			   size_t size, loff_t *ppos)
 {
@@ -130,7 +220,7 @@ static ssize_t quota_proc_read(struct file *file, char __user *buf,
 	size_t tmp_size;
 
 	spin_lock_bh(&e->lock);
-	tmp_size = scnprintf(tmp, sizeof(tmp), "%llu\n", e->quota);
+	tmp_size = scnprintf(tmp, sizeof(tmp), "%llu\n", q2_read_quota(e));
 	spin_unlock_bh(&e->lock);
 	return simple_read_from_buffer(buf, size, ppos, tmp, tmp_size);
 }
@@ -149,6 +239,8 @@ static ssize_t quota_proc_write(struct file *file, const char __user *input,
 
 	spin_lock_bh(&e->lock);
 	e->quota = simple_strtoull(buf, NULL, 0);
+	/* Budgets handed out against the old value are void now. */
+	e->gen++;
 	spin_unlock_bh(&e->lock);
 	return size;
 }
@@ -159,6 +251,35 @@ static const struct file_operations q2_counter_fops = {
 	.llseek		= default_llseek,
 };
 
+static int quota_stats_show(struct seq_file *m, void *v)
+{
+	struct xt_quota_counter *e;
+
+	seq_puts(m, "name quota batch refills cutoffs\n");
+	spin_lock_bh(&counter_list_lock);
+	list_for_each_entry(e, &counter_list, list) {
+		spin_lock(&e->lock);
+		seq_printf(m, "%s %llu %llu %llu %llu\n", e->name,
+			   q2_read_quota(e), e->pcpu ? e->batch : 0,
+			   e->refills, e->cutoffs);
+		spin_unlock(&e->lock);
+	}
+	spin_unlock_bh(&counter_list_lock);
+	return 0;
+}
+
+static int quota_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, quota_stats_show, NULL);
+}
+
+static const struct file_operations q2_stats_fops = {
+	.open		= quota_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static struct xt_quota_counter *
 q2_new_counter(const struct xt_quota_mtinfo2 *q, bool anon)
 {
@@ -173,6 +294,13 @@ q2_new_counter(const struct xt_quota_mtinfo2 *q, bool anon)
 
 	e->quota = q->quota;
 	spin_lock_init(&e->lock);
+	e->batch = quota_pcpu_batch;
+	e->gen = 0;
+	e->refills = 0;
+	e->cutoffs = 0;
+	e->pcpu = NULL;
+	if (e->batch != 0)
+		e->pcpu = alloc_percpu(struct xt_quota_pcpu);
 	if (!anon) {
 		INIT_LIST_HEAD(&e->list);
 		atomic_set(&e->ref, 1);
@@ -181,6 +309,14 @@ q2_new_counter(const struct xt_quota_mtinfo2 *q, bool anon)
 	return e;
 }
 
+static void q2_free_counter(struct xt_quota_counter *e)
+{
+	if (e == NULL)
+		return;
+	free_percpu(e->pcpu);
+	kfree(e);
+}
+
 /**
  * q2_get_counter - get ref to counter or create new
  * @name:	name of counter
@@ -205,7 +341,7 @@ q2_get_counter(const struct xt_quota_mtinfo2 *q)
 		if (strcmp(e->name, q->name) == 0) {
 			atomic_inc(&e->ref);
 			spin_unlock_bh(&counter_list_lock);
-			kfree(new_e);
+			q2_free_counter(new_e);
 			pr_debug("xt_quota2: old counter name=%s", e->name);
 			return e;
 		}
@@ -235,7 +371,7 @@ q2_get_counter(const struct xt_quota_mtinfo2 *q)
 	return e;
 
  out:
-	kfree(e);
+	q2_free_counter(e);
 	return NULL;
 }
 
@@ -269,7 +405,7 @@ static void quota_mt2_destroy(const struct xt_mtdtor_param *par)
 	struct xt_quota_counter *e = q->master;
 
 	if (*q->name == '\0') {
-		kfree(e);
+		q2_free_counter(e);
 		return;
 	}
 
@@ -282,7 +418,86 @@ static void quota_mt2_destroy(const struct xt_mtdtor_param *par)
 	list_del(&e->list);
 	remove_proc_entry(e->name, proc_xt_quota);
 	spin_unlock_bh(&counter_list_lock);
-	kfree(e);
+	q2_free_counter(e);
+}
+
+/**
+ * quota_mt2_pcpu - per-CPU fast path for byte countdown and grow mode
+ *
+ * x_tables runs matches with BH disabled, so this CPU's budget can be used
+ * without locking.  Only when it runs dry (countdown) or exceeds the batch
+ * size (grow) is the global pool touched under @e->lock.
+ */
+static bool
+quota_mt2_pcpu(const struct sk_buff *skb, struct xt_action_param *par)
+{
+	struct xt_quota_mtinfo2 *q = (void *)par->matchinfo;
+	struct xt_quota_counter *e = q->master;
+	struct xt_quota_pcpu *pc = this_cpu_ptr(e->pcpu);
+	bool ret = q->flags & XT_QUOTA_INVERT;
+	u_int64_t chunk, avail;
+
+	if (unlikely(pc->gen != ACCESS_ONCE(e->gen))) {
+		pc->budget = 0;
+		pc->gen = ACCESS_ONCE(e->gen);
+	}
+
+	if (q->flags & XT_QUOTA_GROW) {
+		pc->budget += (q->flags & XT_QUOTA_PACKET) ? 1 : skb->len;
+		if (unlikely(pc->budget >= e->batch)) {
+			spin_lock(&e->lock);
+			q2_fold_local(e);
+			spin_unlock(&e->lock);
+		}
+		return true;
+	}
+
+	if (likely(pc->budget >= skb->len)) {
+		pc->budget -= skb->len;
+		return !ret;
+	}
+
+	spin_lock(&e->lock);
+	if (pc->gen != e->gen) {
+		pc->budget = 0;
+		pc->gen = e->gen;
+	}
+	avail = e->quota + pc->budget;
+	if (avail < skb->len) {
+		/* Other CPUs may still hold enough; reclaim before refusing. */
+		q2_fold_all(e);
+		pc->budget = 0;
+		pc->gen = e->gen;
+		avail = e->quota;
+	}
+	if (avail < skb->len) {
+		/* We are transitioning, log that fact. */
+		if (avail) {
+			quota2_log(par->hooknum, skb, par->in, par->out,
+				   q->name);
+			e->cutoffs++;
+		}
+		/* we do not allow even small packets from now on */
+		e->quota = 0;
+		e->gen++;
+		pc->budget = 0;
+		pc->gen = e->gen;
+		spin_unlock(&e->lock);
+		return ret;
+	}
+	/*
+	 * Hand out smaller chunks as the pool drains so that little is
+	 * stranded on other CPUs near the cutoff.
+	 */
+	chunk = min_t(u_int64_t, e->batch,
+		      div_u64(e->quota, num_online_cpus()));
+	chunk = max_t(u_int64_t, chunk, skb->len - pc->budget);
+	chunk = min(chunk, e->quota);
+	e->quota -= chunk;
+	e->refills++;
+	pc->budget += chunk - skb->len;
+	spin_unlock(&e->lock);
+	return !ret;
 }
 
 static bool
@@ -292,6 +507,10 @@ quota_mt2(const struct sk_buff *skb, struct xt_action_param *par)
 	struct xt_quota_counter *e = q->master;
 	bool ret = q->flags & XT_QUOTA_INVERT;
 
+	if (e->pcpu != NULL && !(q->flags & XT_QUOTA_NO_CHANGE) &&
+	    (q->flags & (XT_QUOTA_GROW | XT_QUOTA_PACKET)) != XT_QUOTA_PACKET)
+		return quota_mt2_pcpu(skb, par);
+
 	spin_lock_bh(&e->lock);
 	if (q->flags & XT_QUOTA_GROW) {
 		/*
@@ -299,13 +518,20 @@ quota_mt2(const struct sk_buff *skb, struct xt_action_param *par)
 		 * implement it here simply to have a consistent behavior.
 		 */
 		if (!(q->flags & XT_QUOTA_NO_CHANGE)) {
+			q2_fold_local(e);
 			e->quota += (q->flags & XT_QUOTA_PACKET) ? 1 : skb->len;
 		}
 		ret = true;
+	} else if (q->flags & XT_QUOTA_NO_CHANGE) {
+		/* Only look; neither the pool nor the budgets are touched. */
+		if (q2_read_quota(e) >= skb->len)
+			ret = !ret;
 	} else {
+		q2_fold_local(e);
+		if (e->quota < skb->len)
+			q2_fold_all(e);
 		if (e->quota >= skb->len) {
-			if (!(q->flags & XT_QUOTA_NO_CHANGE))
-				e->quota -= (q->flags & XT_QUOTA_PACKET) ? 1 : skb->len;
+			e->quota -= (q->flags & XT_QUOTA_PACKET) ? 1 : skb->len;
 			ret = !ret;
 		} else {
 			/* We are transitioning, log that fact. */
@@ -315,9 +541,11 @@ quota_mt2(const struct sk_buff *skb, struct xt_action_param *par)
 					   par->in,
 					   par->out,
 					   q->name);
+				e->cutoffs++;
 			}
 			/* we do not allow even small packets from now on */
 			e->quota = 0;
+			e->gen++;
 		}
 	}
 	spin_unlock_bh(&e->lock);
@@ -362,9 +590,17 @@ static int __init quota_mt2_init(void)
 	if (proc_xt_quota == NULL)
 		return -EACCES;
 
+	if (proc_create("xt_quota2_stats", S_IRUGO, init_net.proc_net,
+			&q2_stats_fops) == NULL) {
+		remove_proc_entry("xt_quota", init_net.proc_net);
+		return -EACCES;
+	}
+
 	ret = xt_register_matches(quota_mt2_reg, ARRAY_SIZE(quota_mt2_reg));
-	if (ret < 0)
+	if (ret < 0) {
+		remove_proc_entry("xt_quota2_stats", init_net.proc_net);
 		remove_proc_entry("xt_quota", init_net.proc_net);
+	}
 	pr_debug("xt_quota2: init() %d", ret);
 	return ret;
 }
@@ -372,6 +608,7 @@ static int __init quota_mt2_init(void)
 static void __exit quota_mt2_exit(void)
 {
 	xt_unregister_matches(quota_mt2_reg, ARRAY_SIZE(quota_mt2_reg));
+	remove_proc_entry("xt_quota2_stats", init_net.proc_net);
 	remove_proc_entry("xt_quota", init_net.proc_net);
 }
 
@@ -150,6 +150,11 @@ static bool netlink_tx_is_mmaped(struct sock *sk)
 	return nlk_sk(sk)->tx_ring.pg_vec != NULL;
 }
 
+static unsigned int netlink_rx_frame_len(struct sock *sk)
+{
+	return nlk_sk(sk)->rx_ring.frame_size - NL_MMAP_HDRLEN;
+}
+
 static __pure struct page *pgvec_to_page(const void *addr)
 {
 	if (is_vmalloc_addr(addr))
@@ -694,6 +699,7 @@ static void netlink_ring_set_copied(struct sock *sk, struct sk_buff *skb)
 #define netlink_skb_is_mmaped(skb)	false
 #define netlink_rx_is_mmaped(sk)	false
 #define netlink_tx_is_mmaped(sk)	false
+#define netlink_rx_frame_len(sk)	0
 #define netlink_mmap			sock_no_mmap
 #define netlink_poll			datagram_poll
 #define netlink_mmap_sendmsg(sk, msg, dst_portid, dst_group, siocb)	0
@@ -2262,6 +2268,14 @@ static int netlink_recvmsg(struct kiocb *kiocb, struct socket *sock,
 	if (flags & MSG_TRUNC)
 		copied = data_skb->len;
 
+	/* Record the largest buffer the reader offers, dumps are built
+	 * to fill it.  High order allocations are opportunistic, so
+	 * the size is capped to keep them cheap.
+	 */
+	nlk->max_recvmsg_len = max(nlk->max_recvmsg_len, len);
+	nlk->max_recvmsg_len = min_t(size_t, nlk->max_recvmsg_len,
+				     NLMSG_DUMP_MAXSIZE);
+
 	skb_free_datagram(sk, skb);
 
 	if (nlk->cb && atomic_read(&sk->sk_rmem_alloc) <= sk->sk_rcvbuf / 2) {
@@ -2487,14 +2501,37 @@ static int netlink_dump(struct sock *sk)
 
 	alloc_size = max_t(int, cb->min_dump_alloc, NLMSG_GOODSIZE);
 
-	if (!netlink_rx_is_mmaped(sk) &&
-	    atomic_read(&sk->sk_rmem_alloc) >= sk->sk_rcvbuf)
-		goto errout_skb;
-	skb = netlink_alloc_skb(sk, alloc_size, nlk->portid, GFP_KERNEL);
-	if (!skb)
-		goto errout_skb;
+	if (netlink_rx_is_mmaped(sk)) {
+		/* Fill whole ring frames, every frame is a dump pass. */
+		alloc_size = max_t(int, alloc_size, netlink_rx_frame_len(sk));
+	} else {
+		if (atomic_read(&sk->sk_rmem_alloc) >= sk->sk_rcvbuf)
+			goto errout_skb;
+
+		/* Size the skb for the reader's buffer so that large
+		 * buffers need fewer passes through the dump callback.
+		 */
+		if (alloc_size < nlk->max_recvmsg_len) {
+			skb = alloc_skb(nlk->max_recvmsg_len,
+					GFP_KERNEL | __GFP_NOWARN |
+					__GFP_NORETRY);
+			if (skb)
+				alloc_size = nlk->max_recvmsg_len;
+		}
+	}
+	if (!skb) {
+		skb = netlink_alloc_skb(sk, alloc_size, nlk->portid,
+					GFP_KERNEL);
+		if (!skb)
+			goto errout_skb;
+	}
 	netlink_skb_set_owner_r(skb, sk);
 
+	/* kmalloc() rounds up; do not let the dump overshoot what the
+	 * reader can take in one go.
+	 */
+	skb_reserve(skb, skb_tailroom(skb) - alloc_size);
+
 	len = cb->dump(skb, cb);
 
 	if (len > 0) {
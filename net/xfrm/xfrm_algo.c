@@ -747,6 +747,30 @@ struct xfrm_algo_desc *xfrm_ealg_get_byidx(unsigned int idx)
 }
 EXPORT_SYMBOL_GPL(xfrm_ealg_get_byidx);
 
+/*
+ * Allocate the AEAD transform of an SA.  With net.core.xfrm_parallel_crypto
+ * set it is wrapped in the pcrypt template, which spreads the packets of
+ * the SA over the CPUs of the pcrypt cpumask and hands them back in their
+ * original order.  Falls back to the plain transform when pcrypt is not
+ * available.
+ */
+struct crypto_aead *xfrm_aead_alloc(struct xfrm_state *x, const char *name)
+{
+	char pname[CRYPTO_MAX_ALG_NAME];
+	struct crypto_aead *aead;
+
+	if (xs_net(x)->xfrm.sysctl_parallel_crypto &&
+	    snprintf(pname, sizeof(pname), "pcrypt(%s)",
+		     name) < sizeof(pname)) {
+		aead = crypto_alloc_aead(pname, 0, 0);
+		if (!IS_ERR(aead))
+			return aead;
+	}
+
+	return crypto_alloc_aead(name, 0, 0);
+}
+EXPORT_SYMBOL_GPL(xfrm_aead_alloc);
+
 /*
  * Probe for the availability of crypto algorithms, and set the available
  * flag for any algorithms found on the system.  This is typically called by
@@ -0,0 +1,179 @@
+/*
+ * futex-hash.c
+ *
+ * hash: Stress the futex hash table.  Every thread repeatedly issues
+ * FUTEX_WAIT on its own futexes with a value that never matches, so each
+ * call only hashes the key, takes and drops the bucket lock and returns
+ * -EWOULDBLOCK.  Running several processes shows how much unrelated
+ * processes contend on shared buckets.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+static unsigned int nthreads;
+static unsigned int nprocs = 1;
+static unsigned int nfutexes = 1024;
+static unsigned int nsecs = 10;
+static bool fshared;
+
+static volatile int done;
+static int futex_flag;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads per process"),
+	OPT_UINTEGER('p', "processes", &nprocs, "Specify amount of processes"),
+	OPT_UINTEGER('f', "futexes", &nfutexes, "Specify amount of futexes per thread"),
+	OPT_UINTEGER('r', "runtime", &nsecs, "Specify runtime (in seconds)"),
+	OPT_BOOLEAN('S', "shared", &fshared, "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_hash_usage[] = {
+	"perf bench futex hash <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t thread;
+	u_int32_t *futex;
+	unsigned long ops;
+};
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned int i;
+
+	while (!done) {
+		for (i = 0; i < nfutexes; i++) {
+			/* the futex holds 0, so waiting for 1 never blocks */
+			int ret = futex_wait(&w->futex[i], 1, NULL, futex_flag);
+
+			if (ret != -1 || (errno != EAGAIN && errno != EWOULDBLOCK))
+				err(EXIT_FAILURE, "futex_wait");
+		}
+		w->ops += nfutexes;
+	}
+	return NULL;
+}
+
+static void toggle_done(int sig __maybe_unused)
+{
+	done = 1;
+}
+
+/* Run one process worth of threads, return the number of operations. */
+static unsigned long run_process(void)
+{
+	struct worker *worker;
+	unsigned long total = 0;
+	unsigned int i;
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	for (i = 0; i < nthreads; i++) {
+		worker[i].futex = calloc(nfutexes, sizeof(*worker[i].futex));
+		if (!worker[i].futex)
+			err(EXIT_FAILURE, "calloc");
+		if (pthread_create(&worker[i].thread, NULL, workerfn, &worker[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	sleep(nsecs);
+	done = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_join(worker[i].thread, NULL))
+			err(EXIT_FAILURE, "pthread_join");
+		total += worker[i].ops;
+		free(worker[i].futex);
+	}
+	free(worker);
+	return total;
+}
+
+int bench_futex_hash(int argc, const char **argv,
+		     const char *prefix __maybe_unused)
+{
+	unsigned long ops, total = 0;
+	unsigned int i;
+	int pfd[2];
+
+	argc = parse_options(argc, argv, options, bench_futex_hash_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_hash_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	signal(SIGINT, toggle_done);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u processes with %u threads, each operating on %u %s futexes for %u secs.\n\n",
+		       nprocs, nthreads, nfutexes,
+		       fshared ? "shared" : "private", nsecs);
+
+	if (pipe(pfd))
+		err(EXIT_FAILURE, "pipe");
+
+	for (i = 0; i < nprocs; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0)
+			err(EXIT_FAILURE, "fork");
+		if (!pid) {
+			ops = run_process();
+			if (write(pfd[1], &ops, sizeof(ops)) != sizeof(ops))
+				exit(EXIT_FAILURE);
+			exit(EXIT_SUCCESS);
+		}
+	}
+
+	for (i = 0; i < nprocs; i++) {
+		if (read(pfd[0], &ops, sizeof(ops)) != sizeof(ops))
+			err(EXIT_FAILURE, "read");
+		total += ops;
+	}
+	while (wait(NULL) > 0)
+		;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %lu ops/sec\n", "Total",
+		       total / nsecs);
+		printf(" %14s: %lu ops/sec\n", "Per thread",
+		       total / nsecs / (nprocs * nthreads));
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lu\n", total / nsecs);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * futex-wake-multiple.c
+ *
+ * wake-multiple: Block threads on several futexes and time how long it
+ * takes to wake them all, either with a single FUTEX_WAKE_MULTIPLE call
+ * or with one FUTEX_WAKE call per futex.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static unsigned int nfutexes = 16;
+static unsigned int nthreads;
+static unsigned int nrounds = 10;
+static bool fshared;
+static bool single;
+static bool wait_multiple;
+
+static u_int32_t *futexes;
+static u_int32_t futex_idle;
+static int futex_flag;
+static unsigned int nblocked;
+static pthread_mutex_t thread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t thread_parent = PTHREAD_COND_INITIALIZER;
+
+static const struct option options[] = {
+	OPT_UINTEGER('f', "futexes", &nfutexes, "Specify amount of futexes"),
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads (default: one per futex)"),
+	OPT_UINTEGER('r', "rounds", &nrounds, "Specify amount of rounds"),
+	OPT_BOOLEAN('s', "single", &single, "Wake with one FUTEX_WAKE call per futex"),
+	OPT_BOOLEAN('m', "wait-multiple", &wait_multiple, "Block with FUTEX_WAIT_MULTIPLE on a second, idle futex too"),
+	OPT_BOOLEAN('S', "shared", &fshared, "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_wake_multiple_usage[] = {
+	"perf bench futex wake-multiple <options>",
+	NULL
+};
+
+static void *workerfn(void *arg)
+{
+	u_int32_t *uaddr = arg;
+	struct futex_vector vec[2] = {
+		{ .uaddr = (unsigned long)uaddr, .val = 0,
+		  .bitset = FUTEX_BITSET_MATCH_ANY },
+		{ .uaddr = (unsigned long)&futex_idle, .val = 0,
+		  .bitset = FUTEX_BITSET_MATCH_ANY },
+	};
+	int ret;
+
+	pthread_mutex_lock(&thread_lock);
+	nblocked++;
+	pthread_cond_signal(&thread_parent);
+	pthread_mutex_unlock(&thread_lock);
+
+	/* the waker never changes the futex words, so EAGAIN cannot happen */
+	do {
+		if (wait_multiple)
+			ret = futex_wait_multiple(vec, 2, NULL, futex_flag);
+		else
+			ret = futex_wait(uaddr, 0, NULL, futex_flag);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0)
+		err(EXIT_FAILURE, "futex_wait");
+	if (wait_multiple && ret != 0)
+		errx(EXIT_FAILURE, "woken on futex %d, expected 0", ret);
+	return NULL;
+}
+
+int bench_futex_wake_multiple(int argc, const char **argv,
+			      const char *prefix __maybe_unused)
+{
+	struct timeval start, stop, diff;
+	unsigned long long total_usec = 0, calls = 0;
+	struct futex_vector *vec;
+	pthread_t *worker;
+	unsigned int i, j, woken;
+	int ret;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_wake_multiple_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_wake_multiple_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nfutexes || nfutexes > FUTEX_VECTOR_MAX)
+		errx(EXIT_FAILURE, "futexes must be between 1 and %d",
+		     FUTEX_VECTOR_MAX);
+	if (!nthreads)
+		nthreads = nfutexes;
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	worker = calloc(nthreads, sizeof(*worker));
+	futexes = calloc(nfutexes, sizeof(*futexes));
+	vec = calloc(nfutexes, sizeof(*vec));
+	if (!worker || !futexes || !vec)
+		err(EXIT_FAILURE, "calloc");
+
+	for (i = 0; i < nfutexes; i++) {
+		vec[i].uaddr = (unsigned long)&futexes[i];
+		vec[i].val = nthreads;
+		vec[i].bitset = FUTEX_BITSET_MATCH_ANY;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Waking %u threads on %u %s futexes with %s, %u rounds.\n\n",
+		       nthreads, nfutexes, fshared ? "shared" : "private",
+		       single ? "FUTEX_WAKE" : "FUTEX_WAKE_MULTIPLE", nrounds);
+
+	for (j = 0; j < nrounds; j++) {
+		nblocked = 0;
+		for (i = 0; i < nthreads; i++)
+			if (pthread_create(&worker[i], NULL, workerfn,
+					   &futexes[i % nfutexes]))
+				err(EXIT_FAILURE, "pthread_create");
+
+		/* wait until every thread is about to block */
+		pthread_mutex_lock(&thread_lock);
+		while (nblocked < nthreads)
+			pthread_cond_wait(&thread_parent, &thread_lock);
+		pthread_mutex_unlock(&thread_lock);
+		usleep(100000);
+
+		woken = 0;
+		gettimeofday(&start, NULL);
+		while (woken < nthreads) {
+			if (single) {
+				for (i = 0; i < nfutexes; i++) {
+					ret = futex_wake(&futexes[i], nthreads,
+							 futex_flag);
+					if (ret < 0)
+						err(EXIT_FAILURE, "futex_wake");
+					woken += ret;
+					calls++;
+				}
+			} else {
+				ret = futex_wake_multiple(vec, nfutexes,
+							  futex_flag);
+				if (ret < 0)
+					err(EXIT_FAILURE, "futex_wake_multiple");
+				woken += ret;
+				calls++;
+			}
+		}
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff);
+		total_usec += diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+		for (i = 0; i < nthreads; i++)
+			if (pthread_join(worker[i], NULL))
+				err(EXIT_FAILURE, "pthread_join");
+	}
+	free(vec);
+	free(futexes);
+	free(worker);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %.3f [msec]\n", "Wakeup time",
+		       total_usec / 1000.0 / nrounds);
+		printf(" %14s: %.3f [usec]\n", "Per thread",
+		       (double)total_usec / nrounds / nthreads);
+		printf(" %14s: %.1f\n", "Syscalls",
+		       (double)calls / nrounds);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.3f\n", total_usec / 1000.0 / nrounds);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * futex-wake.c
+ *
+ * wake: Block a number of threads on one futex and time how long it
+ * takes to wake them all, a given number per FUTEX_WAKE call.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int nwakes = 1;
+static unsigned int nrounds = 10;
+static bool fshared;
+
+static u_int32_t futex1;
+static int futex_flag;
+static unsigned int nblocked;
+static pthread_mutex_t thread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t thread_parent = PTHREAD_COND_INITIALIZER;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads, "Specify amount of threads"),
+	OPT_UINTEGER('w', "nwakes", &nwakes, "Specify amount of threads to wake at once"),
+	OPT_UINTEGER('r', "rounds", &nrounds, "Specify amount of rounds"),
+	OPT_BOOLEAN('S', "shared", &fshared, "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_wake_usage[] = {
+	"perf bench futex wake <options>",
+	NULL
+};
+
+static void *workerfn(void *arg __maybe_unused)
+{
+	pthread_mutex_lock(&thread_lock);
+	nblocked++;
+	pthread_cond_signal(&thread_parent);
+	pthread_mutex_unlock(&thread_lock);
+
+	/* the waker never changes the futex word, so EAGAIN cannot happen */
+	while (futex_wait(&futex1, 0, NULL, futex_flag) && errno == EINTR)
+		;
+	return NULL;
+}
+
+int bench_futex_wake(int argc, const char **argv,
+		     const char *prefix __maybe_unused)
+{
+	struct timeval start, stop, diff;
+	unsigned long long total_usec = 0;
+	pthread_t *worker;
+	unsigned int i, j, woken;
+
+	argc = parse_options(argc, argv, options, bench_futex_wake_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_wake_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!nwakes)
+		nwakes = 1;
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Waking %u threads, %u per call, on a %s futex, %u rounds.\n\n",
+		       nthreads, nwakes, fshared ? "shared" : "private",
+		       nrounds);
+
+	for (j = 0; j < nrounds; j++) {
+		nblocked = 0;
+		for (i = 0; i < nthreads; i++)
+			if (pthread_create(&worker[i], NULL, workerfn, NULL))
+				err(EXIT_FAILURE, "pthread_create");
+
+		/* wait until every thread is about to block */
+		pthread_mutex_lock(&thread_lock);
+		while (nblocked < nthreads)
+			pthread_cond_wait(&thread_parent, &thread_lock);
+		pthread_mutex_unlock(&thread_lock);
+		usleep(100000);
+
+		woken = 0;
+		gettimeofday(&start, NULL);
+		while (woken < nthreads) {
+			int ret = futex_wake(&futex1, nwakes, futex_flag);
+
+			if (ret < 0)
+				err(EXIT_FAILURE, "futex_wake");
+			woken += ret;
+		}
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff);
+		total_usec += diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+		for (i = 0; i < nthreads; i++)
+			if (pthread_join(worker[i], NULL))
+				err(EXIT_FAILURE, "pthread_join");
+	}
+	free(worker);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %.3f [msec]\n", "Wakeup time",
+		       total_usec / 1000.0 / nrounds);
+		printf(" %14s: %.3f [usec]\n", "Per thread",
+		       (double)total_usec / nrounds / nthreads);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.3f\n", total_usec / 1000.0 / nrounds);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Glibc independent futex library for testing kernel functionality.
+ */
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/futex.h>
+
+/**
+ * sys_futex() - futex syscall wrapper
+ * @uaddr:	address of first futex
+ * @op:		futex op code
+ * @val:	typically expected value of uaddr, but varies by op
+ * @timeout:	typically an absolute struct timespec (except where noted
+ *		otherwise). Overloaded by some ops
+ * @uaddr2:	address of second futex for some ops
+ * @val3:	varies by op
+ * @opflags:	flags to be bitwise OR'd with op, such as FUTEX_PRIVATE_FLAG
+ */
+#define futex(uaddr, op, val, timeout, uaddr2, val3, opflags)		\
+	syscall(SYS_futex, uaddr, op | opflags, val, timeout, uaddr2, val3)
+
+/**
+ * futex_wait() - block on uaddr with optional timeout
+ * @timeout:	relative timeout
+ */
+static inline int
+futex_wait(u_int32_t *uaddr, u_int32_t val, struct timespec *timeout, int opflags)
+{
+	return futex(uaddr, FUTEX_WAIT, val, timeout, NULL, 0, opflags);
+}
+
+/**
+ * futex_wake() - wake one or more tasks blocked on uaddr
+ * @nr_wake:	wake up to this many tasks
+ */
+static inline int
+futex_wake(u_int32_t *uaddr, int nr_wake, int opflags)
+{
+	return futex(uaddr, FUTEX_WAKE, nr_wake, NULL, NULL, 0, opflags);
+}
+
+/**
+ * futex_wait_multiple() - block until one of nr futexes is woken
+ * @timeout:	relative timeout
+ */
+static inline int
+futex_wait_multiple(struct futex_vector *vec, unsigned int nr,
+		    struct timespec *timeout, int opflags)
+{
+	return futex(vec, FUTEX_WAIT_MULTIPLE, nr, timeout, NULL, 0, opflags);
+}
+
+/**
+ * futex_wake_multiple() - wake tasks blocked on nr futexes in one call
+ */
+static inline int
+futex_wake_multiple(struct futex_vector *vec, unsigned int nr, int opflags)
+{
+	return futex(vec, FUTEX_WAKE_MULTIPLE, nr, NULL, NULL, 0, opflags);
+}
+
+#endif /* _FUTEX_H */
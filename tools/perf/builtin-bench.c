@@ -13,6 +13,7 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  futex ... futex performance
  *
  */
 
@@ -73,6 +74,22 @@ static struct bench_suite mem_suites[] = {
 	  NULL             }
 };
 
+static struct bench_suite futex_suites[] = {
+	{ "hash",
+	  "Benchmark for futex hash table",
+	  bench_futex_hash },
+	{ "wake",
+	  "Benchmark for futex wake calls",
+	  bench_futex_wake },
+	{ "wake-multiple",
+	  "Benchmark for batched wakes of several futexes",
+	  bench_futex_wake_multiple },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
 struct bench_subsys {
 	const char *name;
 	const char *summary;
@@ -91,6 +108,9 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "futex",
+	  "futex stressing benchmarks",
+	  futex_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "all benchmark subsystem",
 	  NULL },
@@ -0,0 +1,191 @@
+/*
+ * Open many UDP sockets and time sock_diag dumps of them, with and
+ * without a port range filter, at several receive buffer sizes.
+ *
+ * Usage: diag_bench [sockets] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+
+#define BASE_PORT	10000
+#define PORTS		50000
+
+struct dump_result {
+	unsigned long msgs;
+	unsigned long reads;
+	double secs;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int open_sockets(unsigned long n)
+{
+	struct sockaddr_in sin;
+	struct rlimit rl;
+	unsigned long i;
+	int fd;
+
+	rl.rlim_cur = rl.rlim_max = n + 64;
+	if (setrlimit(RLIMIT_NOFILE, &rl)) {
+		perror("setrlimit");
+		return -1;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	for (i = 0; i < n; i++) {
+		/* spread over 127.0.0.1, 127.0.0.2, ... */
+		sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK + i / PORTS);
+		sin.sin_port = htons(BASE_PORT + i % PORTS);
+
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (fd < 0) {
+			perror("socket");
+			return -1;
+		}
+		if (bind(fd, (struct sockaddr *)&sin, sizeof(sin))) {
+			perror("bind");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Match sport in [lo, hi], the way ss encodes "sport >= lo and <= hi". */
+static int put_filter(struct nlattr *nla, int lo, int hi)
+{
+	struct inet_diag_bc_op *op = (void *)(nla + 1);
+
+	op[0].code = INET_DIAG_BC_S_GE;
+	op[0].yes = 8;
+	op[0].no = 20;
+	op[1].no = lo;
+	op[2].code = INET_DIAG_BC_S_LE;
+	op[2].yes = 8;
+	op[2].no = 12;
+	op[3].no = hi;
+
+	nla->nla_type = INET_DIAG_REQ_BYTECODE;
+	nla->nla_len = NLA_HDRLEN + 4 * sizeof(*op);
+	return NLA_ALIGN(nla->nla_len);
+}
+
+static int dump(int fd, size_t bufsize, int filter, struct dump_result *res)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct inet_diag_req_v2 req;
+		char attr[64];
+	} msg;
+	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
+	char *buf;
+	double start;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(msg.req));
+	msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	msg.req.sdiag_family = AF_INET;
+	msg.req.sdiag_protocol = IPPROTO_UDP;
+	msg.req.idiag_states = ~0U;
+	if (filter)
+		msg.nlh.nlmsg_len += put_filter((void *)msg.attr,
+						BASE_PORT, BASE_PORT + 99);
+
+	buf = malloc(bufsize);
+	if (!buf)
+		return -1;
+
+	memset(res, 0, sizeof(*res));
+	start = now();
+	if (sendto(fd, &msg, msg.nlh.nlmsg_len, 0,
+		   (struct sockaddr *)&nladdr, sizeof(nladdr)) < 0) {
+		perror("sendto");
+		goto err;
+	}
+
+	for (;;) {
+		struct nlmsghdr *h;
+		ssize_t len;
+
+		len = recv(fd, buf, bufsize, 0);
+		if (len < 0) {
+			perror("recv");
+			goto err;
+		}
+		res->reads++;
+
+		for (h = (void *)buf; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+			if (h->nlmsg_type == NLMSG_DONE)
+				goto done;
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				fprintf(stderr, "dump failed\n");
+				goto err;
+			}
+			res->msgs++;
+		}
+	}
+done:
+	res->secs = now() - start;
+	free(buf);
+	return 0;
+err:
+	free(buf);
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long nsocks = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+	unsigned long rounds = argc > 2 ? strtoul(argv[2], NULL, 0) : 10;
+	static const size_t bufsizes[] = { 8192, 16384, 32768 };
+	unsigned long r;
+	int fd, filter, i;
+
+	if (open_sockets(nsocks))
+		return 1;
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_SOCK_DIAG);
+	if (fd < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	printf("%lu sockets, %lu rounds\n", nsocks, rounds);
+	for (filter = 0; filter < 2; filter++) {
+		for (i = 0; i < sizeof(bufsizes) / sizeof(bufsizes[0]); i++) {
+			struct dump_result res, sum;
+
+			memset(&sum, 0, sizeof(sum));
+			for (r = 0; r < rounds; r++) {
+				if (dump(fd, bufsizes[i], filter, &res))
+					return 1;
+				sum.msgs += res.msgs;
+				sum.reads += res.reads;
+				sum.secs += res.secs;
+			}
+			printf("%-8s buf %5zu: %7lu sockets %6lu reads %8.2f ms/dump\n",
+			       filter ? "filter" : "all", bufsizes[i],
+			       sum.msgs / rounds, sum.reads / rounds,
+			       sum.secs * 1000 / rounds);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Small-file NFS workload: processes stat and read files under a
+ * directory, typically a loopback NFS mount, and report operations
+ * per second together with the CPU time the machine spent.
+ *
+ * Usage: nfsd_bench <dir> [files] [procs] [seconds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define FILE_SIZE	65536
+
+static char buf[FILE_SIZE];
+
+/* Busy and total jiffies from the cpu line of /proc/stat */
+static int read_cpu(unsigned long long *busy, unsigned long long *total)
+{
+	unsigned long long v[8];
+	FILE *f;
+	int n, i;
+
+	f = fopen("/proc/stat", "r");
+	if (!f)
+		return -1;
+	n = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+	fclose(f);
+	if (n != 8)
+		return -1;
+
+	*total = 0;
+	for (i = 0; i < 8; i++)
+		*total += v[i];
+	/* everything but idle and iowait */
+	*busy = *total - v[3] - v[4];
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int create_files(const char *dir, int files)
+{
+	char path[4096];
+	int i, fd;
+
+	memset(buf, 'x', sizeof(buf));
+	for (i = 0; i < files; i++) {
+		snprintf(path, sizeof(path), "%s/f%d", dir, i);
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+			perror(path);
+			return -1;
+		}
+		close(fd);
+	}
+	return 0;
+}
+
+static unsigned long worker(const char *dir, int files, int id, double secs)
+{
+	unsigned long ops = 0;
+	char path[4096];
+	struct stat st;
+	double end = now() + secs;
+	int i = id;
+
+	while (now() < end) {
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/f%d", dir, i++ % files);
+		if (stat(path, &st) == 0)
+			ops++;
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		/* each read is a READ on the wire with actimeo=0/noac */
+		while (read(fd, buf, sizeof(buf)) > 0)
+			ops++;
+		close(fd);
+	}
+	return ops;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir;
+	int files, procs, i, pfd[2];
+	unsigned long long busy0, total0, busy1, total1;
+	unsigned long ops, total = 0;
+	double secs, start, elapsed;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <dir> [files] [procs] [seconds]\n",
+			argv[0]);
+		return 1;
+	}
+	dir = argv[1];
+	files = argc > 2 ? atoi(argv[2]) : 256;
+	procs = argc > 3 ? atoi(argv[3]) : 8;
+	secs = argc > 4 ? atof(argv[4]) : 10;
+
+	if (create_files(dir, files) || pipe(pfd))
+		return 1;
+
+	if (read_cpu(&busy0, &total0))
+		busy0 = total0 = 0;
+	start = now();
+
+	for (i = 0; i < procs; i++) {
+		if (fork() == 0) {
+			ops = worker(dir, files, i * files / procs, secs);
+			if (write(pfd[1], &ops, sizeof(ops)) != sizeof(ops))
+				exit(1);
+			exit(0);
+		}
+	}
+	for (i = 0; i < procs; i++) {
+		if (read(pfd[0], &ops, sizeof(ops)) != sizeof(ops))
+			break;
+		total += ops;
+	}
+	while (wait(NULL) > 0)
+		;
+
+	elapsed = now() - start;
+	if (read_cpu(&busy1, &total1))
+		busy1 = total1 = 0;
+
+	printf("%d procs: %.0f ops/s, cpu %.1f%%\n", procs, total / elapsed,
+	       total1 > total0 ?
+	       100.0 * (busy1 - busy0) / (total1 - total0) : 0.0);
+	return 0;
+}
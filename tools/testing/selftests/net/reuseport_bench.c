@@ -0,0 +1,149 @@
+/*
+ * Connection setup rate over loopback to a port served by many
+ * SO_REUSEPORT listeners.  Every listener gets its own accepting
+ * process; clients connect and reset in a loop, so the cost measured
+ * is mostly SYN and handshake processing, listener lookup included.
+ *
+ * Usage: reuseport_bench [listeners] [clients] [seconds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT	15
+#endif
+
+static int open_listener(struct sockaddr_in *sin)
+{
+	socklen_t len = sizeof(*sin);
+	int one = 1;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))) {
+		perror("setsockopt SO_REUSEPORT");
+		exit(1);
+	}
+	if (bind(fd, (struct sockaddr *)sin, sizeof(*sin))) {
+		perror("bind");
+		exit(1);
+	}
+	if (listen(fd, 1024)) {
+		perror("listen");
+		exit(1);
+	}
+	/* the first listener picks the port, the others share it */
+	if (getsockname(fd, (struct sockaddr *)sin, &len)) {
+		perror("getsockname");
+		exit(1);
+	}
+	return fd;
+}
+
+static void acceptor(int fd)
+{
+	for (;;) {
+		int c = accept(fd, NULL, NULL);
+
+		if (c >= 0)
+			close(c);
+	}
+}
+
+static unsigned long client(const struct sockaddr_in *sin, double secs)
+{
+	struct linger lin = { .l_onoff = 1, .l_linger = 0 };
+	unsigned long conns = 0;
+	struct timespec ts;
+	double end;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	end = ts.tv_sec + ts.tv_nsec / 1e9 + secs;
+
+	do {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+		if (fd < 0) {
+			perror("socket");
+			exit(1);
+		}
+		/* reset on close, so no TIME_WAIT sockets pile up */
+		setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+		if (connect(fd, (const struct sockaddr *)sin, sizeof(*sin)) == 0)
+			conns++;
+		close(fd);
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	} while (ts.tv_sec + ts.tv_nsec / 1e9 < end);
+
+	return conns;
+}
+
+int main(int argc, char **argv)
+{
+	int listeners = argc > 1 ? atoi(argv[1]) : 64;
+	int clients = argc > 2 ? atoi(argv[2]) : 4;
+	double secs = argc > 3 ? atof(argv[3]) : 10;
+	unsigned long total = 0, conns;
+	struct sockaddr_in sin;
+	pid_t *pids;
+	int pfd[2];
+	int i;
+
+	pids = calloc(listeners, sizeof(*pids));
+	if (!pids || pipe(pfd)) {
+		perror("setup");
+		return 1;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (i = 0; i < listeners; i++) {
+		int fd = open_listener(&sin);
+
+		pids[i] = fork();
+		if (pids[i] == 0)
+			acceptor(fd);
+		close(fd);
+	}
+
+	for (i = 0; i < clients; i++) {
+		if (fork() == 0) {
+			conns = client(&sin, secs);
+			if (write(pfd[1], &conns, sizeof(conns)) != sizeof(conns))
+				exit(1);
+			exit(0);
+		}
+	}
+
+	for (i = 0; i < clients; i++) {
+		if (read(pfd[0], &conns, sizeof(conns)) != sizeof(conns))
+			break;
+		total += conns;
+	}
+	while (wait(NULL) > 0 && --clients > 0)
+		;
+
+	for (i = 0; i < listeners; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+
+	printf("%d listeners: %lu connections, %.0f conn/s\n",
+	       listeners, total, total / secs);
+	return 0;
+}
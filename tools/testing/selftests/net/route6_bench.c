@@ -0,0 +1,100 @@
+/*
+ * Send one UDP datagram to each of many IPv6 destinations and report the
+ * send rate and how the routing cache grew (/proc/net/rt6_stats).
+ *
+ * Meant to be run by run_route6bench, which routes the destination
+ * prefix through a dummy device.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static int read_rt6_cache(unsigned long *cache)
+{
+	unsigned long v[7];
+	FILE *f;
+	int n;
+
+	f = fopen("/proc/net/rt6_stats", "r");
+	if (!f)
+		return -1;
+	n = fscanf(f, "%lx %lx %lx %lx %lx %lx %lx",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]);
+	fclose(f);
+	if (n != 7)
+		return -1;
+	/* fib_rt_cache */
+	*cache = v[4];
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	const char *prefix = argc > 1 ? argv[1] : "2001:db8:ff00::";
+	unsigned long dests = argc > 2 ? strtoul(argv[2], NULL, 0) : 100000;
+	unsigned long rounds = argc > 3 ? strtoul(argv[3], NULL, 0) : 5;
+	unsigned long i, r, sent = 0, cache_before, cache_after;
+	struct sockaddr_in6 sin6;
+	char payload[64];
+	double start, elapsed;
+	int fd;
+
+	memset(&sin6, 0, sizeof(sin6));
+	sin6.sin6_family = AF_INET6;
+	sin6.sin6_port = htons(9);
+	if (inet_pton(AF_INET6, prefix, &sin6.sin6_addr) != 1) {
+		fprintf(stderr, "bad prefix %s\n", prefix);
+		return 1;
+	}
+
+	fd = socket(AF_INET6, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return 1;
+	}
+	memset(payload, 0, sizeof(payload));
+
+	if (read_rt6_cache(&cache_before))
+		cache_before = 0;
+
+	start = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < dests; i++) {
+			/* vary the low 32 bits of the address */
+			sin6.sin6_addr.s6_addr32[3] = htonl(i + 1);
+			if (sendto(fd, payload, sizeof(payload), 0,
+				   (struct sockaddr *)&sin6,
+				   sizeof(sin6)) < 0 && errno != ENOBUFS) {
+				perror("sendto");
+				return 1;
+			}
+			sent++;
+		}
+	}
+	elapsed = now() - start;
+
+	if (read_rt6_cache(&cache_after))
+		cache_after = 0;
+
+	printf("%lu destinations x %lu rounds: %.0f sends/sec\n",
+	       dests, rounds, sent / elapsed);
+	printf("cached routes: %lu before, %lu after\n",
+	       cache_before, cache_after);
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * TCP timer churn over loopback.  Many connections play one-byte
+ * ping-pong, so every segment rearms a retransmit or delayed ack timer
+ * with a timeout far beyond the round trip.  The transaction rate is
+ * reported together with the per-cpu timer wheel counters from
+ * /proc/timer_list: rearms that found the timer already in the right
+ * bucket, and timers queued away from the cpu that armed them.
+ *
+ * Usage: tcp_timer_bench [connections] [seconds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+struct wheel_stats {
+	unsigned long long requeue_skipped;
+	unsigned long long migrated;
+};
+
+static int read_wheel_stats(struct wheel_stats *st)
+{
+	FILE *f = fopen("/proc/timer_list", "r");
+	char line[256];
+	int found = 0;
+
+	memset(st, 0, sizeof(*st));
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long long v;
+
+		if (sscanf(line, " .nr_requeue_skipped: %llu", &v) == 1) {
+			st->requeue_skipped += v;
+			found = 1;
+		} else if (sscanf(line, " .nr_migrated : %llu", &v) == 1) {
+			st->migrated += v;
+		}
+	}
+	fclose(f);
+	return found;
+}
+
+static int open_listener(struct sockaddr_in *sin, int backlog)
+{
+	socklen_t len = sizeof(*sin);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+	if (bind(fd, (struct sockaddr *)sin, sizeof(*sin)) ||
+	    listen(fd, backlog) ||
+	    getsockname(fd, (struct sockaddr *)sin, &len)) {
+		perror("listen");
+		exit(1);
+	}
+	return fd;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int conns = argc > 1 ? atoi(argv[1]) : 1000;
+	double secs = argc > 2 ? atof(argv[2]) : 10;
+	struct rlimit rl = { 2 * conns + 16, 2 * conns + 16 };
+	struct wheel_stats before, after;
+	struct epoll_event ev, *evs;
+	struct sockaddr_in sin;
+	unsigned long trans = 0;
+	int lfd, efd, i, stats;
+	double end;
+	char c = 0;
+
+	setrlimit(RLIMIT_NOFILE, &rl);
+	evs = calloc(conns * 2, sizeof(*evs));
+	efd = epoll_create(1);
+	if (!evs || efd < 0) {
+		perror("setup");
+		return 1;
+	}
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	lfd = open_listener(&sin, conns);
+
+	/* even tags are clients, odd tags the accepted server ends */
+	for (i = 0; i < conns; i++) {
+		int one = 1;
+		int fd[2];
+
+		fd[0] = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd[0] < 0 ||
+		    connect(fd[0], (struct sockaddr *)&sin, sizeof(sin))) {
+			perror("connect");
+			return 1;
+		}
+		fd[1] = accept(lfd, NULL, NULL);
+		if (fd[1] < 0) {
+			perror("accept");
+			return 1;
+		}
+		setsockopt(fd[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		setsockopt(fd[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		ev.events = EPOLLIN;
+		ev.data.u64 = (unsigned long long)fd[0] << 1;
+		epoll_ctl(efd, EPOLL_CTL_ADD, fd[0], &ev);
+		ev.data.u64 = ((unsigned long long)fd[1] << 1) | 1;
+		epoll_ctl(efd, EPOLL_CTL_ADD, fd[1], &ev);
+
+		if (write(fd[0], &c, 1) != 1) {
+			perror("write");
+			return 1;
+		}
+	}
+
+	stats = read_wheel_stats(&before);
+	end = now() + secs;
+	while (now() < end) {
+		int n = epoll_wait(efd, evs, conns * 2, 100);
+
+		for (i = 0; i < n; i++) {
+			int fd = evs[i].data.u64 >> 1;
+
+			if (read(fd, &c, 1) != 1)
+				continue;
+			if (!(evs[i].data.u64 & 1))
+				trans++;
+			if (write(fd, &c, 1) != 1) {
+				perror("write");
+				return 1;
+			}
+		}
+	}
+	read_wheel_stats(&after);
+
+	printf("%d connections: %lu transactions, %.0f trans/s\n",
+	       conns, trans, trans / secs);
+	if (stats)
+		printf("timer wheel: %llu rearms in place, %llu timers migrated\n",
+		       after.requeue_skipped - before.requeue_skipped,
+		       after.migrated - before.migrated);
+	return 0;
+}
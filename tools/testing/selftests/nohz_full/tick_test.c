@@ -0,0 +1,217 @@
+/*
+ * Full dynticks: interrupt rate on a nohz_full CPU running a single task
+ *
+ * A busy loop that never enters the kernel is pinned to a nohz_full CPU.
+ * Once the tick had a chance to stop, the CPU's column of /proc/interrupts
+ * is sampled over MEASURE_S seconds.  With the tick stopped only the
+ * residual scheduler tick, once per second, should remain; the test
+ * fails above MAX_RATE interrupts per second and lists the rows that
+ * fired.
+ *
+ * Skipped without nohz_full=.
+ */
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define SETTLE_S	2
+#define MEASURE_S	10
+#define MAX_RATE	3
+#define MAX_ROWS	128
+
+struct irq_row {
+	char name[16];
+	unsigned long long count;
+};
+
+static cpu_set_t nohz_cpus;
+
+static int parse_cpulist(const char *p)
+{
+	char *end;
+
+	CPU_ZERO(&nohz_cpus);
+	while (isdigit(*p)) {
+		int lo = strtol(p, &end, 10), hi = lo;
+
+		if (*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		for (; lo <= hi; lo++)
+			CPU_SET(lo, &nohz_cpus);
+		p = end;
+		if (*p != ',')
+			break;
+		p++;
+	}
+	return CPU_COUNT(&nohz_cpus);
+}
+
+/* The kernel's view first: it drops the boot CPU from the range. */
+static int find_nohz_cpus(void)
+{
+	char buf[4096], *p;
+	FILE *f;
+	int n;
+
+	f = fopen("/sys/devices/system/cpu/nohz_full", "r");
+	if (f) {
+		p = fgets(buf, sizeof(buf), f);
+		fclose(f);
+		return p ? parse_cpulist(buf) : 0;
+	}
+
+	f = fopen("/proc/cmdline", "r");
+	if (!f)
+		return 0;
+	n = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[n > 0 ? n : 0] = '\0';
+
+	p = strstr(buf, "nohz_full=");
+	if (!p)
+		return 0;
+	return parse_cpulist(p + strlen("nohz_full="));
+}
+
+/*
+ * Read @cpu's column of /proc/interrupts into @rows; returns the number
+ * of rows, or -1 if the CPU has no column.
+ */
+static int read_interrupts(int cpu, struct irq_row *rows)
+{
+	char line[4096], *p, *end;
+	int col = -1, nr = 0, i;
+	FILE *f;
+
+	f = fopen("/proc/interrupts", "r");
+	if (!f)
+		return -1;
+
+	if (fgets(line, sizeof(line), f)) {
+		for (i = 0, p = strtok(line, " \t\n"); p;
+		     i++, p = strtok(NULL, " \t\n")) {
+			if (!strncmp(p, "CPU", 3) && atoi(p + 3) == cpu)
+				col = i;
+		}
+	}
+
+	while (col >= 0 && nr < MAX_ROWS && fgets(line, sizeof(line), f)) {
+		unsigned long long v = 0;
+
+		p = strchr(line, ':');
+		if (!p)
+			continue;
+		*p++ = '\0';
+		for (i = 0; i <= col; i++) {
+			v = strtoull(p, &end, 10);
+			if (end == p)
+				break;
+			p = end;
+		}
+		if (i <= col)
+			continue;	/* ERR:, MIS: and friends */
+
+		while (isspace(*line))
+			memmove(line, line + 1, strlen(line));
+		snprintf(rows[nr].name, sizeof(rows[nr].name), "%s", line);
+		rows[nr].count = v;
+		nr++;
+	}
+	fclose(f);
+
+	return col >= 0 ? nr : -1;
+}
+
+static pid_t start_spinner(int cpu)
+{
+	cpu_set_t mask;
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid)
+		return pid;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask))
+		exit(1);
+	for (;;)
+		;
+}
+
+int main(int argc, char **argv)
+{
+	static struct irq_row before[MAX_ROWS], after[MAX_ROWS];
+	int cpu, nr_before, nr_after, i, j;
+	unsigned long long total = 0;
+	double rate;
+	pid_t pid;
+
+	if (!find_nohz_cpus()) {
+		printf("tick_test: no nohz_full CPUs, skipped\n");
+		return 0;
+	}
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &nohz_cpus) &&
+		    read_interrupts(cpu, before) >= 0)
+			break;
+	if (cpu == CPU_SETSIZE) {
+		printf("tick_test: no online nohz_full CPU, skipped\n");
+		return 0;
+	}
+
+	pid = start_spinner(cpu);
+	sleep(SETTLE_S);
+
+	nr_before = read_interrupts(cpu, before);
+	sleep(MEASURE_S);
+	nr_after = read_interrupts(cpu, after);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+
+	if (nr_before < 0 || nr_after < 0) {
+		printf("tick_test: cpu%d went away\n", cpu);
+		printf("tick_test: [FAIL]\n");
+		return 1;
+	}
+
+	for (i = 0; i < nr_after; i++) {
+		unsigned long long delta = after[i].count;
+
+		for (j = 0; j < nr_before; j++) {
+			if (!strcmp(before[j].name, after[i].name)) {
+				delta -= before[j].count;
+				break;
+			}
+		}
+		if (!delta)
+			continue;
+		printf("cpu%d %6s: %llu\n", cpu, after[i].name, delta);
+		total += delta;
+	}
+
+	rate = (double)total / MEASURE_S;
+	printf("cpu%d: %llu interrupts in %d s, %.1f/s\n",
+	       cpu, total, MEASURE_S, rate);
+
+	if (rate > MAX_RATE) {
+		printf("tick_test: [FAIL]\n");
+		return 1;
+	}
+	printf("tick_test: [PASS]\n");
+	return 0;
+}
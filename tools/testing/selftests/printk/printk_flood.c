@@ -0,0 +1,144 @@
+/*
+ * printk caller latency under a flood
+ *
+ * One writer per online cpu logs warning level lines through /dev/kmsg,
+ * which ends up in vprintk_emit() like any printk().  The time each
+ * write() takes is recorded.  With console output done by the printk
+ * kthread the callers must not wait for the consoles, so the 99th
+ * percentile has to stay below LIMIT_US however slow the console is.
+ *
+ * The messages do reach the console; expect it to be busy for a while
+ * afterwards.  Needs to be run as root.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LINES_PER_WRITER	2000
+#define LIMIT_US		1000
+
+static int nr_writers;
+static unsigned long long *latency_ns;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *writer(void *arg)
+{
+	long id = (long)arg;
+	unsigned long long *lat = latency_ns + id * LINES_PER_WRITER;
+	char line[128];
+	int fd, i, len;
+
+	fd = open("/dev/kmsg", O_WRONLY);
+	if (fd < 0) {
+		perror("open /dev/kmsg");
+		exit(1);
+	}
+
+	for (i = 0; i < LINES_PER_WRITER; i++) {
+		unsigned long long start;
+
+		len = snprintf(line, sizeof(line),
+			       "<4>printk_flood: writer %ld line %d "
+			       "................................\n", id, i);
+		start = now_ns();
+		if (write(fd, line, len) != len) {
+			perror("write /dev/kmsg");
+			exit(1);
+		}
+		lat[i] = now_ns() - start;
+	}
+
+	close(fd);
+	return NULL;
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* 'Y' if printing synchronously, 0 if the kernel cannot offload it */
+static int printk_synchronous(void)
+{
+	FILE *f = fopen("/sys/module/printk/parameters/synchronous", "r");
+	int c;
+
+	if (!f)
+		return 0;
+	c = fgetc(f);
+	fclose(f);
+	return c;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *threads;
+	unsigned long long p50, p99, max;
+	int total, sync, fd;
+	long i;
+
+	fd = open("/dev/kmsg", O_WRONLY);
+	if (fd < 0) {
+		printf("printk_flood: cannot open /dev/kmsg (%s), skipped\n",
+		       strerror(errno));
+		return 0;
+	}
+	close(fd);
+
+	nr_writers = sysconf(_SC_NPROCESSORS_ONLN);
+	total = nr_writers * LINES_PER_WRITER;
+	latency_ns = calloc(total, sizeof(*latency_ns));
+	threads = calloc(nr_writers, sizeof(*threads));
+	if (!latency_ns || !threads) {
+		perror("calloc");
+		return 1;
+	}
+
+	for (i = 0; i < nr_writers; i++) {
+		if (pthread_create(&threads[i], NULL, writer, (void *)i)) {
+			perror("pthread_create");
+			return 1;
+		}
+	}
+	for (i = 0; i < nr_writers; i++)
+		pthread_join(threads[i], NULL);
+
+	qsort(latency_ns, total, sizeof(*latency_ns), cmp_ull);
+	p50 = latency_ns[total / 2] / 1000;
+	p99 = latency_ns[total / 100 * 99] / 1000;
+	max = latency_ns[total - 1] / 1000;
+
+	printf("%d writers, %d lines: p50 %llu us, p99 %llu us, max %llu us\n",
+	       nr_writers, total, p50, p99, max);
+
+	sync = printk_synchronous();
+	if (sync != 'N') {
+		printf("printk_flood: console output is synchronous, "
+		       "not checking latency\n");
+		return 0;
+	}
+
+	if (p99 > LIMIT_US) {
+		printf("printk_flood: p99 above %d us: [FAIL]\n", LIMIT_US);
+		return 1;
+	}
+	printf("printk_flood: [PASS]\n");
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * RCU callback offloading: placement of the rcuo kthreads and idle
+ * residency of no-CBs CPUs
+ *
+ * With rcu_nocbs= on the command line, every rcuo kthread must be kept
+ * off the no-CBs CPUs (unless all CPUs are no-CBs CPUs).  Then a light,
+ * callback-heavy load (close() frees the struct file through call_rcu())
+ * is run in turn on a no-CBs CPU and on a housekeeping CPU, and the idle
+ * residency of each CPU, from cpuidle, is reported for comparison.  The
+ * residency figures are informational only.
+ *
+ * Skipped without rcu_nocbs=.
+ */
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MEASURE_MS	5000
+#define LOAD_PERIOD_MS	100
+#define LOAD_FILES	200
+
+static cpu_set_t nocb_cpus;
+static int ncpus;
+
+static int parse_nocbs(void)
+{
+	char cmdline[4096], *p, *end;
+	FILE *f = fopen("/proc/cmdline", "r");
+	int n;
+
+	if (!f)
+		return 0;
+	n = fread(cmdline, 1, sizeof(cmdline) - 1, f);
+	fclose(f);
+	cmdline[n > 0 ? n : 0] = '\0';
+
+	p = strstr(cmdline, "rcu_nocbs=");
+	if (!p)
+		return 0;
+	p += strlen("rcu_nocbs=");
+
+	CPU_ZERO(&nocb_cpus);
+	while (isdigit(*p)) {
+		int lo = strtol(p, &end, 10), hi = lo;
+
+		if (*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		for (; lo <= hi; lo++)
+			CPU_SET(lo, &nocb_cpus);
+		p = end;
+		if (*p != ',')
+			break;
+		p++;
+	}
+	return CPU_COUNT(&nocb_cpus);
+}
+
+/* Every rcuo kthread must be kept off the no-CBs CPUs. */
+static int check_kthreads(void)
+{
+	DIR *proc = opendir("/proc");
+	struct dirent *de;
+	int failures = 0, seen = 0;
+
+	if (!proc)
+		return 1;
+
+	while ((de = readdir(proc))) {
+		char path[64], comm[32] = "";
+		cpu_set_t mask, bad;
+		pid_t pid = atoi(de->d_name);
+		FILE *f;
+
+		if (pid <= 0)
+			continue;
+		snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		if (!fgets(comm, sizeof(comm), f))
+			comm[0] = '\0';
+		fclose(f);
+		if (strncmp(comm, "rcuo", 4))
+			continue;
+		comm[strcspn(comm, "\n")] = '\0';
+
+		seen++;
+		if (sched_getaffinity(pid, sizeof(mask), &mask))
+			continue;
+		CPU_AND(&bad, &mask, &nocb_cpus);
+		if (CPU_COUNT(&bad)) {
+			printf("%s (pid %d) may run on no-CBs CPUs\n", comm, pid);
+			failures++;
+		}
+	}
+	closedir(proc);
+
+	printf("%d rcuo kthreads, %d on no-CBs CPUs: %s\n", seen, failures,
+	       !seen || failures ? "FAIL" : "ok");
+	return !seen || failures;
+}
+
+static unsigned long long idle_us(int cpu)
+{
+	unsigned long long total = 0, t;
+	char path[128];
+	int state;
+
+	for (state = 0; ; state++) {
+		FILE *f;
+
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cpuidle/state%d/time",
+			 cpu, state);
+		f = fopen(path, "r");
+		if (!f)
+			break;
+		if (fscanf(f, "%llu", &t) == 1)
+			total += t;
+		fclose(f);
+	}
+	return state ? total : (unsigned long long)-1;
+}
+
+/* A few hundred call_rcu()s every LOAD_PERIOD_MS, pinned to @cpu. */
+static pid_t start_load(int cpu)
+{
+	cpu_set_t mask;
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid)
+		return pid;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask))
+		exit(1);
+	for (;;) {
+		int i;
+
+		for (i = 0; i < LOAD_FILES; i++)
+			close(open("/dev/null", O_RDONLY));
+		usleep(LOAD_PERIOD_MS * 1000);
+	}
+}
+
+static void measure(int cpu, const char *kind)
+{
+	unsigned long long before, after;
+	pid_t pid;
+
+	pid = start_load(cpu);
+	before = idle_us(cpu);
+	usleep(MEASURE_MS * 1000);
+	after = idle_us(cpu);
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+
+	if (before == (unsigned long long)-1) {
+		printf("cpu%-3d %-12s no cpuidle statistics\n", cpu, kind);
+		return;
+	}
+	printf("cpu%-3d %-12s idle residency %3llu%%\n", cpu, kind,
+	       (after - before) / (MEASURE_MS * 10));
+}
+
+int main(int argc, char **argv)
+{
+	int cpu, nocb = -1, housekeeping = -1, failures = 0;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (!parse_nocbs()) {
+		printf("nocb_test: no rcu_nocbs= on the command line, skipped\n");
+		return 0;
+	}
+
+	for (cpu = 0; cpu < ncpus; cpu++) {
+		if (CPU_ISSET(cpu, &nocb_cpus)) {
+			if (nocb < 0)
+				nocb = cpu;
+		} else if (housekeeping < 0) {
+			housekeeping = cpu;
+		}
+	}
+
+	if (housekeeping >= 0)
+		failures += check_kthreads();
+	else
+		printf("all CPUs are no-CBs CPUs, kthread placement not checked\n");
+
+	if (nocb >= 0)
+		measure(nocb, "no-CBs");
+	if (housekeeping >= 0)
+		measure(housekeeping, "housekeeping");
+
+	if (failures) {
+		printf("nocb_test: [FAIL]\n");
+		return 1;
+	}
+	printf("nocb_test: [PASS]\n");
+	return 0;
+}
@@ -0,0 +1,383 @@
+/*
+ * SCHED_DEADLINE tests
+ *
+ *  - sched_setattr() rejects bad parameters and sched_getattr() reads
+ *    back what was set;
+ *  - admission control refuses reservations beyond the global limit
+ *    (sched_rt_runtime_us / sched_rt_period_us per cpu);
+ *  - a task overrunning its reservation is throttled to its bandwidth;
+ *  - periodic tasks whose jobs fit in their runtime meet all their
+ *    deadlines while every cpu is kept busy by SCHED_NORMAL hogs.
+ *
+ * Needs CAP_SYS_NICE; the test is skipped without it.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+#include <linux/types.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE		6
+#endif
+
+#ifndef __NR_sched_setattr
+#if defined(__arm__)
+#define __NR_sched_setattr	380
+#define __NR_sched_getattr	381
+#elif defined(__aarch64__)
+#define __NR_sched_setattr	274
+#define __NR_sched_getattr	275
+#else
+#error "sched_setattr syscall number unknown for this architecture"
+#endif
+#endif
+
+#define NSEC_PER_MSEC		1000000ULL
+#define NSEC_PER_SEC		1000000000ULL
+
+struct sched_attr {
+	__u32 size;
+
+	__u32 sched_policy;
+	__u64 sched_flags;
+
+	/* SCHED_NORMAL, SCHED_BATCH */
+	__s32 sched_nice;
+
+	/* SCHED_FIFO, SCHED_RR */
+	__u32 sched_priority;
+
+	/* SCHED_DEADLINE */
+	__u64 sched_runtime;
+	__u64 sched_deadline;
+	__u64 sched_period;
+};
+
+static int sched_setattr(pid_t pid, const struct sched_attr *attr,
+			 unsigned int flags)
+{
+	return syscall(__NR_sched_setattr, pid, attr, flags);
+}
+
+static int sched_getattr(pid_t pid, struct sched_attr *attr,
+			 unsigned int size, unsigned int flags)
+{
+	return syscall(__NR_sched_getattr, pid, attr, size, flags);
+}
+
+static int set_deadline(__u64 runtime, __u64 deadline, __u64 period)
+{
+	struct sched_attr attr = {
+		.size		= sizeof(attr),
+		.sched_policy	= SCHED_DEADLINE,
+		.sched_runtime	= runtime,
+		.sched_deadline	= deadline,
+		.sched_period	= period,
+	};
+
+	return sched_setattr(0, &attr, 0);
+}
+
+static int set_normal(void)
+{
+	struct sched_attr attr = {
+		.size		= sizeof(attr),
+		.sched_policy	= SCHED_OTHER,
+	};
+
+	return sched_setattr(0, &attr, 0);
+}
+
+static __u64 clock_ns(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void ns_to_timespec(__u64 ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+/* Spin until this thread has consumed @ns of cpu time. */
+static void burn_cpu(__u64 ns)
+{
+	__u64 end = clock_ns(CLOCK_THREAD_CPUTIME_ID) + ns;
+
+	while (clock_ns(CLOCK_THREAD_CPUTIME_ID) < end)
+		;
+}
+
+static long read_sysctl(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	long val;
+
+	if (!f || fscanf(f, "%ld", &val) != 1) {
+		perror(path);
+		exit(1);
+	}
+	fclose(f);
+	return val;
+}
+
+static int failures;
+
+#define check(cond, fmt, ...)						\
+do {									\
+	if (!(cond)) {							\
+		printf("FAIL: " fmt "\n", ##__VA_ARGS__);		\
+		failures++;						\
+	}								\
+} while (0)
+
+/* Runs in its own thread, so the policy changes don't leak. */
+static void *params_fn(void *arg)
+{
+	struct sched_attr attr;
+
+	errno = 0;
+	check(set_deadline(20 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC, 0) < 0 &&
+	      errno == EINVAL, "runtime > deadline accepted (%d)", errno);
+	errno = 0;
+	check(set_deadline(NSEC_PER_MSEC, 10 * NSEC_PER_MSEC,
+			   5 * NSEC_PER_MSEC) < 0 && errno == EINVAL,
+	      "period < deadline accepted (%d)", errno);
+	errno = 0;
+	check(set_deadline(100, 10 * NSEC_PER_MSEC, 0) < 0 && errno == EINVAL,
+	      "tiny runtime accepted (%d)", errno);
+
+	check(set_deadline(NSEC_PER_MSEC, 10 * NSEC_PER_MSEC,
+			   20 * NSEC_PER_MSEC) == 0,
+	      "valid reservation refused: %s", strerror(errno));
+
+	memset(&attr, 0, sizeof(attr));
+	check(sched_getattr(0, &attr, sizeof(attr), 0) == 0,
+	      "sched_getattr: %s", strerror(errno));
+	check(attr.sched_policy == SCHED_DEADLINE &&
+	      attr.sched_runtime == NSEC_PER_MSEC &&
+	      attr.sched_deadline == 10 * NSEC_PER_MSEC &&
+	      attr.sched_period == 20 * NSEC_PER_MSEC,
+	      "sched_getattr returned %u %llu/%llu/%llu", attr.sched_policy,
+	      (unsigned long long)attr.sched_runtime,
+	      (unsigned long long)attr.sched_deadline,
+	      (unsigned long long)attr.sched_period);
+	check(sched_getscheduler(0) == SCHED_DEADLINE,
+	      "sched_getscheduler returned %d", sched_getscheduler(0));
+
+	check(set_normal() == 0, "leaving SCHED_DEADLINE: %s", strerror(errno));
+	return NULL;
+}
+
+static pthread_barrier_t admission_barrier;
+static int admitted;
+static pthread_mutex_t admitted_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *admission_fn(void *arg)
+{
+	/* half a cpu each */
+	if (!set_deadline(5 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC, 0)) {
+		pthread_mutex_lock(&admitted_lock);
+		admitted++;
+		pthread_mutex_unlock(&admitted_lock);
+	} else if (errno != EBUSY) {
+		check(0, "admission: unexpected error %s", strerror(errno));
+	}
+
+	/* hold the bandwidth until everybody tried */
+	pthread_barrier_wait(&admission_barrier);
+	return NULL;
+}
+
+static void test_admission(int ncpus)
+{
+	long rt_runtime = read_sysctl("/proc/sys/kernel/sched_rt_runtime_us");
+	long rt_period = read_sysctl("/proc/sys/kernel/sched_rt_period_us");
+	int nthreads = 2 * ncpus + 2, expected, i;
+	pthread_t *threads;
+
+	if (rt_runtime < 0) {
+		printf("admission: sched_rt_runtime_us is -1, skipped\n");
+		return;
+	}
+
+	expected = (int)((double)rt_runtime / rt_period * ncpus * 2);
+	if (expected > nthreads)
+		expected = nthreads;
+
+	threads = calloc(nthreads, sizeof(*threads));
+	pthread_barrier_init(&admission_barrier, NULL, nthreads);
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&threads[i], NULL, admission_fn, NULL);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&admission_barrier);
+	free(threads);
+
+	check(admitted == expected, "admission: %d reservations of 50%% "
+	      "admitted on %d cpus, expected %d", admitted, ncpus, expected);
+}
+
+/* A task that never stops must not get more than its reservation. */
+static void *overrun_fn(void *arg)
+{
+	__u64 *used = arg;
+	__u64 start, wall;
+
+	if (set_deadline(2 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC, 0)) {
+		check(0, "overrun: sched_setattr: %s", strerror(errno));
+		return NULL;
+	}
+
+	start = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	wall = clock_ns(CLOCK_MONOTONIC) + NSEC_PER_SEC;
+	while (clock_ns(CLOCK_MONOTONIC) < wall)
+		;
+	*used = clock_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+	return NULL;
+}
+
+static void test_overrun(void)
+{
+	pthread_t thread;
+	__u64 used = 0;
+
+	pthread_create(&thread, NULL, overrun_fn, &used);
+	pthread_join(thread, NULL);
+
+	/* 20% of a second, plus slack for tick-based accounting */
+	check(used < 250 * NSEC_PER_MSEC && used > 150 * NSEC_PER_MSEC,
+	      "overrun: a 20%% reservation ran for %llu ms in a second",
+	      (unsigned long long)(used / NSEC_PER_MSEC));
+}
+
+#define JOBS		200
+#define PERIOD		(10 * NSEC_PER_MSEC)
+#define RUNTIME		(3 * NSEC_PER_MSEC)
+#define WORK		(2 * NSEC_PER_MSEC)
+
+static volatile int hogs_stop;
+static int total_misses;
+static __u64 worst_lateness;
+static pthread_mutex_t misses_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *hog_fn(void *arg)
+{
+	while (!hogs_stop)
+		;
+	return NULL;
+}
+
+/*
+ * A periodic task: each job is released at the start of a period, does
+ * WORK of computation and must complete within the period.
+ */
+static void *periodic_fn(void *arg)
+{
+	__u64 release, finish, lateness = 0;
+	struct timespec ts;
+	int job, misses = 0;
+
+	if (set_deadline(RUNTIME, PERIOD, PERIOD)) {
+		check(0, "periodic: sched_setattr: %s", strerror(errno));
+		return NULL;
+	}
+
+	release = clock_ns(CLOCK_MONOTONIC);
+	for (job = 0; job < JOBS; job++) {
+		burn_cpu(WORK);
+
+		finish = clock_ns(CLOCK_MONOTONIC);
+		if (finish > release + PERIOD) {
+			misses++;
+			if (finish - release - PERIOD > lateness)
+				lateness = finish - release - PERIOD;
+		}
+
+		release += PERIOD;
+		ns_to_timespec(release, &ts);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	pthread_mutex_lock(&misses_lock);
+	total_misses += misses;
+	if (lateness > worst_lateness)
+		worst_lateness = lateness;
+	pthread_mutex_unlock(&misses_lock);
+
+	return NULL;
+}
+
+static void test_misses(int ncpus)
+{
+	pthread_t *hogs, *tasks;
+	int i;
+
+	hogs = calloc(ncpus, sizeof(*hogs));
+	tasks = calloc(ncpus, sizeof(*tasks));
+
+	for (i = 0; i < ncpus; i++)
+		pthread_create(&hogs[i], NULL, hog_fn, NULL);
+	for (i = 0; i < ncpus; i++)
+		pthread_create(&tasks[i], NULL, periodic_fn, NULL);
+	for (i = 0; i < ncpus; i++)
+		pthread_join(tasks[i], NULL);
+
+	hogs_stop = 1;
+	for (i = 0; i < ncpus; i++)
+		pthread_join(hogs[i], NULL);
+	free(tasks);
+	free(hogs);
+
+	printf("misses: %d of %d jobs late, worst by %llu us\n",
+	       total_misses, ncpus * JOBS,
+	       (unsigned long long)(worst_lateness / 1000));
+	check(total_misses == 0, "periodic tasks missed deadlines under load");
+}
+
+int main(int argc, char **argv)
+{
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t thread;
+
+	if (set_deadline(NSEC_PER_MSEC, 10 * NSEC_PER_MSEC, 0)) {
+		if (errno == EPERM) {
+			printf("deadline_test: needs CAP_SYS_NICE, skipped\n");
+			return 0;
+		}
+		if (errno == ENOSYS) {
+			printf("deadline_test: no sched_setattr(), skipped\n");
+			return 0;
+		}
+	} else {
+		set_normal();
+	}
+
+	pthread_create(&thread, NULL, params_fn, NULL);
+	pthread_join(thread, NULL);
+
+	test_admission(ncpus);
+	test_overrun();
+	test_misses(ncpus);
+
+	if (failures) {
+		printf("deadline_test: %d failures [FAIL]\n", failures);
+		return 1;
+	}
+	printf("deadline_test: [PASS]\n");
+	return 0;
+}
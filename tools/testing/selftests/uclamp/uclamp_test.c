@@ -0,0 +1,295 @@
+/*
+ * Utilization clamping: frequency decisions under mixed loads
+ *
+ * Runs light (10% duty cycle) and heavy (busy loop) loads on one cpu,
+ * unclamped and in cpu cgroups with cpu.uclamp_min / cpu.uclamp_max set,
+ * and samples scaling_cur_freq of that cpu.  A boosted group must run at
+ * or above its boost even when lightly loaded, a capped group at or below
+ * its cap even when fully loaded, and a boosted task must not be held
+ * back by a capped one sharing its cpu.
+ *
+ * Needs the cpu controller mounted, cpufreq on the last online cpu, and
+ * no other load on the cpus sharing its frequency.  Skipped otherwise.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define BOOST		80
+#define CAP		30
+
+#define PERIOD_US	10000
+#define SETTLE_MS	1000
+#define SAMPLE_MS	3000
+#define SAMPLE_EVERY_MS	10
+
+/* share of the samples that must be within the clamps */
+#define PASS_PCT	90
+
+static char cgroup_root[256];
+static char fg_group[300], bg_group[300];
+static char freq_path[128];
+static int cpu;
+static unsigned long max_freq, min_freq;
+
+static int find_cpu_cgroup(void)
+{
+	char dev[64], dir[256], type[64], opts[256];
+	FILE *f = fopen("/proc/mounts", "r");
+	int found = 0;
+
+	if (!f)
+		return 0;
+
+	while (fscanf(f, "%63s %255s %63s %255s %*d %*d\n",
+		      dev, dir, type, opts) == 4) {
+		char *opt, *save;
+
+		if (strcmp(type, "cgroup"))
+			continue;
+		for (opt = strtok_r(opts, ",", &save); opt;
+		     opt = strtok_r(NULL, ",", &save)) {
+			if (!strcmp(opt, "cpu")) {
+				strcpy(cgroup_root, dir);
+				found = 1;
+			}
+		}
+		if (found)
+			break;
+	}
+	fclose(f);
+	return found;
+}
+
+static int write_file(const char *path, unsigned long val)
+{
+	FILE *f = fopen(path, "w");
+	int ret;
+
+	if (!f)
+		return -1;
+	ret = fprintf(f, "%lu\n", val);
+	if (fclose(f) || ret < 0)
+		return -1;
+	return 0;
+}
+
+static unsigned long read_file(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	unsigned long val = 0;
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "%lu", &val) != 1)
+		val = 0;
+	fclose(f);
+	return val;
+}
+
+static int group_set(const char *group, const char *file, unsigned long val)
+{
+	char path[400];
+
+	snprintf(path, sizeof(path), "%s/%s", group, file);
+	return write_file(path, val);
+}
+
+static int setup_groups(void)
+{
+	snprintf(fg_group, sizeof(fg_group), "%s/uclamp_test_fg", cgroup_root);
+	snprintf(bg_group, sizeof(bg_group), "%s/uclamp_test_bg", cgroup_root);
+
+	if ((mkdir(fg_group, 0755) && errno != EEXIST) ||
+	    (mkdir(bg_group, 0755) && errno != EEXIST))
+		return -1;
+
+	if (group_set(fg_group, "cpu.uclamp_min", BOOST) ||
+	    group_set(bg_group, "cpu.uclamp_max", CAP))
+		return -1;
+
+	return 0;
+}
+
+static void cleanup_groups(void)
+{
+	rmdir(fg_group);
+	rmdir(bg_group);
+}
+
+static unsigned long long now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Busy for @duty percent of every period, on @cpu, in @group (or root). */
+static pid_t start_load(int duty, const char *group)
+{
+	cpu_set_t mask;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+
+	if (!pid) {
+		unsigned long long start;
+
+		CPU_ZERO(&mask);
+		CPU_SET(cpu, &mask);
+		if (sched_setaffinity(0, sizeof(mask), &mask)) {
+			perror("sched_setaffinity");
+			exit(1);
+		}
+
+		for (;;) {
+			start = now_us();
+			while (now_us() - start < PERIOD_US * duty / 100)
+				;
+			if (duty < 100)
+				usleep(PERIOD_US * (100 - duty) / 100);
+		}
+	}
+
+	if (group && group_set(group, "tasks", pid)) {
+		perror("moving load into its group");
+		kill(pid, SIGKILL);
+		exit(1);
+	}
+
+	return pid;
+}
+
+static void stop_load(pid_t pid)
+{
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+}
+
+struct phase {
+	const char *name;
+	int fg_duty;		/* load in the boosted group, 0 if none */
+	int bg_duty;		/* load in the capped group, 0 if none */
+	int root_duty;		/* unclamped load, 0 if none */
+	int check;		/* 1: freq >= boost, -1: freq <= cap, 0: none */
+};
+
+static const struct phase phases[] = {
+	{ "light, unclamped",		0,  0,   10,  0 },
+	{ "light, boosted",		10, 0,   0,   1 },
+	{ "heavy, unclamped",		0,  0,   100, 0 },
+	{ "heavy, capped",		0,  100, 0,  -1 },
+	{ "light boosted + heavy capped", 10, 100, 0, 1 },
+};
+
+static int run_phase(const struct phase *ph)
+{
+	unsigned long floor = max_freq / 100 * BOOST;
+	unsigned long cap = max_freq / 100 * CAP;
+	unsigned long long sum = 0;
+	int samples = 0, in_range = 0, i, pct;
+	pid_t pids[3];
+	int npids = 0;
+
+	if (cap < min_freq)
+		cap = min_freq;
+
+	if (ph->fg_duty)
+		pids[npids++] = start_load(ph->fg_duty, fg_group);
+	if (ph->bg_duty)
+		pids[npids++] = start_load(ph->bg_duty, bg_group);
+	if (ph->root_duty)
+		pids[npids++] = start_load(ph->root_duty, NULL);
+
+	usleep(SETTLE_MS * 1000);
+
+	for (i = 0; i < SAMPLE_MS / SAMPLE_EVERY_MS; i++) {
+		unsigned long freq = read_file(freq_path);
+
+		sum += freq;
+		samples++;
+		if ((ph->check > 0 && freq >= floor) ||
+		    (ph->check < 0 && freq <= cap))
+			in_range++;
+		usleep(SAMPLE_EVERY_MS * 1000);
+	}
+
+	for (i = 0; i < npids; i++)
+		stop_load(pids[i]);
+
+	pct = in_range * 100 / samples;
+	printf("%-30s mean %8llu kHz", ph->name, sum / samples);
+	if (!ph->check) {
+		printf("\n");
+		return 0;
+	}
+
+	printf(", %3d%% of samples %s %lu kHz: %s\n", pct,
+	       ph->check > 0 ? ">=" : "<=", ph->check > 0 ? floor : cap,
+	       pct >= PASS_PCT ? "ok" : "FAIL");
+	return pct >= PASS_PCT ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	char path[128];
+	int i, failures = 0;
+
+	cpu = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+
+	snprintf(freq_path, sizeof(freq_path),
+		 "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+	max_freq = read_file(path);
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_min_freq", cpu);
+	min_freq = read_file(path);
+	if (!max_freq || !read_file(freq_path)) {
+		printf("uclamp_test: no cpufreq on cpu%d, skipped\n", cpu);
+		return 0;
+	}
+
+	if (!find_cpu_cgroup()) {
+		printf("uclamp_test: cpu cgroup controller not mounted, skipped\n");
+		return 0;
+	}
+
+	if (setup_groups()) {
+		printf("uclamp_test: cannot set up clamped groups (%s), skipped\n",
+		       strerror(errno));
+		cleanup_groups();
+		return 0;
+	}
+
+	printf("cpu%d, max %lu kHz, boost %d%%, cap %d%%\n",
+	       cpu, max_freq, BOOST, CAP);
+
+	for (i = 0; i < sizeof(phases) / sizeof(phases[0]); i++)
+		failures += run_phase(&phases[i]);
+
+	cleanup_groups();
+
+	if (failures) {
+		printf("uclamp_test: [FAIL]\n");
+		return 1;
+	}
+	printf("uclamp_test: [PASS]\n");
+	return 0;
+}